@@ -17,6 +17,7 @@
 
 #include "ann_evaluator.h"
 
+#include <algorithm>
 #include <fstream>
 #include <set>
 #include <sstream>
@@ -38,13 +39,13 @@ std::string ensembleFilename(const std::string &base, size_t num)
 }
 
 ANNEvaluator::ANNEvaluator(bool eigenOnly)
-	: m_ann(eigenOnly), m_evalHash(EvalHashSize)
+	: m_ann(eigenOnly), m_evalHash("Eval hash", DefaultEvalHashSize, false), m_evalHashMask(DefaultEvalHashSize - 1)
 {
 	InvalidateCache();
 }
 
 ANNEvaluator::ANNEvaluator(const std::string &filename)
-	: m_evalHash(EvalHashSize)
+	: m_evalHash("Eval hash", DefaultEvalHashSize, false), m_evalHashMask(DefaultEvalHashSize - 1)
 {
 	Deserialize(filename);
 }
@@ -173,6 +174,8 @@ Score ANNEvaluator::EvaluateForWhiteImpl(Board &b, Score /*lowerBound*/, Score /
 
 	float annOut = m_ann.ForwardSingle(mappedVec);
 
+	Counters::Inc(Counters::NN_FORWARDS);
+
 	Score nnRet = annOut * EvalFullScale;
 
 	HashStore_(b, nnRet);
@@ -189,10 +192,36 @@ void ANNEvaluator::PrintDiag(Board &board)
 	std::cout << "Val: " << m_ann.ForwardSingle(mappedVec) << std::endl;
 }
 
-void ANNEvaluator::InvalidateCache()
+size_t ANNEvaluator::SetCacheSize(size_t bytes)
+{
+	size_t numEntries = FloorPowerOf2(std::max<size_t>(bytes / sizeof(EvalHashEntry), 1));
+
+	if (numEntries != m_evalHash.GetSize())
+	{
+		m_evalHash.Resize(numEntries);
+		m_evalHashMask = numEntries - 1;
+	}
+
+	return numEntries * sizeof(EvalHashEntry);
+}
+
+uint64_t ANNEvaluator::GetSignature()
 {
-	for (auto &entry : m_evalHash)
+	// FNV-1a, since std::hash is not guaranteed to be the same across builds
+	std::string str = ToString();
+
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (char c : str)
 	{
-		entry.hash = 0;
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ULL;
 	}
+
+	return hash;
+}
+
+void ANNEvaluator::InvalidateCache()
+{
+	m_evalHash.Fill(EvalHashEntry());
 }
@@ -28,8 +28,9 @@
 #include "ann/features_conv.h"
 #include "matrix_ops.h"
 #include "consts.h"
+#include "large_pages.h"
+#include "counters.h"
 
-//#define EVAL_HASH_STATS
 //#define LAZY_EVAL
 
 class ANNEvaluator : public EvaluatorIface
@@ -41,7 +42,8 @@ public:
 		Score val;
 	};
 
-	const static size_t EvalHashSize = 8*MB / sizeof(EvalHashEntry);
+	const static size_t DefaultEvalHashSize = 8*MB / sizeof(EvalHashEntry);
+	static_assert((DefaultEvalHashSize & (DefaultEvalHashSize - 1)) == 0, "Eval hash size must be a power of 2");
 	const static size_t BatchSize = 8;
 	const static size_t EnsembleSize = 8;
 
@@ -87,6 +89,16 @@ public:
 
 	void PrintDiag(Board &board) override;
 
+	size_t SetCacheSize(size_t bytes) override;
+
+	void Prefetch(uint64_t hash) override
+	{
+		__builtin_prefetch(&m_evalHash[hash & m_evalHashMask]);
+	}
+
+	// hash of the network
+	uint64_t GetSignature() override;
+
 	void InvalidateCache();
 
 	/* To take advantage of more efficient computation by doing multiple forwards at the same time, the
@@ -129,6 +141,8 @@ public:
 
 		NNMatrixRM *results = m_ann.ForwardMultiple(m_batchInput.topRows(m_currentBatchSize));
 
+		Counters::Inc(Counters::NN_FORWARDS, m_currentBatchSize);
+
 		for (size_t i = 0; i < m_currentBatchSize; ++i)
 		{
 			HashStore_(m_batchHashes[i], (*results)(i, 0));
@@ -147,33 +161,16 @@ private:
 
 	Optional<Score> HashProbe_(uint64_t hash)
 	{
-//#define EVAL_HASH_STATS
-#ifdef EVAL_HASH_STATS
-		static int64_t queries = 0;
-		static int64_t hits = 0;
-#endif
-
 		Optional<Score> ret;
-		EvalHashEntry *entry = &m_evalHash[hash % EvalHashSize];
+		EvalHashEntry *entry = &m_evalHash[hash & m_evalHashMask];
 
-		if (entry->hash == hash)
-		{
-			ret = entry->val;
-		}
+		Counters::Inc(Counters::EVAL_HASH_PROBES);
 
-#ifdef EVAL_HASH_STATS
 		if (entry->hash == hash)
 		{
-			++hits;
-		}
-
-		++queries;
-
-		if (queries % 100000 == 0 && queries != 0)
-		{
-			std::cout << hits << "/" << queries << " (" << (static_cast<float>(hits) / queries) << ")" << std::endl;
+			ret = entry->val;
+			Counters::Inc(Counters::EVAL_HASH_HITS);
 		}
-#endif
 
 		return ret;
 	}
@@ -185,7 +182,7 @@ private:
 
 	void HashStore_(uint64_t hash, Score score)
 	{
-		EvalHashEntry *entry = &m_evalHash[hash % EvalHashSize];
+		EvalHashEntry *entry = &m_evalHash[hash & m_evalHashMask];
 
 		entry->hash = hash;
 		entry->val = score;
@@ -197,7 +194,10 @@ private:
 
 	std::vector<float> m_convTmp;
 
-	std::vector<EvalHashEntry> m_evalHash;
+	// the size is always a power of 2, so we can index with a mask
+	// an evaluator is only used by one thread at a time, so this is not a shared table
+	LargePageArray<EvalHashEntry> m_evalHash;
+	size_t m_evalHashMask;
 
 	size_t m_currentBatchSize = 0;
 	NNMatrixRM m_batchInput;
@@ -15,124 +15,325 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "ann_move_evaluator.h"
 #include "ann_move_evaluator.h"
 
+#include "counters.h"
+#include "profiling.h"
 #include "random_device.h"
 #include "search.h"
 #include "static_move_evaluator.h"
+#include "util.h"
 
 #include <algorithm>
 #include <functional>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
 namespace
 {
 
-void TargetsToYNN(const std::vector<float> &trainingTargets, NNMatrixRM &yNN)
+struct DatasetHeader
 {
-	yNN.resize(trainingTargets.size(), 1);
+	uint32_t magic;
+	uint32_t version;
+	int64_t numFeatures;
+	uint64_t numPositions;
+};
 
-	for (int64_t i = 0; i < static_cast<int64_t>(trainingTargets.size()); ++i)
-	{
-		yNN(i, 0) = trainingTargets[i];
-	}
-}
+const static uint32_t DatasetMagic = 0x4d564453; // "SDVM"
+const static uint32_t DatasetVersion = 1;
+
+const static size_t PositionsPerMinibatch = 16;
+const static size_t NumTrainingIterations = 100000;
+const static size_t IterationsPerPrint = 100;
+
+// how many positions to convert at a time when writing a dataset
+const static size_t DatasetConversionChunkSize = 4096;
 
 }
 
 ANNMoveEvaluator::ANNMoveEvaluator(ANNEvaluator &annEval)
-	: m_annEval(annEval)
+	: m_cache(DefaultCacheSize), m_cacheMask(DefaultCacheSize - 1), m_annEval(annEval)
 {
 	m_ann = ANN("make_move_evaluator", FeaturesConv::GetMoveNumFeatures());
 }
 
 void ANNMoveEvaluator::Train(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves)
 {
-	NNMatrixRM trainingSet;
-	std::vector<float> trainingTarget;
-
 	// training set size is approx 35 * positionsPerBatch
-	size_t positionsPerBatch = std::min<size_t>(positions.size(), 16);
-
-	const static size_t NumIterations = 100000;
-	const static size_t IterationsPerPrint = 100;
+	size_t positionsPerBatch = std::min<size_t>(positions.size(), PositionsPerMinibatch);
 
 	auto rng = gRd.MakeMT();
 	auto positionDist = std::uniform_int_distribution<size_t>(0, positions.size() - 1);
 	auto positionDrawFunc = std::bind(positionDist, rng);
 
-	for (size_t iter = 0; iter < NumIterations; ++iter)
+	std::vector<size_t> indices(positionsPerBatch);
+
+	TrainLoop_([&](NNMatrixRM &x, NNMatrixRM &y)
 	{
-		if ((iter % IterationsPerPrint) == 0)
+		// draw indices here so the RNG isn't shared between threads
+		for (auto &idx : indices)
 		{
-			std::cout << iter << "/" << NumIterations << std::endl;
+			idx = positionDrawFunc();
 		}
 
-		trainingSet.resize(0, 0);
-		trainingTarget.clear();
+		AssembleMinibatch_(positions, bestMoves, indices, x, y);
+	});
+}
 
-		for (size_t positionNum = 0; positionNum < positionsPerBatch; ++positionNum)
+void ANNMoveEvaluator::WriteDataset(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves, const std::string &filename)
+{
+	std::ofstream outfile(filename, std::ios::binary);
+
+	if (!outfile)
+	{
+		throw std::runtime_error(std::string("Cannot open ") + filename + " for writing");
+	}
+
+	DatasetHeader header;
+	header.magic = DatasetMagic;
+	header.version = DatasetVersion;
+	header.numFeatures = FeaturesConv::GetMoveNumFeatures();
+	header.numPositions = positions.size();
+
+	outfile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	// the dataset is read sequentially, so we have to shuffle here
+	std::vector<size_t> order(positions.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+
+	auto rng = gRd.MakeMT();
+	std::shuffle(order.begin(), order.end(), rng);
+
+	std::vector<NNMatrixRM> xBlocks(DatasetConversionChunkSize);
+	std::vector<NNMatrixRM> yBlocks(DatasetConversionChunkSize);
+
+	double startTime = CurrentTime();
+
+	for (size_t chunkStart = 0; chunkStart < order.size(); chunkStart += DatasetConversionChunkSize)
+	{
+		int64_t chunkSize = std::min(DatasetConversionChunkSize, order.size() - chunkStart);
+
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (int64_t i = 0; i < chunkSize; ++i)
+		{
+			size_t idx = order[chunkStart + i];
+			ConvertLabeledPosition_(positions[idx], bestMoves[idx], xBlocks[i], yBlocks[i]);
+		}
+
+		for (int64_t i = 0; i < chunkSize; ++i)
 		{
-			size_t idx = positionDrawFunc();
-			Board pos = Board(positions[idx]);
-			Move bestMove = pos.ParseMove(bestMoves[idx]);
+			uint32_t numRows = xBlocks[i].rows();
+
+			outfile.write(reinterpret_cast<const char *>(&numRows), sizeof(numRows));
+			outfile.write(reinterpret_cast<const char *>(xBlocks[i].data()), xBlocks[i].size() * sizeof(float));
+			outfile.write(reinterpret_cast<const char *>(yBlocks[i].data()), yBlocks[i].size() * sizeof(float));
+		}
 
-			MoveList ml;
-			pos.GenerateAllLegalMoves<Board::ALL>(ml);
+		std::cout << (chunkStart + chunkSize) << "/" << order.size() << " positions converted (" <<
+					 ((chunkStart + chunkSize) / (CurrentTime() - startTime)) << " positions/s)" << std::endl;
+	}
+
+	if (!outfile)
+	{
+		throw std::runtime_error(std::string("Failed to write to ") + filename);
+	}
+}
+
+void ANNMoveEvaluator::TrainFromDataset(const std::string &filename)
+{
+	std::ifstream infile(filename, std::ios::binary);
+
+	if (!infile)
+	{
+		throw std::runtime_error(std::string("Cannot open ") + filename + " for reading");
+	}
 
-			NNMatrixRM trainingSetBatch;
-			std::vector<float> trainingTargetBatch;
+	DatasetHeader header;
+	infile.read(reinterpret_cast<char *>(&header), sizeof(header));
 
-			FeaturesConv::ConvertMovesInfo convInfo;
+	int64_t numFeatures = FeaturesConv::GetMoveNumFeatures();
 
-			GenerateMoveConvInfo_(pos, ml, convInfo);
+	if (!infile || header.magic != DatasetMagic || header.version != DatasetVersion)
+	{
+		throw std::runtime_error(filename + " is not a move evaluator dataset (or is from an incompatible version)");
+	}
+
+	if (header.numFeatures != numFeatures)
+	{
+		throw std::runtime_error(filename + " has " + std::to_string(header.numFeatures) + " features, expected " + std::to_string(numFeatures));
+	}
+
+	if (header.numPositions == 0)
+	{
+		throw std::runtime_error(filename + " has no positions");
+	}
 
-			FeaturesConv::ConvertMovesToNN(pos, convInfo, ml, trainingSetBatch);
+	std::cout << "Streaming " << header.numPositions << " positions from " << filename << std::endl;
 
-			for (size_t moveNum = 0; moveNum < ml.GetSize(); ++moveNum)
+	size_t positionsPerBatch = std::min<size_t>(header.numPositions, PositionsPerMinibatch);
+
+	// a short read anywhere means the file is truncated, and we would be training on stale buffers
+	auto readOrThrow = [&](void *dst, size_t size)
+	{
+		if (!infile.read(reinterpret_cast<char *>(dst), size))
+		{
+			throw std::runtime_error(filename + " is truncated");
+		}
+	};
+
+	// these grow to the largest minibatch seen, and are reused
+	std::vector<float> xBuf;
+	std::vector<float> yBuf;
+
+	uint64_t positionsInEpoch = 0;
+
+	TrainLoop_([&](NNMatrixRM &x, NNMatrixRM &y)
+	{
+		size_t totalRows = 0;
+
+		for (size_t positionNum = 0; positionNum < positionsPerBatch; ++positionNum)
+		{
+			if (positionsInEpoch == header.numPositions)
 			{
-				if (bestMove == ml[moveNum])
-				{
-					trainingTargetBatch.push_back(1.0f);
-				}
-				else
-				{
-					trainingTargetBatch.push_back(0.0f);
-				}
+				// end of dataset - start the next epoch
+				infile.seekg(sizeof(header));
+				positionsInEpoch = 0;
 			}
 
-			assert(static_cast<size_t>(trainingSetBatch.rows()) == trainingTargetBatch.size());
+			uint32_t numRows;
 
-			#pragma omp critical(trainingSetInsert)
+			readOrThrow(&numRows, sizeof(numRows));
+
+			if (xBuf.size() < ((totalRows + numRows) * numFeatures))
 			{
-				int64_t origNumExamples = trainingSet.rows();
+				xBuf.resize((totalRows + numRows) * numFeatures);
+				yBuf.resize(totalRows + numRows);
+			}
 
-				NNMatrixRM orig = trainingSet;
+			readOrThrow(xBuf.data() + totalRows * numFeatures, numRows * numFeatures * sizeof(float));
+			readOrThrow(yBuf.data() + totalRows, numRows * sizeof(float));
 
-				trainingSet.resize(trainingSet.rows() + trainingSetBatch.rows(), trainingSetBatch.cols());
+			totalRows += numRows;
+			++positionsInEpoch;
+		}
 
-				if (origNumExamples != 0)
-				{
-					// we have to copy the original over again because resize invalidates everything
-					trainingSet.block(0, 0, origNumExamples, trainingSet.cols()) = orig;
-				}
+		if (totalRows == 0)
+		{
+			throw std::runtime_error(filename + " has no moves in a whole minibatch");
+		}
+
+		x = Eigen::Map<NNMatrixRM>(xBuf.data(), totalRows, numFeatures);
+		y = Eigen::Map<NNMatrixRM>(yBuf.data(), totalRows, 1);
+	});
+}
+
+void ANNMoveEvaluator::ConvertLabeledPosition_(const std::string &position, const std::string &bestMove, NNMatrixRM &x, NNMatrixRM &y)
+{
+	Board pos(position);
+	Move bm = pos.ParseMove(bestMove);
+
+	MoveList ml;
+	pos.GenerateAllLegalMoves<Board::ALL>(ml);
+
+	FeaturesConv::ConvertMovesInfo convInfo;
+
+	GenerateMoveConvInfo_(pos, ml, convInfo);
+
+	FeaturesConv::ConvertMovesToNN(pos, convInfo, ml, x);
+
+	y.resize(ml.GetSize(), 1);
+
+	for (size_t moveNum = 0; moveNum < ml.GetSize(); ++moveNum)
+	{
+		y(moveNum, 0) = (bm == ml[moveNum]) ? 1.0f : 0.0f;
+	}
+
+	assert(x.rows() == y.rows());
+}
+
+void ANNMoveEvaluator::AssembleMinibatch_(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves,
+										  const std::vector<size_t> &indices, NNMatrixRM &x, NNMatrixRM &y)
+{
+	int64_t numPositions = indices.size();
+
+	// each position is converted into its own block, so threads don't have to synchronize
+	std::vector<NNMatrixRM> xBlocks(numPositions);
+	std::vector<NNMatrixRM> yBlocks(numPositions);
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int64_t i = 0; i < numPositions; ++i)
+	{
+		ConvertLabeledPosition_(positions[indices[i]], bestMoves[indices[i]], xBlocks[i], yBlocks[i]);
+	}
+
+	int64_t totalRows = 0;
+
+	for (const auto &block : xBlocks)
+	{
+		totalRows += block.rows();
+	}
+
+	// then we only have to allocate and copy once
+	x.resize(totalRows, FeaturesConv::GetMoveNumFeatures());
+	y.resize(totalRows, 1);
+
+	int64_t row = 0;
+
+	for (int64_t i = 0; i < numPositions; ++i)
+	{
+		x.block(row, 0, xBlocks[i].rows(), x.cols()) = xBlocks[i];
+		y.block(row, 0, yBlocks[i].rows(), 1) = yBlocks[i];
+		row += xBlocks[i].rows();
+	}
+}
+
+void ANNMoveEvaluator::TrainLoop_(std::function<void (NNMatrixRM &x, NNMatrixRM &y)> getBatch)
+{
+	NNMatrixRM trainingSet;
+	NNMatrixRM trainingTarget;
+
+	double startTime = CurrentTime();
+	double assemblyTime = 0.0;
+	uint64_t numExamples = 0;
+
+	for (size_t iter = 0; iter < NumTrainingIterations; ++iter)
+	{
+		if ((iter % IterationsPerPrint) == 0)
+		{
+			double elapsed = CurrentTime() - startTime;
 
-				trainingSet.block(origNumExamples, 0, trainingSetBatch.rows(), trainingSet.cols()) = trainingSetBatch;
+			std::cout << iter << "/" << NumTrainingIterations;
 
-				trainingTarget.insert(trainingTarget.end(), trainingTargetBatch.begin(), trainingTargetBatch.end());
+			if (iter != 0)
+			{
+				std::cout << " Examples/s: " << (numExamples / elapsed) <<
+							 " (assembly only: " << (numExamples / assemblyTime) << ")";
 			}
+
+			std::cout << std::endl;
 		}
 
-		NNMatrixRM yNN;
-		TargetsToYNN(trainingTarget, yNN);
+		double assemblyStartTime = CurrentTime();
+
+		getBatch(trainingSet, trainingTarget);
 
-		assert(trainingSet.rows() == yNN.rows());
+		assemblyTime += CurrentTime() - assemblyStartTime;
+		numExamples += trainingSet.rows();
 
-		m_ann.Train(trainingSet, yNN);
+		assert(trainingSet.rows() == trainingTarget.rows());
+
+		m_ann.Train(trainingSet, trainingTarget);
 	}
+
+	InvalidateCache_();
 }
 
 void ANNMoveEvaluator::Test(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves)
@@ -211,6 +412,8 @@ void ANNMoveEvaluator::Test(const std::vector<std::string> &positions, const std
 
 void ANNMoveEvaluator::EvaluateMoves(Board &board, SearchInfo &si, MoveInfoList &list, MoveList &ml)
 {
+	Profiling::ScopedTimer timer(Profiling::MOVE_EVAL);
+
 	if (si.isQS || si.totalNodeBudget < MinimumNodeBudget)
 	{
 		// delegate to the static evaluator if it's QS, or if we are close to leaf
@@ -229,15 +432,15 @@ void ANNMoveEvaluator::EvaluateMoves(Board &board, SearchInfo &si, MoveInfoList
 	// we need this even if it's a cache hit, because this is where we compute SEE scores
 	GenerateMoveConvInfo_(board, ml, convInfo);
 
-	// we can only cache NN prop results because killers, etc, can change
-	using NNCacheEntry = std::pair<uint64_t, NNMatrixRM>;
-
-	static const size_t MevalCacheSize = 65536;
-	static std::vector<NNCacheEntry> cache(MevalCacheSize);
+	NNCacheEntry &entry = m_cache[board.GetHash() & m_cacheMask];
 
-	static NNCacheEntry &entry = cache[board.GetHash() % MevalCacheSize];
+	Counters::Inc(Counters::MOVE_EVAL_CACHE_PROBES);
 
-	if (entry.first != board.GetHash())
+	if (entry.first == board.GetHash())
+	{
+		Counters::Inc(Counters::MOVE_EVAL_CACHE_HITS);
+	}
+	else
 	{
 		NNMatrixRM xNN;
 
@@ -246,6 +449,8 @@ void ANNMoveEvaluator::EvaluateMoves(Board &board, SearchInfo &si, MoveInfoList
 		entry.first = board.GetHash();
 		entry.second = *m_ann.ForwardMultiple(xNN);
 
+		Counters::Inc(Counters::NN_FORWARDS, xNN.rows());
+
 		// scale to max 1 (NOT normalize)
 		entry.second /= entry.second.maxCoeff();
 	}
@@ -388,6 +593,20 @@ void ANNMoveEvaluator::PrintDiag(Board &b)
 	}
 }
 
+size_t ANNMoveEvaluator::SetCacheSize(size_t bytes)
+{
+	size_t numEntries = FloorPowerOf2(std::max<size_t>(bytes / EstimatedCacheEntrySize, 1));
+
+	if (numEntries != m_cache.size())
+	{
+		// swap to actually release memory when shrinking
+		std::vector<NNCacheEntry>(numEntries).swap(m_cache);
+		m_cacheMask = numEntries - 1;
+	}
+
+	return numEntries * EstimatedCacheEntrySize;
+}
+
 void ANNMoveEvaluator::Serialize(const std::string &filename)
 {
 	m_ann.Save(filename);
@@ -396,6 +615,16 @@ void ANNMoveEvaluator::Serialize(const std::string &filename)
 void ANNMoveEvaluator::Deserialize(const std::string &filename)
 {
 	m_ann.Load(filename);
+
+	InvalidateCache_();
+}
+
+void ANNMoveEvaluator::InvalidateCache_()
+{
+	for (auto &entry : m_cache)
+	{
+		entry.first = 0;
+	}
 }
 
 void ANNMoveEvaluator::GenerateMoveConvInfo_(Board &board, MoveList &ml, FeaturesConv::ConvertMovesInfo &convInfo)
@@ -403,10 +632,6 @@ void ANNMoveEvaluator::GenerateMoveConvInfo_(Board &board, MoveList &ml, Feature
 	convInfo.see.resize(ml.GetSize());
 	convInfo.nmSee.resize(ml.GetSize());
 
-	for (size_t i = 0; i < ml.GetSize(); ++i)
-	{
-		convInfo.see[i] = SEE::StaticExchangeEvaluation(board, ml[i]);
-
-		convInfo.nmSee[i] = SEE::NMStaticExchangeEvaluation(board, ml[i]);
-	}
+	SEE::BatchEvaluator see(board);
+	see.EvaluateMoves(ml, convInfo.see.data(), convInfo.nmSee.data());
 }
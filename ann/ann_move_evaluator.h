@@ -21,6 +21,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <functional>
 
 #include "move_evaluator.h"
 
@@ -37,24 +38,62 @@ public:
 	// searching
 	const static int64_t MinimumNodeBudget = 10000;
 
+	// number of positions to cache NN outputs for
+	// (must be a power of 2)
+	const static size_t DefaultCacheSize = 65536;
+	static_assert((DefaultCacheSize & (DefaultCacheSize - 1)) == 0, "Move evaluator cache size must be a power of 2");
+
 	ANNMoveEvaluator(ANNEvaluator &annEval);
 
 	void Train(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves);
 
+	// convert (shuffled) positions to NN input format once, and write them to a dataset file
+	// that TrainFromDataset can stream from
+	void WriteDataset(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves, const std::string &filename);
+
+	// same as Train, but streams minibatches from a file written by WriteDataset
+	void TrainFromDataset(const std::string &filename);
+
 	void Test(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves);
 
 	virtual void EvaluateMoves(Board &board, SearchInfo &si, MoveInfoList &list, MoveList &ml);
 
 	virtual void PrintDiag(Board &b) override;
 
+	size_t SetCacheSize(size_t bytes) override;
+
 	void Serialize(const std::string &filename);
 	void Deserialize(const std::string &filename);
 
 private:
 	void GenerateMoveConvInfo_(Board &board, MoveList &ml, FeaturesConv::ConvertMovesInfo &convInfo);
 
+	// convert one labeled position into one row per legal move (target is 1 for the best move, 0 otherwise)
+	void ConvertLabeledPosition_(const std::string &position, const std::string &bestMove, NNMatrixRM &x, NNMatrixRM &y);
+
+	// convert positions[indices[i]] in parallel, and assemble them into one minibatch
+	void AssembleMinibatch_(const std::vector<std::string> &positions, const std::vector<std::string> &bestMoves,
+							const std::vector<size_t> &indices, NNMatrixRM &x, NNMatrixRM &y);
+
+	// the training loop shared by Train and TrainFromDataset
+	// getBatch fills in the next minibatch
+	void TrainLoop_(std::function<void (NNMatrixRM &x, NNMatrixRM &y)> getBatch);
+
+	void InvalidateCache_();
+
 	ANN m_ann;
 
+	// we can only cache NN prop results because killers, etc, can change
+	// each entry holds one output per legal move
+	using NNCacheEntry = std::pair<uint64_t, NNMatrixRM>;
+
+	// used to convert a memory budget to number of entries (assuming about 40 legal moves per position)
+	const static size_t EstimatedCacheEntrySize = sizeof(NNCacheEntry) + 40 * sizeof(float);
+
+	// the size is always a power of 2, so we can index with a mask
+	std::vector<NNCacheEntry> m_cache;
+	size_t m_cacheMask;
+
 	// we need to have an ANN evaluator to generate signatures
 	ANNEvaluator &m_annEval;
 };
@@ -28,6 +28,7 @@
 #include <Eigen/Core>
 
 #include "matrix_ops.h"
+#include "profiling.h"
 
 class Module
 {
@@ -55,6 +56,8 @@ public:
 	template <typename Derived>
 	float ForwardSingle(const Eigen::MatrixBase<Derived> &v)
 	{
+		Profiling::ScopedTimer timer(Profiling::NN_FORWARD);
+
 		m_inputSingle = v;
 		NNVector *ret = m_module->ForwardSingle(&m_inputSingle);
 
@@ -65,6 +68,9 @@ public:
 	NNMatrixRM *ForwardMultiple(const Eigen::MatrixBase<Derived> &x, bool useTorch = false)
 	{
 		assert(!useTorch);
+
+		Profiling::ScopedTimer timer(Profiling::NN_FORWARD);
+
 		m_input = x;
 		return m_module->Forward(&m_input);
 	}
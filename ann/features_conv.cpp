@@ -20,6 +20,7 @@
 #include <functional>
 #include <iomanip>
 
+#include "profiling.h"
 #include "see.h"
 #include "move.h"
 
@@ -542,6 +543,8 @@ namespace FeaturesConv
 template <typename T>
 void ConvertBoardToNN(Board &board, std::vector<T> &ret)
 {
+	Profiling::ScopedTimer timer(Profiling::CONVERT_BOARD_TO_NN);
+
 	ret.clear(); // this shouldn't actually deallocate memory
 
 	// we flip boards vertically when it's BLACK to move, so that the
@@ -719,6 +722,8 @@ void ConvertMovesToNN(Board &board, ConvertMovesInfo &convInfo, MoveList &ml, NN
 
 	Color stm = board.GetSideToMove();
 
+	Board::GivesCheckInfo gci = board.ComputeGivesCheckInfo();
+
 	for (size_t moveNum = 0; moveNum < ml.GetSize(); ++moveNum)
 	{
 		moveFeatures.clear();
@@ -735,7 +740,7 @@ void ConvertMovesToNN(Board &board, ConvertMovesInfo &convInfo, MoveList &ml, NN
 
 		moveFeatures.push_back(board.IsViolent(mv) ? 1.0f : 0.0f);
 
-		moveFeatures.push_back(board.IsChecking(mv) ? 1.0f : 0.0f);
+		moveFeatures.push_back(board.GivesCheck(mv, gci) ? 1.0f : 0.0f);
 
 		moveFeatures.push_back(convInfo.see[moveNum] > 0 ? 1.0f : 0.0f);
 		moveFeatures.push_back(convInfo.see[moveNum] < 0 ? 1.0f : 0.0f);
@@ -24,18 +24,25 @@
 #include "timeallocator.h"
 #include "eval/eval.h"
 #include "gtb.h"
+#include "util.h"
 
 Backend::Backend()
 	: m_mode(Backend::EngineMode_force),
 	  m_searchInProgress(false),
+	  m_searchGeneration(0),
 	  m_maxDepth(0),
 	  m_showThinking(false),
 	  m_pondering(false),
+	  m_multiPV(1),
+	  m_ponderMove(0),
+	  m_tablesAdvancedForPonder(false),
 	  m_whiteClock(ChessClock::CONVENTIONAL_INCREMENTAL_MODE, 0, 300, 0),
 	  m_blackClock(ChessClock::CONVENTIONAL_INCREMENTAL_MODE, 0, 300, 0),
-	  m_tTable(DEFAULT_TTABLE_SIZE / sizeof(TTEntry)),
+	  m_memoryBudget(0),
+	  m_tTable(DEFAULT_TTABLE_SIZE / sizeof(TTEntry), true),
 	  m_evaluator(&Eval::gStaticEvaluator),
-	  m_moveEvaluator(&gStaticMoveEvaluator)
+	  m_moveEvaluator(&gStaticMoveEvaluator),
+	  m_searchThreadPool(SEARCH_THREAD_POOL_SIZE)
 {
 }
 
@@ -105,6 +112,14 @@ void Backend::Usermove(std::string move)
 		return;
 	}
 
+	if (TryPonderHit_(parsedMove))
+	{
+		return;
+	}
+
+	// on a ponder miss the tables have already been advanced by one move, which is still right
+	bool tablesAdvanced = m_tablesAdvancedForPonder;
+
 	StopSearch_(lock);
 
 	m_currentBoard.ApplyMove(parsedMove);
@@ -135,9 +150,12 @@ void Backend::Usermove(std::string move)
 		StartSearch_(Search::SearchType_infinite);
 	}
 
-	m_tTable.AgeTable();
-	m_killer.MoveMade();
-	m_history.NotifyMoveMade();
+	if (!tablesAdvanced)
+	{
+		m_tTable.AgeTable();
+		m_killer.MoveMade();
+		m_history.NotifyMoveMade();
+	}
 }
 
 void Backend::SetBoard(std::string fen)
@@ -146,7 +164,13 @@ void Backend::SetBoard(std::string fen)
 
 	Force_(lock);
 
-	m_currentBoard = Board(fen);
+	const char *error = nullptr;
+
+	if (!m_currentBoard.SetFen(fen, &error))
+	{
+		std::cout << "tellusererror Illegal position (" << error << ")" << std::endl;
+		return;
+	}
 
 	m_tTable.ClearTable();
 }
@@ -230,7 +254,14 @@ void Backend::DebugPrintBoard()
 	std::cout << m_currentBoard.PrintBoard() << std::endl;
 }
 
-void Backend::DebugRunPerft(int32_t depth)
+void Backend::DebugRunPerft(int32_t depth, const ParallelPerft::Config &config)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ParallelPerft::DebugRun(m_currentBoard, depth, config);
+}
+
+void Backend::DebugRunReferencePerft(int32_t depth)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
@@ -273,6 +304,73 @@ std::string Backend::DebugGTB()
 	}
 }
 
+void Backend::SetMemoryBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	bytes = (bytes < MIN_MEMORY_BUDGET) ? MIN_MEMORY_BUDGET : bytes;
+
+	// xboard sends this before every game, and we don't want to throw away the tables every time
+	// (the tables also don't reallocate if their sizes don't change)
+	if (bytes == m_memoryBudget)
+	{
+		return;
+	}
+
+	m_memoryBudget = bytes;
+
+	ApplyMemoryBudget_(lock);
+}
+
+void Backend::ReapplyMemoryBudget()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_memoryBudget != 0)
+	{
+		ApplyMemoryBudget_(lock);
+	}
+}
+
+void Backend::SaveTTableSnapshot(const std::string &filename, size_t maxEntries)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// the search thread is writing to the table
+	StopSearch_(lock);
+
+	int64_t numEntries = m_tTable.SaveSnapshot(filename, m_evaluator->GetSignature(), maxEntries);
+
+	if (numEntries >= 0)
+	{
+		std::cout << "# Saved " << numEntries << " ttable entries to " << filename << std::endl;
+	}
+
+	if (m_mode == EngineMode_analyzing)
+	{
+		StartSearch_(Search::SearchType_infinite);
+	}
+}
+
+void Backend::LoadTTableSnapshot(const std::string &filename)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	StopSearch_(lock);
+
+	int64_t numEntries = m_tTable.LoadSnapshot(filename, m_evaluator->GetSignature());
+
+	if (numEntries >= 0)
+	{
+		std::cout << "# Loaded " << numEntries << " ttable entries from " << filename << std::endl;
+	}
+
+	if (m_mode == EngineMode_analyzing)
+	{
+		StartSearch_(Search::SearchType_infinite);
+	}
+}
+
 void Backend::Quit()
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
@@ -299,8 +397,45 @@ void Backend::Force_(std::lock_guard<std::mutex> &lock)
 	m_blackClock.Stop();
 }
 
+bool Backend::TryPonderHit_(Move move)
+{
+	if (!m_searchInProgress || m_ponderMove == 0 || move != m_ponderMove ||
+		!(m_mode == EngineMode_playingWhite || m_mode == EngineMode_playingBlack))
+	{
+		return false;
+	}
+
+	m_currentBoard.ApplyMove(move);
+
+	// we only ponder on positions where the game is still going, so we don't have to check for game end here
+
+	ChessClock &engineClock = (m_mode == EngineMode_playingWhite) ? m_whiteClock : m_blackClock;
+	ChessClock &opponentClock = (m_mode == EngineMode_playingWhite) ? m_blackClock : m_whiteClock;
+
+	if (!m_search->PonderHit(AllocateTime(engineClock)))
+	{
+		// the ponder search ended on its own (eg. depth limit), so we have to start a new search
+		m_currentBoard.UndoMove();
+		return false;
+	}
+
+	m_ponderMove = 0;
+
+	// the tables were already advanced when the ponder search started, and the search is still using them
+	m_tablesAdvancedForPonder = false;
+
+	opponentClock.Stop();
+	engineClock.Start();
+	return true;
+}
+
 void Backend::StopSearch_(std::lock_guard<std::mutex> &/*lock*/)
 {
+	++m_searchGeneration;
+
+	m_ponderMove = 0;
+	m_tablesAdvancedForPonder = false;
+
 	if (m_searchInProgress)
 	{
 		m_search->Abort();
@@ -318,10 +453,14 @@ void Backend::StopSearch_(std::lock_guard<std::mutex> &/*lock*/)
 	}
 }
 
-void Backend::StartSearch_(Search::SearchType searchType)
+void Backend::StartSearch_(Search::SearchType searchType, Move ponderMove)
 {
 	m_searchInProgress = true;
 
+	++m_searchGeneration;
+
+	m_ponderMove = ponderMove;
+
 	m_searchContext.reset(new Search::RootSearchContext());
 
 	Search::TimeAllocation tAlloc;
@@ -339,6 +478,11 @@ void Backend::StartSearch_(Search::SearchType searchType)
 	m_searchContext->onePlyDone = false;
 	m_searchContext->stopRequest = false;
 	m_searchContext->startBoard = m_currentBoard;
+
+	if (ponderMove)
+	{
+		m_searchContext->startBoard.ApplyMove(ponderMove);
+	}
 	m_searchContext->nodeCount = 0;
 	m_searchContext->searchType = searchType;
 	m_searchContext->nodeBudget = m_maxDepth == 0 ? 0 : Search::DepthToNodeBudget(m_maxDepth);
@@ -349,6 +493,8 @@ void Backend::StartSearch_(Search::SearchType searchType)
 	m_searchContext->evaluator = m_evaluator;
 	m_searchContext->moveEvaluator = m_moveEvaluator;
 
+	m_searchContext->multiPV = m_multiPV;
+
 	m_searchContext->thinkingOutputFunc =
 	[this](Search::ThinkingOutput &to)
 	{
@@ -406,24 +552,98 @@ void Backend::StartSearch_(Search::SearchType searchType)
 				((m_currentBoard.GetSideToMove() == WHITE && m_mode == EngineMode_playingBlack) ||
 				 (m_currentBoard.GetSideToMove() == BLACK && m_mode == EngineMode_playingWhite)))
 		{
-			// we have to do this in a new thread so that the search thread itself can die
-			auto startPonderThreadFunc = [this]()
+			// we can't start a new search from inside this one, so we queue it to run after this search ends
+			// if anything else has started or stopped a search by then, the ponder request is stale
+			uint64_t generation = m_searchGeneration;
+
+			m_searchThreadPool.Push([this, generation]()
 			{
 				std::lock_guard<std::mutex> lock(m_mutex);
+
+				if (generation != m_searchGeneration)
+				{
+					return;
+				}
+
+				// the second move of our PV is what we expect the opponent to play
+				// if it is played, the ponder search becomes our search for the next move (see TryPonderHit_)
+				std::vector<Move> pv = m_search->GetResult().pv;
+				Move ponderMove = 0;
+
+				if (pv.size() >= 2)
+				{
+					MoveList legalMoves;
+					m_currentBoard.GenerateAllLegalMoves<Board::ALL>(legalMoves);
+
+					if (legalMoves.Exists(pv[1]))
+					{
+						Board afterPonderMove = m_currentBoard;
+						afterPonderMove.ApplyMove(pv[1]);
+
+						if (afterPonderMove.GetGameStatus() == Board::ONGOING)
+						{
+							ponderMove = pv[1];
+						}
+					}
+				}
+
 				StopSearch_(lock);
-				StartSearch_(Search::SearchType_infinite);
-			};
 
-			std::thread t(startPonderThreadFunc);
-			t.detach();
+				if (ponderMove)
+				{
+					// the ponder search starts after the opponent's move, so killer plies have to be shifted
+					// now, and not when the move is actually played (the search would be using them by then)
+					m_tTable.AgeTable();
+					m_killer.MoveMade();
+					m_history.NotifyMoveMade();
+					m_tablesAdvancedForPonder = true;
+				}
+
+				// without a move to ponder on, we still search the current position to fill the ttable
+				StartSearch_(Search::SearchType_infinite, ponderMove);
+			});
 		}
 	};
 
-	m_search.reset(new Search::AsyncSearch(*m_searchContext));
+	m_search.reset(new Search::AsyncSearch(*m_searchContext, m_searchThreadPool, m_timer));
 
 	m_search->Start();
 }
 
+void Backend::ApplyMemoryBudget_(std::lock_guard<std::mutex> &lock)
+{
+	// the search threads use all the tables
+	StopSearch_(lock);
+
+	double startTime = CurrentTime();
+
+	size_t remaining = m_memoryBudget;
+
+	size_t gtbCacheSize = 0;
+
+	if (GTB::IsInitialized())
+	{
+		gtbCacheSize = m_memoryBudget / GTB_CACHE_MEMORY_FRACTION;
+		GTB::SetCacheSize(gtbCacheSize);
+		remaining -= gtbCacheSize;
+	}
+
+	// these return how much they actually use (0 if they don't have a cache)
+	size_t evalHashSize = m_evaluator->SetCacheSize(m_memoryBudget / EVAL_HASH_MEMORY_FRACTION);
+	remaining -= evalHashSize;
+
+	size_t moveEvalCacheSize = m_moveEvaluator->SetCacheSize(m_memoryBudget / MOVE_EVAL_CACHE_MEMORY_FRACTION);
+	remaining -= moveEvalCacheSize;
+
+	// this keeps the entries we have, so a snapshot loaded before the GUI sets the memory budget isn't lost
+	size_t numTTableEntries = m_tTable.Resize(remaining / sizeof(TTEntry));
+
+	std::cout << "# Memory: " << (m_memoryBudget / MB) << " MB (ttable: " << (remaining / MB) << " MB with "
+			  << numTTableEntries << " entries, eval hash: "
+			  << (evalHashSize / MB) << " MB, move eval cache: " << (moveEvalCacheSize / MB) << " MB, GTB cache: "
+			  << (gtbCacheSize / MB) << " MB) in " << (CurrentTime() - startTime) << "s" << std::endl;
+}
+
 bool Backend::CheckDeclareGameResult_()
 {
 	Board::GameStatus gameResult = m_currentBoard.GetGameStatus();
@@ -18,6 +18,7 @@
 #ifndef BACKEND_H
 #define BACKEND_H
 
+#include <algorithm>
 #include <memory>
 #include "mutex_wrapper.h"
 
@@ -29,12 +30,25 @@
 #include "killer.h"
 #include "move_evaluator.h"
 #include "static_move_evaluator.h"
+#include "thread_pool.h"
+#include "deadline_timer.h"
+#include "parallel_perft.h"
 
 class Backend
 {
 public:
 	const static size_t DEFAULT_TTABLE_SIZE = 256*MB; // 256MB
 
+	// when the GUI gives us a memory budget, this is how it's split
+	// the GTB cache only gets a share if tablebases are loaded, and everything left goes to the ttable
+	const static size_t GTB_CACHE_MEMORY_FRACTION = 4; // 1/4
+	const static size_t EVAL_HASH_MEMORY_FRACTION = 32; // 1/32
+	const static size_t MOVE_EVAL_CACHE_MEMORY_FRACTION = 64; // 1/64
+	const static size_t MIN_MEMORY_BUDGET = 8*MB;
+
+	// root search is single-threaded, and jobs are run in order, so one worker is enough
+	const static size_t SEARCH_THREAD_POOL_SIZE = 1;
+
 	enum EngineMode
 	{
 		EngineMode_force,
@@ -64,6 +78,9 @@ public:
 
 	void SetPondering(bool enabled) { std::lock_guard<std::mutex> lock(m_mutex); m_pondering = enabled; }
 
+	// number of lines to show in thinking output (takes effect from the next search)
+	void SetMultiPV(size_t multiPV) { std::lock_guard<std::mutex> lock(m_mutex); m_multiPV = std::max<size_t>(multiPV, 1); }
+
 	void Undo(int32_t moves);
 
 	void SetTimeControl(const ChessClock &cc)
@@ -80,8 +97,21 @@ public:
 
 	MoveEvaluatorIface *GetMoveEvaluator() { return m_moveEvaluator; }
 
+	// total size of ttable, eval hash, move evaluator cache, and GTB cache
+	// this stops any ongoing search, and clears all the tables
+	void SetMemoryBudget(size_t bytes);
+
+	// recompute the split, eg. after tablebases are loaded (nothing is done if no budget has been set)
+	void ReapplyMemoryBudget();
+
+	// see TTable::SaveSnapshot() and TTable::LoadSnapshot()
+	// snapshots are tied to the current evaluator
+	void SaveTTableSnapshot(const std::string &filename, size_t maxEntries);
+	void LoadTTableSnapshot(const std::string &filename);
+
 	void DebugPrintBoard();
-	void DebugRunPerft(int32_t depth);
+	void DebugRunPerft(int32_t depth, const ParallelPerft::Config &config);
+	void DebugRunReferencePerft(int32_t depth);
 	void DebugRunPerftWithNull(int32_t depth);
 	Score DebugEval();
 	void PrintDebugEval();
@@ -103,11 +133,18 @@ private:
 	void Force_(std::lock_guard<std::mutex> &lock);
 	void StopSearch_(std::lock_guard<std::mutex> &lock);
 
-	void StartSearch_(Search::SearchType searchType);
+	// if ponderMove is not 0, the search starts from the position after ponderMove is made
+	void StartSearch_(Search::SearchType searchType, Move ponderMove = 0);
+
+	// if we are pondering on the move the opponent just made, convert the ponder search to a normal search
+	// returns false if it's not a ponder hit (or the ponder search already ended)
+	bool TryPonderHit_(Move move);
 
 	// returns whether the game is still ongoing
 	bool CheckDeclareGameResult_();
 
+	void ApplyMemoryBudget_(std::lock_guard<std::mutex> &lock);
+
 	std::mutex m_mutex;
 
 	EngineMode m_mode;
@@ -116,6 +153,10 @@ private:
 	std::unique_ptr<Search::AsyncSearch> m_search;
 	std::unique_ptr<Search::RootSearchContext> m_searchContext;
 
+	// incremented every time a search is started or stopped, so queued jobs can tell
+	// whether the search they were queued for is still the latest one
+	uint64_t m_searchGeneration;
+
 	// this is the max depth set by the protocol
 	// we aren't doing depth limited search, so we have to convert it to node budget
 	// when we actually do a search
@@ -125,15 +166,33 @@ private:
 
 	bool m_pondering;
 
+	size_t m_multiPV;
+
+	// the opponent move the current ponder search assumes (0 if we are not pondering on a move)
+	Move m_ponderMove;
+
+	// whether killers, history and ttable age have already been advanced for the opponent's move
+	// (done when a ponder search on a move starts, since its root is already after that move)
+	bool m_tablesAdvancedForPonder;
+
 	ChessClock m_whiteClock;
 	ChessClock m_blackClock;
 
+	// 0 if the GUI hasn't set one (all tables are at default sizes)
+	size_t m_memoryBudget;
+
 	TTable m_tTable;
 	Killer m_killer;
 	History m_history;
 
 	EvaluatorIface *m_evaluator;
 	MoveEvaluatorIface *m_moveEvaluator;
+
+	// searches (and anything that has to happen after a search ends, like starting to ponder)
+	// run on these long-lived threads
+	// these are declared last so they are destroyed first, while everything queued jobs use is still alive
+	ThreadPool m_searchThreadPool;
+	DeadlineTimer m_timer;
 };
 
 #endif // BACKEND_H
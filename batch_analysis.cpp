@@ -0,0 +1,430 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batch_analysis.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <cstdio>
+
+#include <omp.h>
+
+#include "mutex_wrapper.h"
+#include "condition_variable_wrapper.h"
+
+#include "board.h"
+#include "search.h"
+#include "ttable.h"
+#include "killer.h"
+#include "history.h"
+#include "util.h"
+
+namespace
+{
+
+// how far ahead of the oldest unfinished position workers are allowed to get
+// this bounds the memory used by the reorder buffer when one position takes much longer than others
+const static uint64_t MaxReorderWindowPerThread = 256;
+
+// how often to print progress (seconds)
+const static double ProgressInterval = 5.0;
+
+// counts complete records in an existing output file, and drops a trailing partial record
+// (from a run that was killed in the middle of a write) if there is one
+uint64_t prepareOutputFile(const std::string &filename)
+{
+	std::ifstream existing(filename, std::ios::binary);
+
+	if (!existing)
+	{
+		return 0;
+	}
+
+	uint64_t numRecords = 0;
+	bool partialRecord = false;
+	std::string line;
+
+	while (std::getline(existing, line))
+	{
+		if (existing.eof())
+		{
+			// getline hit EOF before finding a newline
+			partialRecord = true;
+			break;
+		}
+
+		++numRecords;
+	}
+
+	if (!partialRecord)
+	{
+		return numRecords;
+	}
+
+	std::cout << "Dropping partially written record at the end of " << filename << std::endl;
+
+	existing.clear();
+	existing.seekg(0);
+
+	std::string tmpFilename = filename + ".tmp";
+
+	{
+		std::ofstream tmp(tmpFilename, std::ios::binary);
+
+		for (uint64_t i = 0; i < numRecords; ++i)
+		{
+			std::getline(existing, line);
+			tmp << line << '\n';
+		}
+	}
+
+	existing.close();
+
+	std::remove(filename.c_str());
+
+	if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+	{
+		throw std::runtime_error(std::string("Failed to rename ") + tmpFilename + " to " + filename);
+	}
+
+	return numRecords;
+}
+
+// b is taken by value because we play out the PV on it
+std::string formatResult(Board b, const Search::SearchResult &result, double time)
+{
+	std::stringstream ss;
+
+	ss << b.GetFen(true);
+
+	if (result.pv.empty())
+	{
+		// game is already over
+		ss << " bm none;";
+	}
+	else
+	{
+		ss << " bm " << b.MoveToAlg(result.pv[0], Board::SAN) << ';';
+	}
+
+	ss << " ce " << static_cast<int64_t>(result.score * 0.1f) << ';';
+	ss << " acn " << result.nodeCount << ';';
+	ss << " acs " << time << ';';
+
+	if (!result.pv.empty())
+	{
+		ss << " pv";
+
+		for (auto const &mv : result.pv)
+		{
+			ss << ' ' << b.MoveToAlg(mv, Board::SAN);
+			b.ApplyMove(mv);
+		}
+
+		ss << ';';
+	}
+
+	return ss.str();
+}
+
+// written in place of a result for lines that are not valid positions, so the output still has
+// one record per input line (resuming relies on that)
+std::string formatError(const std::string &line, const char *error)
+{
+	std::stringstream ss;
+
+	ss << "error \"" << error << "\"; input \"";
+
+	for (char c : line)
+	{
+		// keep the record on one line, and keep the quoting intact
+		if (c == '"' || static_cast<unsigned char>(c) < 0x20)
+		{
+			ss << '?';
+		}
+		else
+		{
+			ss << c;
+		}
+	}
+
+	ss << "\";";
+
+	return ss.str();
+}
+
+// collects results from workers, and writes them out in input order
+class ReorderBuffer
+{
+public:
+	ReorderBuffer(std::ostream &os, uint64_t firstIndex, uint64_t maxWindow)
+		: m_os(os), m_nextToWrite(firstIndex), m_maxWindow(maxWindow)
+	{}
+
+	// blocks until index is within the reorder window
+	void WaitForSlot(uint64_t index)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (index >= (m_nextToWrite + m_maxWindow))
+		{
+			m_cvWritten.wait(lock);
+		}
+	}
+
+	void Add(uint64_t index, std::string record)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_pending[index] = std::move(record);
+
+		bool written = false;
+
+		for (auto it = m_pending.begin(); it != m_pending.end() && it->first == m_nextToWrite; it = m_pending.erase(it))
+		{
+			m_os << it->second << '\n';
+			++m_nextToWrite;
+			written = true;
+		}
+
+		if (written)
+		{
+			m_os.flush();
+			m_cvWritten.notify_all();
+		}
+	}
+
+	uint64_t NextToWrite()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_nextToWrite;
+	}
+
+private:
+	std::ostream &m_os;
+
+	uint64_t m_nextToWrite;
+	uint64_t m_maxWindow;
+
+	std::map<uint64_t, std::string> m_pending;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cvWritten;
+};
+
+}
+
+namespace BatchAnalysis
+{
+
+void Run(const std::string &inFilename, const std::string &outFilename, const Config &config,
+		 EvaluatorIface *evaluator, ANNEvaluator *annEvaluator, MoveEvaluatorIface *moveEvaluator)
+{
+	std::ifstream infile(inFilename);
+
+	if (!infile)
+	{
+		throw std::runtime_error(std::string("Cannot open ") + inFilename + " for reading");
+	}
+
+	uint64_t numDone = prepareOutputFile(outFilename);
+
+	std::ofstream outfile(outFilename, std::ios::app | std::ios::binary);
+
+	if (!outfile)
+	{
+		throw std::runtime_error(std::string("Cannot open ") + outFilename + " for writing");
+	}
+
+	// skip positions we already have results for
+	uint64_t nextIndex = 0;
+	std::string line;
+
+	while (nextIndex < numDone && std::getline(infile, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+
+		++nextIndex;
+	}
+
+	if (numDone > 0)
+	{
+		std::cout << "Resuming after " << numDone << " positions" << std::endl;
+	}
+
+	int numThreads = config.numThreads > 0 ? config.numThreads : omp_get_max_threads();
+
+	std::cout << "Analyzing " << inFilename << " with " << numThreads << " thread(s), node budget " << config.nodeBudget;
+
+	if (config.maxTime > 0.0)
+	{
+		std::cout << ", max time " << config.maxTime << "s";
+	}
+
+	std::cout << std::endl;
+
+	ReorderBuffer reorderBuffer(outfile, numDone, MaxReorderWindowPerThread * numThreads);
+
+	std::mutex inputMutex;
+
+	std::string evaluatorParams;
+
+	if (annEvaluator)
+	{
+		evaluatorParams = annEvaluator->ToString();
+	}
+
+	std::vector<double> threadBusyTime(numThreads, 0.0);
+	std::vector<uint64_t> threadPositions(numThreads, 0);
+	std::vector<uint64_t> threadNodes(numThreads, 0);
+
+	Periodic progressPrinter(ProgressInterval);
+
+	double startTime = CurrentTime();
+
+	#pragma omp parallel num_threads(numThreads)
+	{
+		int threadId = omp_get_thread_num();
+
+		// everything a worker needs lives for the whole run
+		std::unique_ptr<ANNEvaluator> threadAnnEvaluator;
+		EvaluatorIface *threadEvaluator = evaluator;
+
+		if (annEvaluator)
+		{
+			threadAnnEvaluator.reset(new ANNEvaluator);
+			threadAnnEvaluator->FromString(evaluatorParams);
+			threadEvaluator = threadAnnEvaluator.get();
+		}
+
+		TTable ttable(config.ttableSize / sizeof(TTEntry), false);
+		Killer killer;
+		History history;
+
+		Board b;
+		std::string fen;
+
+		while (true)
+		{
+			uint64_t index;
+
+			{
+				std::lock_guard<std::mutex> lock(inputMutex);
+
+				bool gotLine = false;
+
+				while (std::getline(infile, fen))
+				{
+					if (!fen.empty())
+					{
+						gotLine = true;
+						break;
+					}
+				}
+
+				if (!gotLine)
+				{
+					break;
+				}
+
+				index = nextIndex++;
+			}
+
+			reorderBuffer.WaitForSlot(index);
+
+			double positionStartTime = CurrentTime();
+
+			const char *fenError;
+
+			if (!b.SetFen(fen, &fenError))
+			{
+				reorderBuffer.Add(index, formatError(fen, fenError));
+				continue;
+			}
+
+			Search::SearchResult result;
+			result.score = 0;
+			result.nodeCount = 0;
+
+			Board::GameStatus status = b.GetGameStatus();
+
+			if (status == Board::WHITE_WINS || status == Board::BLACK_WINS)
+			{
+				// the game can only be over by checkmate if the side to move is mated
+				result.score = MATE_OPPONENT_SIDE;
+			}
+			else if (status == Board::ONGOING)
+			{
+				// each position is searched from a clean state, so results don't depend on scheduling
+				ttable.InvalidateAllEntries();
+				killer.Clear();
+				history.Clear();
+
+				result = Search::SyncSearchTimeLimited(b, config.maxTime, config.nodeBudget, threadEvaluator, moveEvaluator, &killer, &ttable, &history);
+			}
+
+			double positionTime = CurrentTime() - positionStartTime;
+
+			reorderBuffer.Add(index, formatResult(b, result, positionTime));
+
+			threadBusyTime[threadId] += positionTime;
+			++threadPositions[threadId];
+			threadNodes[threadId] += result.nodeCount;
+
+			if (threadId == 0)
+			{
+				progressPrinter.Call([&]()
+				{
+					uint64_t written = reorderBuffer.NextToWrite();
+					double elapsed = CurrentTime() - startTime;
+					std::cout << "Positions: " << written << " (" << static_cast<double>(written - numDone) / elapsed << "/s)" << std::endl;
+				});
+			}
+		}
+	}
+
+	double totalTime = CurrentTime() - startTime;
+
+	uint64_t numAnalyzed = reorderBuffer.NextToWrite() - numDone;
+
+	uint64_t totalNodes = 0;
+	for (auto nodes : threadNodes)
+	{
+		totalNodes += nodes;
+	}
+
+	std::cout << "Positions analyzed: " << numAnalyzed << std::endl;
+	std::cout << "Total time: " << totalTime << "s" << std::endl;
+	std::cout << "Positions per second: " << (static_cast<double>(numAnalyzed) / totalTime) << std::endl;
+	std::cout << "Nodes per second: " << (static_cast<double>(totalNodes) / totalTime) << std::endl;
+
+	for (int i = 0; i < numThreads; ++i)
+	{
+		std::cout << "Thread " << i << ": " << threadPositions[i] << " positions, " <<
+					 (100.0 * threadBusyTime[i] / totalTime) << "% busy" << std::endl;
+	}
+}
+
+}
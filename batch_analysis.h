@@ -0,0 +1,61 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCH_ANALYSIS_H
+#define BATCH_ANALYSIS_H
+
+#include <string>
+
+#include "types.h"
+#include "evaluator.h"
+#include "move_evaluator.h"
+#include "ann/ann_evaluator.h"
+
+// streaming batch analysis of EPD/FEN files
+// each input line is searched by a persistent pool of workers, and one EPD record per input
+// line is written in input order:
+// <fen> bm <SAN>; ce <centipawns>; acn <nodes>; acs <seconds>; pv <SAN moves>;
+// positions where the game is already over get "bm none" (and a mated ce if the side to move is checkmated),
+// and lines that are not valid positions get: error "<message>"; input "<line>";
+// since output is written as soon as it's in order, an interrupted run can be resumed
+// by running it again with the same output file
+namespace BatchAnalysis
+{
+
+struct Config
+{
+	NodeBudget nodeBudget = 1000;
+
+	// max time per position in seconds (0 = only limited by node budget)
+	double maxTime = 0.0;
+
+	// per worker
+	size_t ttableSize = 4*MB;
+
+	// 0 = use all OpenMP threads
+	int numThreads = 0;
+};
+
+// if annEvaluator is not null, each worker gets its own copy of it (they are not thread-safe)
+// otherwise evaluator is shared by all workers
+// moveEvaluator is always shared, so it must be thread-safe
+void Run(const std::string &inFilename, const std::string &outFilename, const Config &config,
+		 EvaluatorIface *evaluator, ANNEvaluator *annEvaluator, MoveEvaluatorIface *moveEvaluator);
+
+}
+
+#endif // BATCH_ANALYSIS_H
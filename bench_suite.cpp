@@ -0,0 +1,900 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bench_suite.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+#include <cmath>
+#include <cstdlib>
+
+#include "board.h"
+#include "history.h"
+#include "killer.h"
+#include "learn.h"
+#include "search.h"
+#include "ttable.h"
+#include "util.h"
+
+namespace
+{
+
+const static int JsonVersion = 1;
+
+// NPS of very short searches is mostly noise
+const static double MinTimeForNPS = 0.01;
+
+// significance threshold for the t-statistic of mean log ratios (about 99% two-sided), and
+// for chi-squared of solve rate changes (McNemar's test, 95%)
+const static double TThreshold = 2.58;
+const static double ChiSquaredThreshold = 3.84;
+
+// changes smaller than this are not flagged even if significant
+const static double MinEffect = 0.005;
+
+struct JsonValue
+{
+	enum Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	JsonValue() : type(Null), boolean(false), number(0.0) {}
+
+	Type type;
+	bool boolean;
+	double number;
+	std::string str;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	// returns a null value if not found
+	const JsonValue &operator[](const std::string &key) const
+	{
+		static const JsonValue NullValue;
+
+		for (const auto &member : object)
+		{
+			if (member.first == key)
+			{
+				return member.second;
+			}
+		}
+
+		return NullValue;
+	}
+};
+
+// just enough JSON for our own files
+class JsonParser
+{
+public:
+	JsonParser(const std::string &text) : m_text(text), m_pos(0) {}
+
+	bool Parse(JsonValue &value)
+	{
+		return ParseValue_(value) && (SkipWhitespace_(), m_pos == m_text.size());
+	}
+
+	size_t GetPos() const { return m_pos; }
+
+private:
+	void SkipWhitespace_()
+	{
+		while (m_pos < m_text.size() && isspace(m_text[m_pos]))
+		{
+			++m_pos;
+		}
+	}
+
+	bool Consume_(const std::string &token)
+	{
+		if (m_text.compare(m_pos, token.size(), token) == 0)
+		{
+			m_pos += token.size();
+			return true;
+		}
+
+		return false;
+	}
+
+	bool ParseString_(std::string &str)
+	{
+		if (!Consume_("\""))
+		{
+			return false;
+		}
+
+		str.clear();
+
+		while (m_pos < m_text.size())
+		{
+			char c = m_text[m_pos++];
+
+			if (c == '"')
+			{
+				return true;
+			}
+			else if (c == '\\')
+			{
+				if (m_pos >= m_text.size())
+				{
+					return false;
+				}
+
+				char escaped = m_text[m_pos++];
+
+				switch (escaped)
+				{
+				case 'n': str += '\n'; break;
+				case 't': str += '\t'; break;
+				case 'r': str += '\r'; break;
+				case 'b': str += '\b'; break;
+				case 'f': str += '\f'; break;
+				case 'u':
+					// we never write these, and only need ASCII
+					if (m_pos + 4 > m_text.size())
+					{
+						return false;
+					}
+
+					str += static_cast<char>(strtol(m_text.substr(m_pos, 4).c_str(), nullptr, 16));
+					m_pos += 4;
+					break;
+				default: str += escaped; break;
+				}
+			}
+			else
+			{
+				str += c;
+			}
+		}
+
+		return false;
+	}
+
+	bool ParseValue_(JsonValue &value)
+	{
+		SkipWhitespace_();
+
+		if (m_pos >= m_text.size())
+		{
+			return false;
+		}
+
+		char c = m_text[m_pos];
+
+		if (c == '{')
+		{
+			++m_pos;
+			value.type = JsonValue::Object;
+
+			SkipWhitespace_();
+
+			if (Consume_("}"))
+			{
+				return true;
+			}
+
+			while (true)
+			{
+				std::pair<std::string, JsonValue> member;
+
+				SkipWhitespace_();
+
+				if (!ParseString_(member.first))
+				{
+					return false;
+				}
+
+				SkipWhitespace_();
+
+				if (!Consume_(":") || !ParseValue_(member.second))
+				{
+					return false;
+				}
+
+				value.object.push_back(std::move(member));
+
+				SkipWhitespace_();
+
+				if (Consume_("}"))
+				{
+					return true;
+				}
+				else if (!Consume_(","))
+				{
+					return false;
+				}
+			}
+		}
+		else if (c == '[')
+		{
+			++m_pos;
+			value.type = JsonValue::Array;
+
+			SkipWhitespace_();
+
+			if (Consume_("]"))
+			{
+				return true;
+			}
+
+			while (true)
+			{
+				value.array.push_back(JsonValue());
+
+				if (!ParseValue_(value.array.back()))
+				{
+					return false;
+				}
+
+				SkipWhitespace_();
+
+				if (Consume_("]"))
+				{
+					return true;
+				}
+				else if (!Consume_(","))
+				{
+					return false;
+				}
+			}
+		}
+		else if (c == '"')
+		{
+			value.type = JsonValue::String;
+			return ParseString_(value.str);
+		}
+		else if (Consume_("true"))
+		{
+			value.type = JsonValue::Bool;
+			value.boolean = true;
+			return true;
+		}
+		else if (Consume_("false"))
+		{
+			value.type = JsonValue::Bool;
+			value.boolean = false;
+			return true;
+		}
+		else if (Consume_("null"))
+		{
+			value.type = JsonValue::Null;
+			return true;
+		}
+		else
+		{
+			const char *start = m_text.c_str() + m_pos;
+			char *end = nullptr;
+
+			value.type = JsonValue::Number;
+			value.number = strtod(start, &end);
+
+			if (end == start)
+			{
+				return false;
+			}
+
+			m_pos += end - start;
+
+			return true;
+		}
+	}
+
+	const std::string &m_text;
+	size_t m_pos;
+};
+
+std::string JsonString(const std::string &str)
+{
+	std::string ret = "\"";
+
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+		{
+			ret += '\\';
+			ret += c;
+		}
+		else if (c == '\n')
+		{
+			ret += "\\n";
+		}
+		else if (c == '\t')
+		{
+			ret += "\\t";
+		}
+		else if (static_cast<unsigned char>(c) >= 0x20)
+		{
+			ret += c;
+		}
+	}
+
+	return ret + "\"";
+}
+
+std::string HexStr(uint64_t x)
+{
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << x;
+	return ss.str();
+}
+
+uint64_t ParseHex(const std::string &str)
+{
+	return strtoull(str.c_str(), nullptr, 16);
+}
+
+// FNV-1a
+void HashBytes(uint64_t &hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+std::string Basename(const std::string &path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+
+struct SuiteTotals
+{
+	SuiteTotals() : positions(0), scorable(0), solved(0), nodes(0), time(0.0) {}
+
+	void Add(const BenchSuite::PositionResult &result)
+	{
+		++positions;
+		scorable += result.scorable;
+		solved += result.solved;
+		nodes += result.nodes;
+		time += result.time;
+	}
+
+	double GetNPS() const { return (time > 0.0) ? (nodes / time) : 0.0; }
+
+	size_t positions;
+	size_t scorable;
+	size_t solved;
+	uint64_t nodes;
+	double time;
+};
+
+void PrintTotals(const std::string &name, const SuiteTotals &totals)
+{
+	std::cout << name << ": " << totals.positions << " positions";
+
+	if (totals.scorable > 0)
+	{
+		std::cout << ", solved " << totals.solved << "/" << totals.scorable;
+	}
+
+	std::cout << ", nodes: " << totals.nodes << ", time: " << totals.time << "s, NPS: " << static_cast<uint64_t>(totals.GetNPS()) << std::endl;
+}
+
+std::string TotalsToJson(const SuiteTotals &totals)
+{
+	std::stringstream ss;
+	ss << std::setprecision(9);
+	ss << "\"positions\": " << totals.positions << ", \"scorable\": " << totals.scorable << ", \"solved\": " << totals.solved
+	   << ", \"nodes\": " << totals.nodes << ", \"time\": " << totals.time << ", \"nps\": " << totals.GetNPS();
+	return ss.str();
+}
+
+// mean and t-statistic of a sample (of log ratios)
+struct SampleStats
+{
+	SampleStats(const std::vector<double> &x)
+		: n(x.size()), mean(0.0), stdErr(0.0), t(0.0)
+	{
+		if (n == 0)
+		{
+			return;
+		}
+
+		for (double v : x)
+		{
+			mean += v;
+		}
+
+		mean /= n;
+
+		if (n < 2)
+		{
+			return;
+		}
+
+		double sumSq = 0.0;
+
+		for (double v : x)
+		{
+			sumSq += (v - mean) * (v - mean);
+		}
+
+		stdErr = std::sqrt(sumSq / (n - 1) / n);
+
+		if (stdErr > 0.0)
+		{
+			t = mean / stdErr;
+		}
+		else if (mean != 0.0)
+		{
+			// every position changed by exactly the same ratio
+			t = (mean > 0.0) ? 1e9 : -1e9;
+		}
+	}
+
+	// as percentages
+	double GetChange() const { return 100.0 * (std::exp(mean) - 1.0); }
+	double GetChangeStdErr() const { return 100.0 * std::exp(mean) * stdErr; }
+
+	size_t n;
+	double mean;
+	double stdErr;
+	double t;
+};
+
+}
+
+namespace BenchSuite
+{
+
+std::vector<std::string> GetDefaultSuites()
+{
+	std::vector<std::string> ret;
+
+	ret.push_back("tests/testsuites/WAC.epd");
+	ret.push_back("tests/testsuites/ECM.epd");
+	ret.push_back("tests/testsuites/BKTest.epd");
+	ret.push_back("tests/testsuites/mlmfl.epd");
+	ret.push_back("tests/testsuites/Zugzwang.epd");
+
+	return ret;
+}
+
+bool Run(const Config &config, EvaluatorIface *evaluator, MoveEvaluatorIface *moveEvaluator, Report &report)
+{
+	report.nodeBudget = config.nodeBudget;
+	report.evaluatorSignature = evaluator->GetSignature();
+	report.suites.clear();
+
+	TTable ttable(config.ttableSize / sizeof(TTEntry), false);
+	Killer killer;
+	History history;
+
+	SuiteTotals allTotals;
+
+	for (const auto &filename : config.suites)
+	{
+		if (!std::ifstream(filename))
+		{
+			std::cerr << "Failed to open " << filename << std::endl;
+			return false;
+		}
+
+		Learn::STS suite(filename);
+
+		SuiteResult suiteResult;
+		suiteResult.filename = filename;
+
+		SuiteTotals totals;
+
+		for (const auto &entry : suite.GetEntries())
+		{
+			ttable.InvalidateAllEntries();
+			killer.Clear();
+			history.Clear();
+
+			double startTime = CurrentTime();
+
+			Search::SearchResult searchResult = Search::SyncSearchNodeLimited(
+				entry.position, config.nodeBudget, evaluator, moveEvaluator, &killer, &ttable, &history);
+
+			PositionResult result;
+			result.time = CurrentTime() - startTime;
+
+			Board board = entry.position;
+			Move bestMove = searchResult.pv.empty() ? 0 : searchResult.pv[0];
+
+			result.id = entry.id;
+			result.fen = board.GetFen();
+			result.move = (bestMove == 0) ? "none" : board.MoveToAlg(bestMove, Board::SAN);
+			result.scorable = entry.IsScorable();
+			result.solved = result.scorable && bestMove != 0 && Learn::STS::IsSolved(entry, bestMove);
+			result.score = searchResult.score;
+			result.nodes = searchResult.nodeCount;
+			result.timeToSolution = -1.0;
+			result.nodesToSolution = 0;
+
+			if (result.solved)
+			{
+				// go back to the first iteration of the last run of solving iterations
+				for (auto it = searchResult.iterations.rbegin(); it != searchResult.iterations.rend() && Learn::STS::IsSolved(entry, it->bestMove); ++it)
+				{
+					result.timeToSolution = it->time;
+					result.nodesToSolution = it->nodeCount;
+				}
+			}
+
+			std::cout << (result.id.empty() ? result.fen : result.id) << ": " << result.move <<
+						 (result.scorable ? (result.solved ? " solved" : " failed") : "") <<
+						 " nodes: " << result.nodes <<
+						 " time: " << result.time << "s";
+
+			if (result.solved)
+			{
+				std::cout << " time to solution: " << result.timeToSolution << "s";
+			}
+
+			std::cout << std::endl;
+
+			totals.Add(result);
+			allTotals.Add(result);
+
+			suiteResult.positions.push_back(result);
+		}
+
+		PrintTotals(Basename(filename), totals);
+
+		report.suites.push_back(suiteResult);
+	}
+
+	PrintTotals("Total", allTotals);
+	std::cout << "Signature: " << HexStr(GetSignature(report)) << std::endl;
+
+	return true;
+}
+
+uint64_t GetSignature(const Report &report)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (const auto &suite : report.suites)
+	{
+		for (const auto &position : suite.positions)
+		{
+			HashBytes(hash, position.move.data(), position.move.size());
+			HashBytes(hash, &position.nodes, sizeof(position.nodes));
+		}
+	}
+
+	return hash;
+}
+
+bool WriteJson(const Report &report, const std::string &filename)
+{
+	std::ofstream outfile(filename);
+
+	if (!outfile)
+	{
+		std::cerr << "Failed to open " << filename << " for writing" << std::endl;
+		return false;
+	}
+
+	outfile << std::setprecision(9);
+
+	SuiteTotals allTotals;
+
+	outfile << "{" << std::endl;
+	outfile << "\t\"version\": " << JsonVersion << "," << std::endl;
+	outfile << "\t\"nodeBudget\": " << report.nodeBudget << "," << std::endl;
+	outfile << "\t\"evaluatorSignature\": " << JsonString(HexStr(report.evaluatorSignature)) << "," << std::endl;
+	outfile << "\t\"signature\": " << JsonString(HexStr(GetSignature(report))) << "," << std::endl;
+	outfile << "\t\"suites\": [" << std::endl;
+
+	for (size_t suiteNum = 0; suiteNum < report.suites.size(); ++suiteNum)
+	{
+		const SuiteResult &suite = report.suites[suiteNum];
+
+		SuiteTotals totals;
+
+		outfile << "\t\t{" << std::endl;
+		outfile << "\t\t\t\"file\": " << JsonString(suite.filename) << "," << std::endl;
+		outfile << "\t\t\t\"positions\": [" << std::endl;
+
+		for (size_t i = 0; i < suite.positions.size(); ++i)
+		{
+			const PositionResult &p = suite.positions[i];
+
+			totals.Add(p);
+			allTotals.Add(p);
+
+			// one position per line, so baselines diff nicely
+			outfile << "\t\t\t\t{\"id\": " << JsonString(p.id) << ", \"fen\": " << JsonString(p.fen) << ", \"move\": " << JsonString(p.move)
+					<< ", \"scorable\": " << (p.scorable ? "true" : "false") << ", \"solved\": " << (p.solved ? "true" : "false")
+					<< ", \"score\": " << p.score << ", \"nodes\": " << p.nodes << ", \"time\": " << p.time
+					<< ", \"nps\": " << ((p.time > 0.0) ? (p.nodes / p.time) : 0.0);
+
+			if (p.solved)
+			{
+				outfile << ", \"timeToSolution\": " << p.timeToSolution << ", \"nodesToSolution\": " << p.nodesToSolution;
+			}
+			else
+			{
+				outfile << ", \"timeToSolution\": null, \"nodesToSolution\": null";
+			}
+
+			outfile << "}" << ((i + 1) < suite.positions.size() ? "," : "") << std::endl;
+		}
+
+		outfile << "\t\t\t]," << std::endl;
+		outfile << "\t\t\t\"totals\": {" << TotalsToJson(totals) << "}" << std::endl;
+		outfile << "\t\t}" << ((suiteNum + 1) < report.suites.size() ? "," : "") << std::endl;
+	}
+
+	outfile << "\t]," << std::endl;
+	outfile << "\t\"totals\": {" << TotalsToJson(allTotals) << "}" << std::endl;
+	outfile << "}" << std::endl;
+
+	return static_cast<bool>(outfile);
+}
+
+bool ReadJson(const std::string &filename, Report &report)
+{
+	std::ifstream infile(filename);
+
+	if (!infile)
+	{
+		std::cerr << "Failed to open " << filename << std::endl;
+		return false;
+	}
+
+	std::stringstream ss;
+	ss << infile.rdbuf();
+	std::string text = ss.str();
+
+	JsonValue root;
+	JsonParser parser(text);
+
+	if (!parser.Parse(root) || root.type != JsonValue::Object)
+	{
+		std::cerr << "Failed to parse " << filename << " (at byte " << parser.GetPos() << ")" << std::endl;
+		return false;
+	}
+
+	if (root["version"].number != JsonVersion)
+	{
+		std::cerr << filename << " has unsupported version " << root["version"].number << std::endl;
+		return false;
+	}
+
+	report.nodeBudget = static_cast<NodeBudget>(root["nodeBudget"].number);
+	report.evaluatorSignature = ParseHex(root["evaluatorSignature"].str);
+	report.suites.clear();
+
+	for (const auto &suite : root["suites"].array)
+	{
+		SuiteResult suiteResult;
+		suiteResult.filename = suite["file"].str;
+
+		for (const auto &p : suite["positions"].array)
+		{
+			PositionResult result;
+			result.id = p["id"].str;
+			result.fen = p["fen"].str;
+			result.move = p["move"].str;
+			result.scorable = p["scorable"].boolean;
+			result.solved = p["solved"].boolean;
+			result.score = static_cast<Score>(p["score"].number);
+			result.nodes = static_cast<uint64_t>(p["nodes"].number);
+			result.time = p["time"].number;
+			result.timeToSolution = (p["timeToSolution"].type == JsonValue::Number) ? p["timeToSolution"].number : -1.0;
+			result.nodesToSolution = static_cast<uint64_t>(p["nodesToSolution"].number);
+
+			suiteResult.positions.push_back(result);
+		}
+
+		report.suites.push_back(suiteResult);
+	}
+
+	return true;
+}
+
+int Compare(const Report &baseline, const Report &report)
+{
+	int regressions = 0;
+
+	// same suite file (by name only, so baselines from other directories work) and position
+	std::map<std::string, const PositionResult*> baselinePositions;
+
+	for (const auto &suite : baseline.suites)
+	{
+		for (const auto &p : suite.positions)
+		{
+			baselinePositions[Basename(suite.filename) + '|' + p.fen] = &p;
+		}
+	}
+
+	bool compareNodes = baseline.nodeBudget == report.nodeBudget;
+
+	if (!compareNodes)
+	{
+		std::cout << "Warning: node budgets are different (" << baseline.nodeBudget << " vs " << report.nodeBudget << "), not comparing node counts" << std::endl;
+	}
+
+	if (baseline.evaluatorSignature != report.evaluatorSignature)
+	{
+		std::cout << "Warning: evaluators are different" << std::endl;
+	}
+
+	std::vector<double> npsLogRatios;
+	std::vector<double> nodeLogRatios;
+	std::vector<double> ttsLogRatios;
+
+	size_t numMatched = 0;
+	size_t numNodesChanged = 0;
+	size_t baselineSolved = 0;
+	size_t solved = 0;
+
+	std::vector<std::string> newlySolved;
+	std::vector<std::string> newlyFailed;
+
+	for (const auto &suite : report.suites)
+	{
+		for (const auto &p : suite.positions)
+		{
+			auto it = baselinePositions.find(Basename(suite.filename) + '|' + p.fen);
+
+			if (it == baselinePositions.end())
+			{
+				continue;
+			}
+
+			const PositionResult &b = *(it->second);
+
+			++numMatched;
+
+			if (b.time > MinTimeForNPS && p.time > MinTimeForNPS && b.nodes > 0 && p.nodes > 0)
+			{
+				npsLogRatios.push_back(std::log((p.nodes / p.time) / (b.nodes / b.time)));
+			}
+
+			if (compareNodes && b.nodes > 0 && p.nodes > 0)
+			{
+				nodeLogRatios.push_back(std::log(static_cast<double>(p.nodes) / b.nodes));
+				numNodesChanged += p.nodes != b.nodes;
+			}
+
+			if (b.solved && p.solved && b.timeToSolution > 0.0 && p.timeToSolution > 0.0)
+			{
+				ttsLogRatios.push_back(std::log(p.timeToSolution / b.timeToSolution));
+			}
+
+			if (b.scorable && p.scorable)
+			{
+				baselineSolved += b.solved;
+				solved += p.solved;
+
+				std::string name = p.id.empty() ? p.fen : p.id;
+
+				if (p.solved && !b.solved)
+				{
+					newlySolved.push_back(name);
+				}
+				else if (!p.solved && b.solved)
+				{
+					newlyFailed.push_back(name);
+				}
+			}
+		}
+	}
+
+	std::cout << "Positions compared: " << numMatched << std::endl;
+
+	if (numMatched == 0)
+	{
+		return 0;
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+
+	SampleStats npsStats(npsLogRatios);
+
+	if (npsStats.n > 0)
+	{
+		std::cout << "NPS: " << std::showpos << npsStats.GetChange() << std::noshowpos << "% +- " << npsStats.GetChangeStdErr() << "% (t = " << npsStats.t << ", " << npsStats.n << " positions)" << std::endl;
+
+		if (npsStats.t < -TThreshold && npsStats.mean < std::log(1.0 - MinEffect))
+		{
+			std::cout << "REGRESSION: NPS is significantly lower" << std::endl;
+			++regressions;
+		}
+	}
+
+	if (compareNodes)
+	{
+		if (numNodesChanged == 0)
+		{
+			std::cout << "Node counts: identical" << std::endl;
+		}
+		else
+		{
+			SampleStats nodeStats(nodeLogRatios);
+
+			std::cout << "Node counts: changed in " << numNodesChanged << " positions, " << std::showpos << nodeStats.GetChange() << std::noshowpos << "% +- " << nodeStats.GetChangeStdErr() << "% (t = " << nodeStats.t << ")" << std::endl;
+
+			if (nodeStats.t > TThreshold && nodeStats.mean > std::log(1.0 + MinEffect))
+			{
+				std::cout << "REGRESSION: node counts are significantly higher" << std::endl;
+				++regressions;
+			}
+		}
+	}
+
+	SampleStats ttsStats(ttsLogRatios);
+
+	if (ttsStats.n > 0)
+	{
+		std::cout << "Time to solution: " << std::showpos << ttsStats.GetChange() << std::noshowpos << "% +- " << ttsStats.GetChangeStdErr() << "% (t = " << ttsStats.t << ", " << ttsStats.n << " positions solved in both)" << std::endl;
+	}
+
+	std::cout << "Solved: " << solved << " (baseline: " << baselineSolved << ")" << std::endl;
+
+	for (const auto &name : newlySolved)
+	{
+		std::cout << "  newly solved: " << name << std::endl;
+	}
+
+	for (const auto &name : newlyFailed)
+	{
+		std::cout << "  newly failed: " << name << std::endl;
+	}
+
+	// McNemar's test on positions that changed
+	double discordant = newlySolved.size() + newlyFailed.size();
+
+	if (discordant > 0)
+	{
+		double diff = static_cast<double>(newlyFailed.size()) - static_cast<double>(newlySolved.size());
+		double chiSquared = diff * diff / discordant;
+
+		if (diff > 0 && chiSquared > ChiSquaredThreshold)
+		{
+			std::cout << "REGRESSION: solve rate is significantly lower (chi-squared = " << chiSquared << ")" << std::endl;
+			++regressions;
+		}
+	}
+
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+
+	if (regressions == 0)
+	{
+		std::cout << "No significant regressions" << std::endl;
+	}
+
+	return regressions;
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include "types.h"
+#include "evaluator.h"
+#include "move_evaluator.h"
+
+// regression benchmark over EPD test suites
+// every position is searched to a fixed node budget with a clean transposition table, killers and history,
+// one position at a time (so NPS isn't affected by other threads), so node counts only change when the
+// search or evaluation changes
+// results can be saved as JSON, and compared against a baseline (see Compare)
+namespace BenchSuite
+{
+
+struct Config
+{
+	NodeBudget nodeBudget = 256*1024;
+
+	// per position, this is cleared before each search
+	size_t ttableSize = 16*MB;
+
+	std::vector<std::string> suites;
+};
+
+// tests/testsuites, relative to the working directory
+std::vector<std::string> GetDefaultSuites();
+
+struct PositionResult
+{
+	std::string id;
+	std::string fen;
+
+	// SAN
+	std::string move;
+
+	// whether the suite has bm/am for this position
+	bool scorable;
+	bool solved;
+
+	Score score;
+	uint64_t nodes;
+	double time;
+
+	// time and nodes of the first iteration after which the best move was always a solution
+	// (negative time if not solved)
+	double timeToSolution;
+	uint64_t nodesToSolution;
+};
+
+struct SuiteResult
+{
+	std::string filename;
+	std::vector<PositionResult> positions;
+};
+
+struct Report
+{
+	NodeBudget nodeBudget;
+	uint64_t evaluatorSignature;
+	std::vector<SuiteResult> suites;
+};
+
+// prints a line per position, and a summary per suite
+// returns false if a suite cannot be read
+bool Run(const Config &config, EvaluatorIface *evaluator, MoveEvaluatorIface *moveEvaluator, Report &report);
+
+// hash of best moves and node counts of all positions (this is what to look at for "no functional change")
+uint64_t GetSignature(const Report &report);
+
+bool WriteJson(const Report &report, const std::string &filename);
+bool ReadJson(const std::string &filename, Report &report);
+
+// positions are matched by suite and FEN, so suites can be different (only positions in both are compared)
+// NPS, node count, and solve rate differences are tested for statistical significance, and significant
+// regressions are flagged
+// returns the number of regressions flagged
+int Compare(const Report &baseline, const Report &report);
+
+}
+
+#endif // BENCH_SUITE_H
@@ -23,6 +23,9 @@
 #include <regex>
 #include <tuple>
 #include <iostream>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
 
 #include <cassert>
 #include <cstdlib>
@@ -30,228 +33,342 @@
 
 #include "bit_ops.h"
 #include "containers.h"
-#include "magic_moves.h"
+#include "profiling.h"
+#include "slider_attacks.h"
 #include "util.h"
 #include "zobrist.h"
 
+static_assert(std::is_trivially_copyable<Board::State>::value, "Board::State must be copyable with memcpy");
+static_assert(sizeof(Board::State) <= 200, "Board::State should stay compact");
+
 namespace
 {
 
-Square StringToSquare(std::string st)
+void GetCastlingRookSquares(Move castlingMove, Square &rookFrom, Square &rookTo)
 {
-	if ((st[0] > 'h') || (st[0] < 'a') || st[1] < '1' || st[1] > '8')
+	switch (GetCastlingType(castlingMove))
 	{
-		std::cerr << "Square is invalid - " << st << std::endl;
-		exit(1);
+	case MoveConstants::CASTLE_WHITE_SHORT: rookFrom = H1; rookTo = F1; break;
+	case MoveConstants::CASTLE_WHITE_LONG: rookFrom = A1; rookTo = D1; break;
+	case MoveConstants::CASTLE_BLACK_SHORT: rookFrom = H8; rookTo = F8; break;
+	default: rookFrom = A8; rookTo = D8; break;
 	}
-
-	return (st[1] - '1') * 8 + (st[0] - 'a');
 }
 
+// EMPTY if c is not a piece
 PieceType CharToPieceType(char c)
 {
 	switch (c)
 	{
-	case 'K':
-		return WK;
-	case 'Q':
-		return WQ;
-	case 'B':
-		return WB;
-	case 'N':
-		return WN;
-	case 'R':
-		return WR;
-	case 'P':
-		return WP;
-
-	case 'k':
-		return BK;
-	case 'q':
-		return BQ;
-	case 'b':
-		return BB;
-	case 'n':
-		return BN;
-	case 'r':
-		return BR;
-	case 'p':
-		return BP;
+	case 'K': return WK;
+	case 'Q': return WQ;
+	case 'R': return WR;
+	case 'N': return WN;
+	case 'B': return WB;
+	case 'P': return WP;
+	case 'k': return BK;
+	case 'q': return BQ;
+	case 'r': return BR;
+	case 'n': return BN;
+	case 'b': return BB;
+	case 'p': return BP;
+	default: return EMPTY;
+	}
+}
 
-	default:
-		std::cerr << "PieceType is invalid - " << c << std::endl;
-		exit(1);
+// a character class in a move pattern (see MatchMovePattern)
+struct MovePatternElement
+{
+	const char *chars;
+	bool optional;
+};
+
+const static char Files[] = "abcdefgh";
+const static char Ranks[] = "12345678";
+
+const static MovePatternElement CoordinateMovePattern[] = { { Files, false }, { Ranks, false }, { Files, false }, { Ranks, false } };
+const static MovePatternElement CoordinatePromoPattern[] = { { Files, false }, { Ranks, false }, { Files, false }, { Ranks, false }, { "QBRNqbrn", false } };
+const static MovePatternElement SanMovePattern[] = { { "KQBNR", true }, { Files, true }, { Ranks, true }, { Files, false }, { Ranks, false }, { "QBRN", true } };
+
+// whether str[pos:] fully matches the pattern (this is equivalent to regex_match with the same pattern, but move
+// parsing is used in bulk EPD parsing, and constructing regexes is slow)
+bool MatchMovePattern(const std::string &str, size_t pos, const MovePatternElement *pattern, size_t patternSize)
+{
+	if (patternSize == 0)
+	{
+		return pos == str.size();
+	}
+
+	if (pos < str.size() && str[pos] != '\0' && strchr(pattern->chars, str[pos]) &&
+		MatchMovePattern(str, pos + 1, pattern + 1, patternSize - 1))
+	{
+		return true;
 	}
 
-	return EMPTY;
+	return pattern->optional && MatchMovePattern(str, pos, pattern + 1, patternSize - 1);
 }
 
+template <size_t N>
+bool MatchMovePattern(const std::string &str, const MovePatternElement (&pattern)[N])
+{
+	return MatchMovePattern(str, 0, pattern, N);
 }
 
-Board::Board(const std::string &fen)
+// leaves x unchanged if token is not a number (eg. the first operation of an EPD line)
+void ParseFenCounter(StringView token, uint32_t &x)
 {
-	for (uint32_t i = 0; i < BOARD_DESC_BB_SIZE; ++i)
+	if (token.Empty() || token.Size() > 9)
 	{
-		m_boardDescBB[i] = 0;
+		return;
 	}
 
-	for (uint32_t i = 0; i < BOARD_DESC_U8_SIZE; ++i)
+	uint32_t ret = 0;
+
+	for (char c : token)
 	{
-		m_boardDescU8[i] = 0;
+		if (c < '0' || c > '9')
+		{
+			return;
+		}
+
+		ret = ret * 10 + (c - '0');
 	}
 
-	for (Square sq = 0; sq < 64; ++sq)
+	x = ret;
+}
+
+// returns the end of the written number
+char *WriteUInt(char *buf, uint32_t x)
+{
+	char digits[10];
+	size_t numDigits = 0;
+
+	do
+	{
+		digits[numDigits++] = '0' + (x % 10);
+		x /= 10;
+	} while (x);
+
+	while (numDigits > 0)
 	{
-		RemovePiece(sq);
+		*buf++ = digits[--numDigits];
 	}
 
-	// the board desc is up to 64 squares + 7 rank separators + 1 NUL
-	char boardDesc[72];
-	char sideToMove;
-	char castlingRights[5];
-	char enPassantSq[3];
-	uint32_t halfMoves;
-	uint32_t fullMoves;
+	return buf;
+}
+
+}
+
+Board::Board(const std::string &fen)
+	: m_undoStack(UNDO_STACK_INITIAL_CAPACITY), m_hashStack(UNDO_STACK_INITIAL_CAPACITY), m_moveStack(UNDO_STACK_INITIAL_CAPACITY)
+{
+	std::memset(&m_state, 0, sizeof(m_state));
+	std::memset(m_repetitionFilter, 0, sizeof(m_repetitionFilter));
 
-	int sscanfRet = sscanf(fen.c_str(), "%71s %c %4s %2s %u %u",
-						   boardDesc, &sideToMove, castlingRights, enPassantSq, &halfMoves, &fullMoves);
+	const char *error = nullptr;
 
-	if (sscanfRet == 6)
+	if (!SetFen(fen, &error))
 	{
-		// all fields are present
+		std::cerr << "FEN is invalid (" << error << ") - " << fen << std::endl;
+		exit(1);
 	}
-	else if (sscanfRet == 4) // some FEN/EPD positions don't have the move counts
+}
+
+bool Board::SetFen(StringView fen, const char **error)
+{
+	const char *dummyError;
+
+	if (!error)
 	{
-		halfMoves = 0;
-		fullMoves = 1;
+		error = &dummyError;
 	}
-	else
+
+	StringView boardDesc = fen.NextToken();
+	StringView sideToMove = fen.NextToken();
+	StringView castlingRights = fen.NextToken();
+	StringView enPassantSq = fen.NextToken();
+
+	if (enPassantSq.Empty())
 	{
-		std::cerr << "FEN is invalid - " << fen << std::endl;
-		exit(1);
+		*error = "missing fields";
+		return false;
 	}
 
-	size_t boardDescLen = strlen(boardDesc);
+	// we parse into a copy, so the board is unchanged if the FEN is invalid
+	State oldState;
+	std::memcpy(&oldState, &m_state, sizeof(m_state));
+
+	std::memset(&m_state, 0, sizeof(m_state));
+
+	for (Square sq = 0; sq < 64; ++sq)
+	{
+		m_state.boardDescU8[sq] = EMPTY;
+	}
+
+	auto fail = [&](const char *msg)
+	{
+		std::memcpy(&m_state, &oldState, sizeof(m_state));
+		*error = msg;
+		return false;
+	};
+
 	Square currentSquareFen = 0;
 
-	for (size_t i = 0; i < boardDescLen; ++i)
+	for (char c : boardDesc)
 	{
+		if (c == '/')
+		{
+			continue;
+		}
+
 		if (currentSquareFen >= 64)
 		{
-			std::cerr << "FEN is too long - " << fen << std::endl;
-			exit(1);
+			return fail("too long");
 		}
 
 		// FEN goes from rank 8 to 1, so we have to reverse rank... a bit of weird logic here
 		Square currentSquare = (7 - (currentSquareFen / 8)) * 8 + currentSquareFen % 8;
 
-		if (boardDesc[i] == '/')
+		if (c >= '1' && c <= '8')
 		{
-			continue;
+			currentSquareFen += c - '0';
 		}
-		else if (boardDesc[i] >= '1' && boardDesc[i] <= '8')
+		else
 		{
-			for (size_t r = 0; r < static_cast<size_t>((boardDesc[i] - '0')); ++r)
+			PieceType pt = CharToPieceType(c);
+
+			if (pt == EMPTY)
 			{
-				RemovePiece(currentSquare);
-				++currentSquareFen;
-				++currentSquare;
+				return fail("invalid character encountered");
 			}
-		}
-		else if (boardDesc[i] >= 'A' && boardDesc[i] <= 'z')
-		{
-			PlacePiece(currentSquare, CharToPieceType(boardDesc[i]));
+
+			PlacePiece(currentSquare, pt);
 			++currentSquareFen;
 		}
-		else
-		{
-			std::cerr << "FEN is invalid (invalid character encountered) - " << fen << std::endl;
-			exit(1);
-		}
 	}
 
 	if (currentSquareFen != 64)
 	{
-		std::cerr << "FEN is invalid (too short) - " << fen << std::endl;
-		exit(1);
+		return fail(currentSquareFen < 64 ? "too short" : "too long");
 	}
 
-	if (sideToMove != 'w' && sideToMove != 'b')
+	// everything from move generation to eval assumes this
+	if (PopCount(m_state.boardDescBB[WK]) != 1 || PopCount(m_state.boardDescBB[BK]) != 1)
 	{
-		std::cerr << "FEN is invalid (invalid side to move) - " << fen << std::endl;
-		exit(1);
+		return fail("each side must have exactly one king");
 	}
 
-	m_boardDescU8[SIDE_TO_MOVE] = sideToMove == 'w' ? WHITE : BLACK;
+	if (sideToMove != "w" && sideToMove != "b")
+	{
+		return fail("invalid side to move");
+	}
+
+	m_state.boardDescU8[SIDE_TO_MOVE] = sideToMove[0] == 'w' ? WHITE : BLACK;
 
-	if (enPassantSq[0] != '-')
+	if (enPassantSq != "-")
 	{
-		m_boardDescBB[EN_PASS_SQUARE] = Bit(StringToSquare(std::string(enPassantSq)));
+		if (enPassantSq.Size() != 2 || enPassantSq[0] < 'a' || enPassantSq[0] > 'h' || enPassantSq[1] < '1' || enPassantSq[1] > '8')
+		{
+			return fail("invalid en passant square");
+		}
+
+		m_state.boardDescBB[EN_PASS_SQUARE] = Bit((enPassantSq[1] - '1') * 8 + (enPassantSq[0] - 'a'));
 	}
 
-	std::string strCastlingRights(castlingRights);
+	m_state.boardDescU8[W_SHORT_CASTLE] = castlingRights.Find('K') != StringView::npos;
+	m_state.boardDescU8[W_LONG_CASTLE] = castlingRights.Find('Q') != StringView::npos;
+	m_state.boardDescU8[B_SHORT_CASTLE] = castlingRights.Find('k') != StringView::npos;
+	m_state.boardDescU8[B_LONG_CASTLE] = castlingRights.Find('q') != StringView::npos;
 
-	m_boardDescU8[W_SHORT_CASTLE] = strCastlingRights.find('K') != std::string::npos;
-	m_boardDescU8[W_LONG_CASTLE] = strCastlingRights.find('Q') != std::string::npos;
-	m_boardDescU8[B_SHORT_CASTLE] = strCastlingRights.find('k') != std::string::npos;
-	m_boardDescU8[B_LONG_CASTLE] = strCastlingRights.find('q') != std::string::npos;
+	// the move counters are optional, and we don't keep track of full moves
+	uint32_t halfMoves = 0;
+	ParseFenCounter(fen.NextToken(), halfMoves);
 
-	m_boardDescU8[HALF_MOVES_CLOCK] = halfMoves;
+	// the clock saturates at 255 (see ApplyMove)
+	m_state.boardDescU8[HALF_MOVES_CLOCK] = std::min<uint32_t>(halfMoves, std::numeric_limits<uint8_t>::max());
 
 	UpdateInCheck_();
 	UpdateHashFull_();
 
+	// every non-zero filter slot has a hash in the history (see CloneFrom)
+	for (size_t i = 0; i < m_hashStack.GetSize(); ++i)
+	{
+		m_repetitionFilter[RepetitionFilterSlot_(m_hashStack[i])] = 0;
+	}
+
+	m_undoStack.Clear();
+	m_hashStack.Clear();
+	m_moveStack.Clear();
+
 #ifdef DEBUG
 	CheckBoardConsistency();
 #endif
+
+	return true;
 }
 
 void Board::RemovePiece(Square sq)
 {
-	m_boardDescBB[m_boardDescU8[sq]] &= InvBit(sq);
+	m_state.boardDescBB[m_state.boardDescU8[sq]] &= InvBit(sq);
 
-	m_boardDescU8[sq] = EMPTY;
+	m_state.boardDescU8[sq] = EMPTY;
 
 	// faster to reset both than check
-	m_boardDescBB[WHITE_OCCUPIED] &= InvBit(sq);
-	m_boardDescBB[BLACK_OCCUPIED] &= InvBit(sq);
+	m_state.boardDescBB[WHITE_OCCUPIED] &= InvBit(sq);
+	m_state.boardDescBB[BLACK_OCCUPIED] &= InvBit(sq);
 }
 
 void Board::PlacePiece(Square sq, PieceType pt)
 {
 #ifdef DEBUG
 	assert(pt != EMPTY);
-	assert(m_boardDescU8[sq] == EMPTY);
+	assert(m_state.boardDescU8[sq] == EMPTY);
 #endif
 
-	m_boardDescU8[sq] = pt;
-	m_boardDescBB[pt] |= Bit(sq);
+	m_state.boardDescU8[sq] = pt;
+	m_state.boardDescBB[pt] |= Bit(sq);
 
 	if (GetColor(pt) == WHITE)
 	{
-		m_boardDescBB[WHITE_OCCUPIED] |= Bit(sq);
+		m_state.boardDescBB[WHITE_OCCUPIED] |= Bit(sq);
 	}
 	else
 	{
-		m_boardDescBB[BLACK_OCCUPIED] |= Bit(sq);
+		m_state.boardDescBB[BLACK_OCCUPIED] |= Bit(sq);
 	}
 }
 
 template <Board::MOVE_TYPES MT>
 void Board::GenerateAllLegalMoves(MoveList &moveList)
 {
-	MoveList pseudoLegalMoves;
-	GenerateAllPseudoLegalMoves_<MT>(pseudoLegalMoves);
+	Profiling::ScopedTimer timer(Profiling::GENERATE_LEGAL_MOVES);
 
 	CheckInfo ci = ComputeCheckInfo();
 
-	for (size_t i = 0; i < pseudoLegalMoves.GetSize(); ++i)
+	if (ci.checkers)
 	{
-		if (CheckLegal(ci, pseudoLegalMoves[i]))
-		{
-			moveList.PushBack(pseudoLegalMoves[i]);
-		}
+		GenerateEvasions_<MT>(ci, moveList);
+		return;
+	}
+
+	Color sideToMove = m_state.boardDescU8[SIDE_TO_MOVE];
+	GeneratePawnMoves_<MT>(sideToMove, ci, moveList);
+	GenerateKnightMoves_<MT>(sideToMove, ci, moveList);
+	GenerateBishopMoves_<MT>(sideToMove, ci, moveList);
+	GenerateRookMoves_<MT>(sideToMove, ci, moveList);
+	GenerateQueenMoves_<MT>(sideToMove, ci, moveList);
+	GenerateKingMoves_<MT>(sideToMove, ci, moveList);
+
+#ifdef DEBUG
+	if (MT == ALL)
+	{
+		MoveList mlQuiet;
+		MoveList mlViolent;
+		GenerateAllLegalMoves<QUIET>(mlQuiet);
+		GenerateAllLegalMoves<VIOLENT>(mlViolent);
+		assert((mlQuiet.GetSize() + mlViolent.GetSize()) == moveList.GetSize());
 	}
+#endif
 }
 
 template void Board::GenerateAllLegalMoves<Board::ALL>(MoveList &);
@@ -262,64 +379,64 @@ void Board::CheckBoardConsistency()
 {
 	for (uint32_t sq = 0; sq < 64; ++sq)
 	{
-		PieceType pt = m_boardDescU8[sq];
+		PieceType pt = m_state.boardDescU8[sq];
 		if (pt == EMPTY)
 		{
 			for (uint32_t i = 0; i < NUM_PIECETYPES; ++i)
 			{
-				assert(!(m_boardDescBB[PIECE_TYPE_INDICES[i]] & Bit(sq)));
+				assert(!(m_state.boardDescBB[PIECE_TYPE_INDICES[i]] & Bit(sq)));
 			}
 
-			assert(!(m_boardDescBB[WHITE_OCCUPIED] & Bit(sq)));
-			assert(!(m_boardDescBB[BLACK_OCCUPIED] & Bit(sq)));
+			assert(!(m_state.boardDescBB[WHITE_OCCUPIED] & Bit(sq)));
+			assert(!(m_state.boardDescBB[BLACK_OCCUPIED] & Bit(sq)));
 		}
 		else
 		{
 			if (GetColor(pt) == WHITE)
 			{
-				assert(m_boardDescBB[WHITE_OCCUPIED] & Bit(sq));
-				assert(!(m_boardDescBB[BLACK_OCCUPIED] & Bit(sq)));
+				assert(m_state.boardDescBB[WHITE_OCCUPIED] & Bit(sq));
+				assert(!(m_state.boardDescBB[BLACK_OCCUPIED] & Bit(sq)));
 			}
 			else
 			{
-				assert(m_boardDescBB[BLACK_OCCUPIED] & Bit(sq));
-				assert(!(m_boardDescBB[WHITE_OCCUPIED] & Bit(sq)));
+				assert(m_state.boardDescBB[BLACK_OCCUPIED] & Bit(sq));
+				assert(!(m_state.boardDescBB[WHITE_OCCUPIED] & Bit(sq)));
 			}
 
 			for (uint32_t i = 0; i < NUM_PIECETYPES; ++i)
 			{
 				if (PIECE_TYPE_INDICES[i] != pt)
 				{
-					assert(!(m_boardDescBB[PIECE_TYPE_INDICES[i]] & Bit(sq)));
+					assert(!(m_state.boardDescBB[PIECE_TYPE_INDICES[i]] & Bit(sq)));
 				}
 			}
 
-			assert(m_boardDescBB[pt] & Bit(sq));
+			assert(m_state.boardDescBB[pt] & Bit(sq));
 		}
 	}
 
-	if (m_boardDescU8[E1] != WK || m_boardDescU8[H1] != WR)
+	if (m_state.boardDescU8[E1] != WK || m_state.boardDescU8[H1] != WR)
 	{
-		assert(!m_boardDescU8[W_SHORT_CASTLE]);
+		assert(!m_state.boardDescU8[W_SHORT_CASTLE]);
 	}
 
-	if (m_boardDescU8[E1] != WK || m_boardDescU8[A1] != WR)
+	if (m_state.boardDescU8[E1] != WK || m_state.boardDescU8[A1] != WR)
 	{
-		assert(!m_boardDescU8[W_LONG_CASTLE]);
+		assert(!m_state.boardDescU8[W_LONG_CASTLE]);
 	}
 
-	if (m_boardDescU8[E8] != BK || m_boardDescU8[H8] != BR)
+	if (m_state.boardDescU8[E8] != BK || m_state.boardDescU8[H8] != BR)
 	{
-		if (m_boardDescU8[B_SHORT_CASTLE])
+		if (m_state.boardDescU8[B_SHORT_CASTLE])
 		{
 			std::cout << PrintBoard() << std::endl;
 		}
-		assert(!m_boardDescU8[B_SHORT_CASTLE]);
+		assert(!m_state.boardDescU8[B_SHORT_CASTLE]);
 	}
 
-	if (m_boardDescU8[E8] != BK || m_boardDescU8[A8] != BR)
+	if (m_state.boardDescU8[E8] != BK || m_state.boardDescU8[A8] != BR)
 	{
-		assert(!m_boardDescU8[B_LONG_CASTLE]);
+		assert(!m_state.boardDescU8[B_LONG_CASTLE]);
 	}
 
 	uint64_t oldHash = GetHash();
@@ -332,70 +449,97 @@ void Board::CheckBoardConsistency()
 	assert(oldHash == GetHash());
 }
 
-std::string Board::GetFen(bool omitMoveNums) const
+size_t Board::WriteFen(char *buf, size_t bufSize, bool omitMoveNums) const
 {
-	std::stringstream ss;
+	if (bufSize < MAX_FEN_LENGTH)
+	{
+		return 0;
+	}
+
+	char *p = buf;
 
 	for (int y = 7; y >= 0; --y)
 	{
-		for (int x = 0; x < 8;)
+		int numEmpty = 0;
+
+		for (int x = 0; x < 8; ++x)
 		{
-			if (m_boardDescU8[Sq(x, y)] != EMPTY)
+			PieceType pt = m_state.boardDescU8[Sq(x, y)];
+
+			if (pt == EMPTY)
 			{
-				ss << PieceTypeToChar(m_boardDescU8[Sq(x, y)]);
-				++x;
+				++numEmpty;
+				continue;
 			}
-			else
+
+			if (numEmpty > 0)
 			{
-				int numOfSpaces = 0;
-				while (m_boardDescU8[Sq(x, y)] == EMPTY && x < 8)
-				{
-					++numOfSpaces;
-					++x;
-				}
-				ss << numOfSpaces;
+				*p++ = '0' + numEmpty;
+				numEmpty = 0;
 			}
+
+			*p++ = PieceTypeToChar(pt);
+		}
+
+		if (numEmpty > 0)
+		{
+			*p++ = '0' + numEmpty;
 		}
 
 		if (y != 0)
 		{
-			ss << "/";
+			*p++ = '/';
 		}
 	}
 
-	ss << " ";
+	*p++ = ' ';
+	*p++ = (m_state.boardDescU8[SIDE_TO_MOVE] == WHITE) ? 'w' : 'b';
+	*p++ = ' ';
 
-	ss << (m_boardDescU8[SIDE_TO_MOVE] == WHITE ? 'w' : 'b');
+	char *castlingStart = p;
 
-	ss << " ";
+	if (m_state.boardDescU8[W_SHORT_CASTLE]) *p++ = 'K';
+	if (m_state.boardDescU8[W_LONG_CASTLE]) *p++ = 'Q';
+	if (m_state.boardDescU8[B_SHORT_CASTLE]) *p++ = 'k';
+	if (m_state.boardDescU8[B_LONG_CASTLE]) *p++ = 'q';
 
-	if (!m_boardDescU8[W_SHORT_CASTLE] && !m_boardDescU8[W_LONG_CASTLE] && !m_boardDescU8[B_SHORT_CASTLE] && !m_boardDescU8[B_LONG_CASTLE])
+	if (p == castlingStart)
 	{
-		ss << "-";
-	}
-	else
-	{
-		ss << (m_boardDescU8[W_SHORT_CASTLE] ? "K" : "") << (m_boardDescU8[W_LONG_CASTLE] ? "Q" : "")
-			<< (m_boardDescU8[B_SHORT_CASTLE] ? "k" : "") << (m_boardDescU8[B_LONG_CASTLE] ? "q" : "");
+		*p++ = '-';
 	}
 
-	ss << " ";
+	*p++ = ' ';
 
-	if (m_boardDescBB[EN_PASS_SQUARE])
+	if (m_state.boardDescBB[EN_PASS_SQUARE])
 	{
-		ss << SquareToString(BitScanForward(m_boardDescBB[EN_PASS_SQUARE]));
+		Square sq = BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE]);
+		*p++ = 'a' + GetX(sq);
+		*p++ = '1' + GetY(sq);
 	}
 	else
 	{
-		ss << "-";
+		*p++ = '-';
 	}
 
 	if (!omitMoveNums)
 	{
-		ss << " " << m_boardDescU8[HALF_MOVES_CLOCK] << " " << 1; // we don't actually keep track of full moves
+		*p++ = ' ';
+		p = WriteUInt(p, m_state.boardDescU8[HALF_MOVES_CLOCK]);
+		*p++ = ' ';
+		*p++ = '1'; // we don't actually keep track of full moves
 	}
 
-	return ss.str();
+	*p = '\0';
+
+	return p - buf;
+}
+
+std::string Board::GetFen(bool omitMoveNums) const
+{
+	char buf[MAX_FEN_LENGTH];
+	size_t len = WriteFen(buf, sizeof(buf), omitMoveNums);
+
+	return std::string(buf, len);
 }
 
 std::string Board::PrintBoard() const
@@ -409,7 +553,7 @@ std::string Board::PrintBoard() const
 
 		for (int x = 0; x <= 7; ++x)
 		{
-				ss << " " << PieceTypeToChar(m_boardDescU8[Sq(x, y)]) << " |";
+				ss << " " << PieceTypeToChar(m_state.boardDescU8[Sq(x, y)]) << " |";
 		}
 
 		ss << std::endl;
@@ -420,14 +564,14 @@ std::string Board::PrintBoard() const
 
 	ss << std::endl;
 
-	ss << "Side to move: " << (m_boardDescU8[SIDE_TO_MOVE] == WHITE ? "white" : "black") << std::endl;
-	ss << "En passant: " << (m_boardDescBB[EN_PASS_SQUARE] ? SquareToString(BitScanForward(m_boardDescBB[EN_PASS_SQUARE])) : "-") << std::endl;
-	ss << "White castling rights: " << (m_boardDescU8[W_SHORT_CASTLE] ? "O-O " : "") << (m_boardDescU8[W_LONG_CASTLE] ? "O-O-O" : "") << std::endl;
-	ss << "Black castling rights: " << (m_boardDescU8[B_SHORT_CASTLE] ? "O-O " : "") << (m_boardDescU8[B_LONG_CASTLE] ? "O-O-O" : "") << std::endl;
+	ss << "Side to move: " << (m_state.boardDescU8[SIDE_TO_MOVE] == WHITE ? "white" : "black") << std::endl;
+	ss << "En passant: " << (m_state.boardDescBB[EN_PASS_SQUARE] ? SquareToString(BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE])) : "-") << std::endl;
+	ss << "White castling rights: " << (m_state.boardDescU8[W_SHORT_CASTLE] ? "O-O " : "") << (m_state.boardDescU8[W_LONG_CASTLE] ? "O-O-O" : "") << std::endl;
+	ss << "Black castling rights: " << (m_state.boardDescU8[B_SHORT_CASTLE] ? "O-O " : "") << (m_state.boardDescU8[B_LONG_CASTLE] ? "O-O-O" : "") << std::endl;
 
-	ss << "Half moves since last pawn move or capture: " << m_boardDescU8[HALF_MOVES_CLOCK] << std::endl;
+	ss << "Half moves since last pawn move or capture: " << static_cast<int>(m_state.boardDescU8[HALF_MOVES_CLOCK]) << std::endl;
 	ss << "FEN: " << GetFen() << std::endl;
-	ss << "In check: " << m_boardDescU8[IN_CHECK] << std::endl;
+	ss << "In check: " << static_cast<int>(m_state.boardDescU8[IN_CHECK]) << std::endl;
 	ss << "Insufficient material: " << HasInsufficientMaterial() << std::endl;
 
 	return ss.str();
@@ -436,19 +580,19 @@ std::string Board::PrintBoard() const
 bool Board::ApplyMove(Move mv)
 {	
 #define MOVE_PIECE(pt, from, to) \
-	m_boardDescBB[pt] ^= Bit(from) | Bit(to); \
-	m_boardDescU8[from] = EMPTY; \
-	m_boardDescU8[to] = pt;
+	m_state.boardDescBB[pt] ^= Bit(from) | Bit(to); \
+	m_state.boardDescU8[from] = EMPTY; \
+	m_state.boardDescU8[to] = pt;
 #define REMOVE_PIECE(pt, sq) \
-	m_boardDescBB[pt] &= InvBit(sq); \
-	m_boardDescU8[sq] = EMPTY;
+	m_state.boardDescBB[pt] &= InvBit(sq); \
+	m_state.boardDescU8[sq] = EMPTY;
 #define PLACE_PIECE(pt, sq) \
-	m_boardDescBB[pt] |= Bit(sq); \
-	m_boardDescU8[sq] = pt;
+	m_state.boardDescBB[pt] |= Bit(sq); \
+	m_state.boardDescU8[sq] = pt;
 #define REPLACE_PIECE(pt_old, pt_new, sq) \
-	m_boardDescBB[pt_old] &= InvBit(sq); \
-	m_boardDescBB[pt_new] |= Bit(sq); \
-	m_boardDescU8[sq] = pt_new;
+	m_state.boardDescBB[pt_old] &= InvBit(sq); \
+	m_state.boardDescBB[pt_new] |= Bit(sq); \
+	m_state.boardDescU8[sq] = pt_new;
 
 	if (mv == NULL_MOVE)
 	{
@@ -456,342 +600,261 @@ bool Board::ApplyMove(Move mv)
 		return true;
 	}
 
-	UndoListBB &ulBB = m_undoStackBB.PrePush();
-	UndoListU8 &ulU8 = m_undoStackU8.PrePush();
-
-	ulBB.Clear();
-	ulU8.Clear();
-
 	PieceType pt = GetPieceType(mv);
 	Square from = GetFromSquare(mv);
 	Square to = GetToSquare(mv);
 	Color color = pt & COLOR_MASK;
 	PieceType promoType = GetPromoType(mv);
 
-	m_hashStack.Push(m_boardDescBB[HASH]);
+	UndoRecord &ur = m_undoStack.PrePush();
+	SaveUndoRecord_(ur, mv);
+
+	PushHashHistory_(m_state.boardDescBB[HASH]);
+	m_moveStack.Push(mv);
 
-	if (m_boardDescBB[EN_PASS_SQUARE])
+	if (m_state.boardDescBB[EN_PASS_SQUARE])
 	{
-		m_boardDescBB[HASH] ^= EN_PASS_ZOBRIST[BitScanForward(m_boardDescBB[EN_PASS_SQUARE])];
+		m_state.boardDescBB[HASH] ^= EN_PASS_ZOBRIST[BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE])];
 	}
 
-	ulBB.PushBack(std::make_pair(EN_PASS_SQUARE, m_boardDescBB[EN_PASS_SQUARE]));
-	uint64_t currentEp = m_boardDescBB[EN_PASS_SQUARE];
-	m_boardDescBB[EN_PASS_SQUARE] = 0;
+	uint64_t currentEp = m_state.boardDescBB[EN_PASS_SQUARE];
+	m_state.boardDescBB[EN_PASS_SQUARE] = 0;
 
-	ulU8.PushBack(std::make_pair(IN_CHECK, m_boardDescU8[IN_CHECK]));
 
 	if (IsCastling(mv))
 	{
 		if (GetCastlingType(mv) == MoveConstants::CASTLE_WHITE_SHORT)
 		{
-			ulU8.PushBack(std::make_pair(E1, m_boardDescU8[E1]));
-			ulU8.PushBack(std::make_pair(G1, m_boardDescU8[G1]));
-			ulU8.PushBack(std::make_pair(H1, m_boardDescU8[H1]));
-			ulU8.PushBack(std::make_pair(F1, m_boardDescU8[F1]));
-			ulBB.PushBack(std::make_pair(WK, m_boardDescBB[WK]));
-			ulBB.PushBack(std::make_pair(WR, m_boardDescBB[WR]));
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED, m_boardDescBB[WHITE_OCCUPIED]));
 
-			if (m_boardDescU8[W_SHORT_CASTLE])
+			if (m_state.boardDescU8[W_SHORT_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= W_SHORT_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= W_SHORT_CASTLE_ZOBRIST;
 			}
 
-			if (m_boardDescU8[W_LONG_CASTLE])
+			if (m_state.boardDescU8[W_LONG_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= W_LONG_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= W_LONG_CASTLE_ZOBRIST;
 			}
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[E1][WK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[G1][WK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[H1][WR];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[F1][WR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[E1][WK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[G1][WK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[H1][WR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[F1][WR];
 
 			MOVE_PIECE(WK, E1, G1);
 			MOVE_PIECE(WR, H1, F1);
-			ulU8.PushBack(std::make_pair(W_SHORT_CASTLE, m_boardDescU8[W_SHORT_CASTLE]));
-			ulU8.PushBack(std::make_pair(W_LONG_CASTLE, m_boardDescU8[W_LONG_CASTLE]));
-			m_boardDescU8[W_SHORT_CASTLE] = 0;
-			m_boardDescU8[W_LONG_CASTLE] = 0;
-			m_boardDescBB[WHITE_OCCUPIED] ^= Bit(E1) | Bit(G1) | Bit(H1) | Bit(F1);
+			m_state.boardDescU8[W_SHORT_CASTLE] = 0;
+			m_state.boardDescU8[W_LONG_CASTLE] = 0;
+			m_state.boardDescBB[WHITE_OCCUPIED] ^= Bit(E1) | Bit(G1) | Bit(H1) | Bit(F1);
 		}
 		else if (GetCastlingType(mv) == MoveConstants::CASTLE_WHITE_LONG)
 		{
-			ulU8.PushBack(std::make_pair(E1, m_boardDescU8[E1]));
-			ulU8.PushBack(std::make_pair(C1, m_boardDescU8[C1]));
-			ulU8.PushBack(std::make_pair(A1, m_boardDescU8[A1]));
-			ulU8.PushBack(std::make_pair(D1, m_boardDescU8[D1]));
-			ulBB.PushBack(std::make_pair(WK, m_boardDescBB[WK]));
-			ulBB.PushBack(std::make_pair(WR, m_boardDescBB[WR]));
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED, m_boardDescBB[WHITE_OCCUPIED]));
 
-			if (m_boardDescU8[W_SHORT_CASTLE])
+			if (m_state.boardDescU8[W_SHORT_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= W_SHORT_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= W_SHORT_CASTLE_ZOBRIST;
 			}
 
-			if (m_boardDescU8[W_LONG_CASTLE])
+			if (m_state.boardDescU8[W_LONG_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= W_LONG_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= W_LONG_CASTLE_ZOBRIST;
 			}
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[E1][WK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[C1][WK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[A1][WR];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[D1][WR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[E1][WK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[C1][WK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[A1][WR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[D1][WR];
 
 			MOVE_PIECE(WK, E1, C1);
 			MOVE_PIECE(WR, A1, D1);
-			ulU8.PushBack(std::make_pair(W_SHORT_CASTLE, m_boardDescU8[W_SHORT_CASTLE]));
-			ulU8.PushBack(std::make_pair(W_LONG_CASTLE, m_boardDescU8[W_LONG_CASTLE]));
-			m_boardDescU8[W_SHORT_CASTLE] = 0;
-			m_boardDescU8[W_LONG_CASTLE] = 0;
-			m_boardDescBB[WHITE_OCCUPIED] ^= Bit(E1) | Bit(C1) | Bit(A1) | Bit(D1);
+			m_state.boardDescU8[W_SHORT_CASTLE] = 0;
+			m_state.boardDescU8[W_LONG_CASTLE] = 0;
+			m_state.boardDescBB[WHITE_OCCUPIED] ^= Bit(E1) | Bit(C1) | Bit(A1) | Bit(D1);
 		}
 		else if (GetCastlingType(mv) == MoveConstants::CASTLE_BLACK_SHORT)
 		{
-			ulU8.PushBack(std::make_pair(E8, m_boardDescU8[E8]));
-			ulU8.PushBack(std::make_pair(G8, m_boardDescU8[G8]));
-			ulU8.PushBack(std::make_pair(H8, m_boardDescU8[H8]));
-			ulU8.PushBack(std::make_pair(F8, m_boardDescU8[F8]));
-			ulBB.PushBack(std::make_pair(BK, m_boardDescBB[BK]));
-			ulBB.PushBack(std::make_pair(BR, m_boardDescBB[BR]));
-			ulBB.PushBack(std::make_pair(BLACK_OCCUPIED, m_boardDescBB[BLACK_OCCUPIED]));
 
-			if (m_boardDescU8[B_SHORT_CASTLE])
+			if (m_state.boardDescU8[B_SHORT_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= B_SHORT_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= B_SHORT_CASTLE_ZOBRIST;
 			}
 
-			if (m_boardDescU8[B_LONG_CASTLE])
+			if (m_state.boardDescU8[B_LONG_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= B_LONG_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= B_LONG_CASTLE_ZOBRIST;
 			}
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[E8][BK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[G8][BK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[H8][BR];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[F8][BR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[E8][BK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[G8][BK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[H8][BR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[F8][BR];
 
 			MOVE_PIECE(BK, E8, G8);
 			MOVE_PIECE(BR, H8, F8);
-			ulU8.PushBack(std::make_pair(B_SHORT_CASTLE, m_boardDescU8[B_SHORT_CASTLE]));
-			ulU8.PushBack(std::make_pair(B_LONG_CASTLE, m_boardDescU8[B_LONG_CASTLE]));
-			m_boardDescU8[B_SHORT_CASTLE] = 0;
-			m_boardDescU8[B_LONG_CASTLE] = 0;
-			m_boardDescBB[BLACK_OCCUPIED] ^= Bit(E8) | Bit(G8) | Bit(H8) | Bit(F8);
+			m_state.boardDescU8[B_SHORT_CASTLE] = 0;
+			m_state.boardDescU8[B_LONG_CASTLE] = 0;
+			m_state.boardDescBB[BLACK_OCCUPIED] ^= Bit(E8) | Bit(G8) | Bit(H8) | Bit(F8);
 		}
 		else // (GetCastlingType(mv) == MoveConstants::CASTLE_BLACK_LONG)
 		{
-			ulU8.PushBack(std::make_pair(E8, m_boardDescU8[E8]));
-			ulU8.PushBack(std::make_pair(C8, m_boardDescU8[C8]));
-			ulU8.PushBack(std::make_pair(A8, m_boardDescU8[A8]));
-			ulU8.PushBack(std::make_pair(D8, m_boardDescU8[D8]));
-			ulBB.PushBack(std::make_pair(BK, m_boardDescBB[BK]));
-			ulBB.PushBack(std::make_pair(BR, m_boardDescBB[BR]));
-			ulBB.PushBack(std::make_pair(BLACK_OCCUPIED, m_boardDescBB[BLACK_OCCUPIED]));
 
-			if (m_boardDescU8[B_SHORT_CASTLE])
+			if (m_state.boardDescU8[B_SHORT_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= B_SHORT_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= B_SHORT_CASTLE_ZOBRIST;
 			}
 
-			if (m_boardDescU8[B_LONG_CASTLE])
+			if (m_state.boardDescU8[B_LONG_CASTLE])
 			{
-				m_boardDescBB[HASH] ^= B_LONG_CASTLE_ZOBRIST;
+				m_state.boardDescBB[HASH] ^= B_LONG_CASTLE_ZOBRIST;
 			}
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[E8][BK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[C8][BK];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[A8][BR];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[D8][BR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[E8][BK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[C8][BK];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[A8][BR];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[D8][BR];
 
 			MOVE_PIECE(BK, E8, C8);
 			MOVE_PIECE(BR, A8, D8);
-			ulU8.PushBack(std::make_pair(B_SHORT_CASTLE, m_boardDescU8[B_SHORT_CASTLE]));
-			ulU8.PushBack(std::make_pair(B_LONG_CASTLE, m_boardDescU8[B_LONG_CASTLE]));
-			m_boardDescU8[B_SHORT_CASTLE] = 0;
-			m_boardDescU8[B_LONG_CASTLE] = 0;
-			m_boardDescBB[BLACK_OCCUPIED] ^= Bit(E8) | Bit(C8) | Bit(A8) | Bit(D8);
+			m_state.boardDescU8[B_SHORT_CASTLE] = 0;
+			m_state.boardDescU8[B_LONG_CASTLE] = 0;
+			m_state.boardDescBB[BLACK_OCCUPIED] ^= Bit(E8) | Bit(C8) | Bit(A8) | Bit(D8);
 		}
 	}
 	else if ((pt == WP || pt == BP) && Bit(to) == currentEp) // en passant
 	{
 		if (pt == WP)
 		{
-			ulU8.PushBack(std::make_pair(from, m_boardDescU8[from]));
-			ulU8.PushBack(std::make_pair(to, m_boardDescU8[to]));
-			ulU8.PushBack(std::make_pair(to - 8, m_boardDescU8[to - 8]));
-			ulBB.PushBack(std::make_pair(WP, m_boardDescBB[WP]));
-			ulBB.PushBack(std::make_pair(BP, m_boardDescBB[BP]));
 
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED, m_boardDescBB[WHITE_OCCUPIED]));
-			ulBB.PushBack(std::make_pair(BLACK_OCCUPIED, m_boardDescBB[BLACK_OCCUPIED]));
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[from][WP];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][WP];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to - 8][BP];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[from][WP];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][WP];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to - 8][BP];
 
 			MOVE_PIECE(WP, from, to);
 			REMOVE_PIECE(BP, to - 8);
-			m_boardDescBB[WHITE_OCCUPIED] ^= (Bit(from) | Bit(to));
-			m_boardDescBB[BLACK_OCCUPIED] ^= Bit(to - 8);
+			m_state.boardDescBB[WHITE_OCCUPIED] ^= (Bit(from) | Bit(to));
+			m_state.boardDescBB[BLACK_OCCUPIED] ^= Bit(to - 8);
 		}
 		else
 		{
-			ulU8.PushBack(std::make_pair(from, m_boardDescU8[from]));
-			ulU8.PushBack(std::make_pair(to, m_boardDescU8[to]));
-			ulU8.PushBack(std::make_pair(to + 8, m_boardDescU8[to + 8]));
-			ulBB.PushBack(std::make_pair(WP, m_boardDescBB[WP]));
-			ulBB.PushBack(std::make_pair(BP, m_boardDescBB[BP]));
 
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED, m_boardDescBB[WHITE_OCCUPIED]));
-			ulBB.PushBack(std::make_pair(BLACK_OCCUPIED, m_boardDescBB[BLACK_OCCUPIED]));
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[from][BP];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][BP];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to + 8][WP];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[from][BP];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][BP];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to + 8][WP];
 
 			MOVE_PIECE(BP, from, to);
 			REMOVE_PIECE(WP, to + 8);
-			m_boardDescBB[BLACK_OCCUPIED] ^= (Bit(from) | Bit(to));
-			m_boardDescBB[WHITE_OCCUPIED] ^= Bit(to + 8);
+			m_state.boardDescBB[BLACK_OCCUPIED] ^= (Bit(from) | Bit(to));
+			m_state.boardDescBB[WHITE_OCCUPIED] ^= Bit(to + 8);
 		}
 	}
 	else
 	{
 		int32_t dy = GetY(from) - GetY(to);
 
-		bool isCapture = m_boardDescU8[to] != EMPTY; // this is only for NON-EP captures
+		bool isCapture = m_state.boardDescU8[to] != EMPTY; // this is only for NON-EP captures
 		bool isPromotion = promoType != 0;
 		bool isPawnDoubleMove = (pt == WP || pt == BP) && (dy != 1 && dy != -1);
 
 		if (isCapture && !isPromotion)
 		{
-			ulU8.PushBack(std::make_pair(from, m_boardDescU8[from]));
-			ulU8.PushBack(std::make_pair(to, m_boardDescU8[to]));
-			ulBB.PushBack(std::make_pair(pt, m_boardDescBB[pt]));
-			ulBB.PushBack(std::make_pair(m_boardDescU8[to], m_boardDescBB[m_boardDescU8[to]]));
 
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED, m_boardDescBB[WHITE_OCCUPIED]));
-			ulBB.PushBack(std::make_pair(BLACK_OCCUPIED, m_boardDescBB[BLACK_OCCUPIED]));
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][pt];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][m_boardDescU8[to]];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][pt];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][m_state.boardDescU8[to]];
 
 			REMOVE_PIECE(pt, from);
-			REPLACE_PIECE(m_boardDescU8[to], pt, to);
+			REPLACE_PIECE(m_state.boardDescU8[to], pt, to);
 
-			m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)] ^= Bit(to);
-			m_boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
+			m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)] ^= Bit(to);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
 		}
 		else if (!isPromotion && !isCapture)
 		{
-			ulU8.PushBack(std::make_pair(from, m_boardDescU8[from]));
-			ulU8.PushBack(std::make_pair(to, m_boardDescU8[to]));
-			ulBB.PushBack(std::make_pair(pt, m_boardDescBB[pt]));
 
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED | color, m_boardDescBB[WHITE_OCCUPIED | color]));
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][pt];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][pt];
 
 			MOVE_PIECE(pt, from, to);
-			m_boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
 		}
 		else if (isPromotion && isCapture)
 		{
-			ulU8.PushBack(std::make_pair(from, m_boardDescU8[from]));
-			ulU8.PushBack(std::make_pair(to, m_boardDescU8[to]));
-			ulBB.PushBack(std::make_pair(pt, m_boardDescBB[pt]));
-			ulBB.PushBack(std::make_pair(m_boardDescU8[to], m_boardDescBB[m_boardDescU8[to]]));
-			ulBB.PushBack(std::make_pair(promoType, m_boardDescBB[promoType]));
 
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED, m_boardDescBB[WHITE_OCCUPIED]));
-			ulBB.PushBack(std::make_pair(BLACK_OCCUPIED, m_boardDescBB[BLACK_OCCUPIED]));
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][promoType];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][m_boardDescU8[to]];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][promoType];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][m_state.boardDescU8[to]];
 
 			REMOVE_PIECE(pt, from);
-			REPLACE_PIECE(m_boardDescU8[to], promoType, to);
+			REPLACE_PIECE(m_state.boardDescU8[to], promoType, to);
 
-			m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)] ^= Bit(to);
-			m_boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
+			m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)] ^= Bit(to);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
 		}
 		else // !isCapture && isPromotion
 		{
-			ulU8.PushBack(std::make_pair(from, m_boardDescU8[from]));
-			ulU8.PushBack(std::make_pair(to, m_boardDescU8[to]));
-			ulBB.PushBack(std::make_pair(pt, m_boardDescBB[pt]));
-			ulBB.PushBack(std::make_pair(promoType, m_boardDescBB[promoType]));
 
-			ulBB.PushBack(std::make_pair(WHITE_OCCUPIED | color, m_boardDescBB[WHITE_OCCUPIED | color]));
 
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
-			m_boardDescBB[HASH] ^= PIECES_ZOBRIST[to][promoType];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[from][pt];
+			m_state.boardDescBB[HASH] ^= PIECES_ZOBRIST[to][promoType];
 
 			REMOVE_PIECE(pt, from);
 			PLACE_PIECE(promoType, to);
-			m_boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(to) | Bit(from);
 		}
 
 		// check for pawn move (update ep)
 		if (isPawnDoubleMove)
 		{
 			// this was saved to undo list earlier already
-			m_boardDescBB[EN_PASS_SQUARE] = PAWN_MOVE_1[from][pt == WP ? 0 : 1];
-			m_boardDescBB[HASH] ^= EN_PASS_ZOBRIST[BitScanForward(PAWN_MOVE_1[from][pt == WP ? 0 : 1])];
+			m_state.boardDescBB[EN_PASS_SQUARE] = PAWN_MOVE_1[from][pt == WP ? 0 : 1];
+			m_state.boardDescBB[HASH] ^= EN_PASS_ZOBRIST[BitScanForward(PAWN_MOVE_1[from][pt == WP ? 0 : 1])];
 		}
 
 		// update castling rights
-		if (m_boardDescU8[W_SHORT_CASTLE] && (pt == WK || (pt == WR && from == H1) || (to == H1)))
+		if (m_state.boardDescU8[W_SHORT_CASTLE] && (pt == WK || (pt == WR && from == H1) || (to == H1)))
 		{
-			ulU8.PushBack(std::make_pair(W_SHORT_CASTLE, m_boardDescU8[W_SHORT_CASTLE]));
-			m_boardDescU8[W_SHORT_CASTLE] = 0;
+			m_state.boardDescU8[W_SHORT_CASTLE] = 0;
 
-			m_boardDescBB[HASH] ^= W_SHORT_CASTLE_ZOBRIST;
+			m_state.boardDescBB[HASH] ^= W_SHORT_CASTLE_ZOBRIST;
 		}
 
-		if (m_boardDescU8[W_LONG_CASTLE] && (pt == WK || (pt == WR && from == A1) || (to == A1)))
+		if (m_state.boardDescU8[W_LONG_CASTLE] && (pt == WK || (pt == WR && from == A1) || (to == A1)))
 		{
-			ulU8.PushBack(std::make_pair(W_LONG_CASTLE, m_boardDescU8[W_LONG_CASTLE]));
-			m_boardDescU8[W_LONG_CASTLE] = 0;
+			m_state.boardDescU8[W_LONG_CASTLE] = 0;
 
-			m_boardDescBB[HASH] ^= W_LONG_CASTLE_ZOBRIST;
+			m_state.boardDescBB[HASH] ^= W_LONG_CASTLE_ZOBRIST;
 		}
 
-		if (m_boardDescU8[B_SHORT_CASTLE] && (pt == BK || (pt == BR && from == H8) || (to == H8)))
+		if (m_state.boardDescU8[B_SHORT_CASTLE] && (pt == BK || (pt == BR && from == H8) || (to == H8)))
 		{
-			ulU8.PushBack(std::make_pair(B_SHORT_CASTLE, m_boardDescU8[B_SHORT_CASTLE]));
-			m_boardDescU8[B_SHORT_CASTLE] = 0;
+			m_state.boardDescU8[B_SHORT_CASTLE] = 0;
 
-			m_boardDescBB[HASH] ^= B_SHORT_CASTLE_ZOBRIST;
+			m_state.boardDescBB[HASH] ^= B_SHORT_CASTLE_ZOBRIST;
 		}
 
-		if (m_boardDescU8[B_LONG_CASTLE] && (pt == BK || (pt == BR && from == A8) || (to == A8)))
+		if (m_state.boardDescU8[B_LONG_CASTLE] && (pt == BK || (pt == BR && from == A8) || (to == A8)))
 		{
-			ulU8.PushBack(std::make_pair(B_LONG_CASTLE, m_boardDescU8[B_LONG_CASTLE]));
-			m_boardDescU8[B_LONG_CASTLE] = 0;
+			m_state.boardDescU8[B_LONG_CASTLE] = 0;
 
-			m_boardDescBB[HASH] ^= B_LONG_CASTLE_ZOBRIST;
+			m_state.boardDescBB[HASH] ^= B_LONG_CASTLE_ZOBRIST;
 		}
 
 		// update half move clock
 		// castling does not reset the clock
-		ulU8.PushBack(std::make_pair(HALF_MOVES_CLOCK, m_boardDescU8[HALF_MOVES_CLOCK]));
 		if (isCapture || pt == WP || pt == BP)
 		{
-			m_boardDescU8[HALF_MOVES_CLOCK] = 0;
+			m_state.boardDescU8[HALF_MOVES_CLOCK] = 0;
 		}
 		else
 		{
-			if (m_boardDescU8[HALF_MOVES_CLOCK] != std::numeric_limits<uint8_t>::max())
+			if (m_state.boardDescU8[HALF_MOVES_CLOCK] != std::numeric_limits<uint8_t>::max())
 			{
-				++m_boardDescU8[HALF_MOVES_CLOCK];
+				++m_state.boardDescU8[HALF_MOVES_CLOCK];
 			}
 		}
 	}
@@ -799,31 +862,6 @@ bool Board::ApplyMove(Move mv)
 #ifdef DEBUG
 	CheckBoardConsistency();
 
-	// verify that we don't have duplicate entries in the undo lists
-	std::set<uint32_t> entries;
-	for (size_t i = 0; i < ulBB.GetSize(); ++i)
-	{
-		if (entries.find(ulBB[i].first) != entries.end())
-		{
-			std::cout << "Duplicate undo entry in BB undo list found! - " << static_cast<int>(ulBB[i].first) << std::endl;
-			assert(false);
-		}
-
-		entries.insert(ulBB[i].first);
-	}
-
-	entries.clear();
-	for (size_t i = 0; i < ulU8.GetSize(); ++i)
-	{
-		if (entries.find(ulU8[i].first) != entries.end())
-		{
-			std::cout << "Duplicate undo entry in U8 undo list found! - " << ulU8[i].first << std::endl;
-			assert(false);
-		}
-
-		entries.insert(ulU8[i].first);
-	}
-
 	// verify that we have updated the hash correctly
 	uint64_t oldHash = GetHash();
 	UpdateHashFull_();
@@ -840,34 +878,19 @@ bool Board::ApplyMove(Move mv)
 
 	if (InCheck())
 	{
-		// this position is illegal, undo the move
-		for (size_t i = 0; i < ulBB.GetSize(); ++i)
-		{
-			m_boardDescBB[ulBB[i].first] = ulBB[i].second;
-		}
-
-		// this position is illegal, undo the move
-		for (size_t i = 0; i < ulU8.GetSize(); ++i)
-		{
-			m_boardDescU8[ulU8[i].first] = ulU8[i].second;
-		}
-
-		m_boardDescBB[HASH] = m_hashStack.Pop();
-
-		m_undoStackBB.Pop();
-		m_undoStackU8.Pop();
+		// this position is illegal, undo the move (UndoMove expects the side to move to have been switched)
+		m_state.boardDescU8[SIDE_TO_MOVE] = m_state.boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
+		UndoMove();
 
 		return false;
 	}
 
 	// no need to store this
-	m_boardDescU8[SIDE_TO_MOVE] = m_boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
-	m_boardDescBB[HASH] ^= SIDE_TO_MOVE_ZOBRIST;
+	m_state.boardDescU8[SIDE_TO_MOVE] = m_state.boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
+	m_state.boardDescBB[HASH] ^= SIDE_TO_MOVE_ZOBRIST;
 
 	UpdateInCheck_(); // this is for the new side
 
-	m_moveStack.Push(mv);
-
 	return true;
 
 #undef MOVE_PIECE
@@ -878,166 +901,248 @@ Board::CheckInfo Board::ComputeCheckInfo() const
 {
 	CheckInfo ret;
 
-	Square kingPos = (GetSideToMove() == WHITE ? BitScanForward(m_boardDescBB[WK]) : BitScanForward(m_boardDescBB[BK]));
-	int32_t kingX = GetX(kingPos);
-	int32_t kingY = GetY(kingPos);
-	int32_t kingDiag0 = GetDiag0(kingPos);
-	int32_t kingDiag1 = GetDiag1(kingPos);
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
+	Color enemyColor = stm ^ COLOR_MASK;
+	uint64_t allOccupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
+
+	ret.kingPos = BitScanForward(m_state.boardDescBB[WK | stm]);
+	ret.checkers = GetAttackersOf_(ret.kingPos, allOccupied);
 
-	uint64_t opponentQueens = (GetSideToMove() == WHITE ? m_boardDescBB[BQ] : m_boardDescBB[WQ]);
-	uint64_t opponentRooks = (GetSideToMove() == WHITE ? m_boardDescBB[BR] : m_boardDescBB[WR]);
-	uint64_t opponentBishops = (GetSideToMove() == WHITE ? m_boardDescBB[BB] : m_boardDescBB[WB]);
+	// opponent sliders that would be attacking our king on an empty board are potential pinners
+	uint64_t pinners =
+		(SliderAttacks::Rook(ret.kingPos, 0) & (m_state.boardDescBB[WQ | enemyColor] | m_state.boardDescBB[WR | enemyColor])) |
+		(SliderAttacks::Bishop(ret.kingPos, 0) & (m_state.boardDescBB[WQ | enemyColor] | m_state.boardDescBB[WB | enemyColor]));
 
-	while (opponentQueens)
+	while (pinners)
 	{
-		Square pos = Extract(opponentQueens);
+		Square pos = Extract(pinners);
 
-		// all the cases are mutually exclusive
-		if (GetX(pos) == kingX)
-		{
-			ret.opponentRQOnSameX = true;
-		}
-		else if (GetY(pos) == kingY)
-		{
-			ret.opponentRQOnSameY = true;
-		}
-		else if (GetDiag0(pos) == kingDiag0)
-		{
-			ret.opponentBQOnSameDiag0 = true;
-		}
-		else if (GetDiag1(pos) == kingDiag1)
+		uint64_t blockers = BETWEEN[ret.kingPos][pos] & allOccupied;
+
+		// a piece is pinned if it's the only piece between the king and the pinner, and it's ours
+		if (blockers && !(blockers & (blockers - 1)) && (blockers & m_state.boardDescBB[WHITE_OCCUPIED | stm]))
 		{
-			ret.opponentBQOnSameDiag1 = true;
+			ret.pinned |= blockers;
 		}
 	}
 
-	while (opponentRooks)
+	if (!ret.checkers)
 	{
-		Square pos = Extract(opponentRooks);
-
-		// all the cases are mutually exclusive
-		if (GetX(pos) == kingX)
-		{
-			ret.opponentRQOnSameX = true;
-		}
-		else if (GetY(pos) == kingY)
-		{
-			ret.opponentRQOnSameY = true;
-		}
+		ret.targets = ~0ULL;
+	}
+	else if (!(ret.checkers & (ret.checkers - 1)))
+	{
+		// we have to either capture the checker or block
+		ret.targets = ret.checkers | BETWEEN[ret.kingPos][BitScanForward(ret.checkers)];
 	}
+	else
+	{
+		ret.targets = 0;
+	}
+
+	return ret;
+}
+
+Board::GivesCheckInfo Board::ComputeGivesCheckInfo() const
+{
+	GivesCheckInfo ret;
 
-	while (opponentBishops)
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
+	Color enemyColor = stm ^ COLOR_MASK;
+	uint64_t allOccupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
+
+	ret.enemyKingPos = BitScanForward(m_state.boardDescBB[WK | enemyColor]);
+
+	// a piece attacks the king from a square if the same piece on the king square would attack that square
+	// (for pawns, it's an enemy pawn on the king square)
+	ret.checkSquares[P] = PAWN_ATK[ret.enemyKingPos][enemyColor == WHITE ? 0 : 1];
+	ret.checkSquares[N] = KNIGHT_ATK[ret.enemyKingPos];
+	ret.checkSquares[B] = SliderAttacks::Bishop(ret.enemyKingPos, allOccupied);
+	ret.checkSquares[R] = SliderAttacks::Rook(ret.enemyKingPos, allOccupied);
+	ret.checkSquares[Q] = ret.checkSquares[B] | ret.checkSquares[R];
+	ret.checkSquares[K] = 0;
+
+	// this is the same as finding pinned pieces in ComputeCheckInfo(), but with our sliders and their king
+	uint64_t snipers =
+		(SliderAttacks::Rook(ret.enemyKingPos, 0) & (m_state.boardDescBB[WQ | stm] | m_state.boardDescBB[WR | stm])) |
+		(SliderAttacks::Bishop(ret.enemyKingPos, 0) & (m_state.boardDescBB[WQ | stm] | m_state.boardDescBB[WB | stm]));
+
+	while (snipers)
 	{
-		Square pos = Extract(opponentBishops);
+		Square pos = Extract(snipers);
 
-		// all the cases are mutually exclusive
-		if (GetDiag0(pos) == kingDiag0)
-		{
-			ret.opponentBQOnSameDiag0 = true;
-		}
-		else if (GetDiag1(pos) == kingDiag1)
+		uint64_t blockers = BETWEEN[ret.enemyKingPos][pos] & allOccupied;
+
+		if (blockers && !(blockers & (blockers - 1)) && (blockers & m_state.boardDescBB[WHITE_OCCUPIED | stm]))
 		{
-			ret.opponentBQOnSameDiag1 = true;
+			ret.discoveredCheckers |= blockers;
 		}
 	}
 
 	return ret;
 }
 
-bool Board::CheckLegal(const CheckInfo &ci, Move mv)
+bool Board::GivesCheck(Move mv, const GivesCheckInfo &gci) const
 {
-	// in this function we try to determine legality of moves quickly without doing a full check (by applying the move)
 	PieceType pt = GetPieceType(mv);
+	Color color = pt & COLOR_MASK;
+	Square from = GetFromSquare(mv);
+	Square to = GetToSquare(mv);
+	uint64_t kingBit = Bit(gci.enemyKingPos);
+	uint64_t allOccupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
 
-	bool doFullCheck = false;
+	if (IsCastling(mv))
+	{
+		// only the rook can give check (the king stays on the back rank, with the rook between it and
+		// anything it could uncover)
+		Square rookFrom;
+		Square rookTo;
+		GetCastlingRookSquares(mv, rookFrom, rookTo);
 
-	if (InCheck())
+		uint64_t occupancy = (allOccupied ^ Bit(from) ^ Bit(rookFrom)) | Bit(to) | Bit(rookTo);
+
+		return SliderAttacks::Rook(rookTo, occupancy) & kingBit;
+	}
+
+	// discovered check (the moving piece can't be on the line if it moves along it)
+	if ((gci.discoveredCheckers & Bit(from)) && !(LINE[from][gci.enemyKingPos] & Bit(to)))
 	{
-		// if we are in check, do a full check because there are many potential ways to get out of check, and we are lazy
-		doFullCheck = true;
+		return true;
 	}
-	else
+
+	if (IsPromotion(mv))
 	{
-		switch (pt)
+		// check squares were computed with the pawn still on the from square, which may be on the line from
+		// the promotion square to the king
+		uint64_t occupancy = allOccupied ^ Bit(from);
+
+		switch (StripColor(GetPromoType(mv)))
 		{
-		case WK:
-		case BK:
-			// if this is a king move, we do a full check because any king move can potentially put the king in check
-			// this includes castling
-			doFullCheck = true;
-			break;
-		case WP:
-		case BP:
-			if (Bit(GetToSquare(mv)) == m_boardDescBB[EN_PASS_SQUARE])
-			{
-				// if this is EP, we do a full check... because EPs are rare, and we are lazy
-				doFullCheck = true;
-				break;
-			}
-			// fall through if this is a pawn move that's not EP
-		default:
-			{
-				doFullCheck = false;
+		case Q: return SliderAttacks::Queen(to, occupancy) & kingBit;
+		case R: return SliderAttacks::Rook(to, occupancy) & kingBit;
+		case B: return SliderAttacks::Bishop(to, occupancy) & kingBit;
+		default: return KNIGHT_ATK[to] & kingBit;
+		}
+	}
 
-				// now we know we are not moving the king, this is not EP, and the king is not already in check
-				// in this case, the only way this move can put the king in check is if we just moved away a pinned piece
-				// besides EP and castling (both have been dealt with), the only square that will be vacated after a move is the from square
+	if (gci.checkSquares[StripColor(pt)] & Bit(to))
+	{
+		return true;
+	}
 
-				Square vacatedSquare = GetFromSquare(mv);
-				Square kingPos = BitScanForward(GetSideToMove() == WHITE ? m_boardDescBB[WK] : m_boardDescBB[BK]);
+	if (StripColor(pt) == P && Bit(to) == m_state.boardDescBB[EN_PASS_SQUARE])
+	{
+		// the captured pawn can also uncover a check
+		Square capturedSq = (color == WHITE) ? (to - 8) : (to + 8);
+		uint64_t occupancy = (allOccupied ^ Bit(from) ^ Bit(capturedSq)) | Bit(to);
 
-				if ((ci.opponentRQOnSameX && (GetX(vacatedSquare) == GetX(kingPos))) ||
-					(ci.opponentRQOnSameY && (GetY(vacatedSquare) == GetY(kingPos))) ||
-					(ci.opponentBQOnSameDiag0 && (GetDiag0(vacatedSquare) == GetDiag0(kingPos))) ||
-					(ci.opponentBQOnSameDiag1 && (GetDiag1(vacatedSquare) == GetDiag1(kingPos))))
-				{
-					doFullCheck = true;
-				}
-			}
-		}
+		return
+			(SliderAttacks::Rook(gci.enemyKingPos, occupancy) & (m_state.boardDescBB[WQ | color] | m_state.boardDescBB[WR | color])) ||
+			(SliderAttacks::Bishop(gci.enemyKingPos, occupancy) & (m_state.boardDescBB[WQ | color] | m_state.boardDescBB[WB | color]));
 	}
 
-	if (doFullCheck)
+	return false;
+}
+
+void Board::UndoMove()
+{
+	UndoRecord &ur = m_undoStack.Top();
+
+	// this is the only thing not stored in the undo record
+	m_state.boardDescU8[SIDE_TO_MOVE] = m_state.boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
+
+	Move mv = ur.move;
+
+	if (mv != NULL_MOVE)
 	{
-		bool ret = ApplyMove(mv);
-		if (ret)
+		PieceType pt = GetPieceType(mv);
+		Square from = GetFromSquare(mv);
+		Square to = GetToSquare(mv);
+		Color color = pt & COLOR_MASK;
+		PieceType promoType = GetPromoType(mv);
+
+		if (IsCastling(mv))
 		{
-			UndoMove();
-			return true;
+			// move the king and the rook back
+			PieceType rook = WR | color;
+			Square rookFrom;
+			Square rookTo;
+			GetCastlingRookSquares(mv, rookFrom, rookTo);
+
+			m_state.boardDescBB[pt] ^= Bit(from) | Bit(to);
+			m_state.boardDescBB[rook] ^= Bit(rookFrom) | Bit(rookTo);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(from) | Bit(to) | Bit(rookFrom) | Bit(rookTo);
+
+			m_state.boardDescU8[from] = pt;
+			m_state.boardDescU8[to] = EMPTY;
+			m_state.boardDescU8[rookFrom] = rook;
+			m_state.boardDescU8[rookTo] = EMPTY;
+		}
+		else if ((pt == WP || pt == BP) && ur.epSquare != 0 && to == ur.epSquare)
+		{
+			// en passant, the captured pawn is not on the destination square
+			Square capturedSq = (pt == WP) ? (to - 8) : (to + 8);
+			PieceType capturedPt = pt ^ COLOR_MASK;
+
+			m_state.boardDescBB[pt] ^= Bit(from) | Bit(to);
+			m_state.boardDescBB[capturedPt] |= Bit(capturedSq);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(from) | Bit(to);
+			m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)] |= Bit(capturedSq);
+
+			m_state.boardDescU8[from] = pt;
+			m_state.boardDescU8[to] = EMPTY;
+			m_state.boardDescU8[capturedSq] = capturedPt;
 		}
 		else
 		{
-			return false;
+			PieceType ptAtDst = promoType ? promoType : pt;
+
+			m_state.boardDescBB[ptAtDst] &= InvBit(to);
+			m_state.boardDescBB[pt] |= Bit(from);
+			m_state.boardDescBB[WHITE_OCCUPIED | color] ^= Bit(from) | Bit(to);
+
+			m_state.boardDescU8[from] = pt;
+			m_state.boardDescU8[to] = ur.captured;
+
+			if (ur.captured != EMPTY)
+			{
+				m_state.boardDescBB[ur.captured] |= Bit(to);
+				m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)] |= Bit(to);
+			}
 		}
 	}
 
-	return true;
+	m_state.boardDescBB[EN_PASS_SQUARE] = (ur.epSquare != 0) ? Bit(ur.epSquare) : 0ULL;
+	m_state.boardDescU8[W_SHORT_CASTLE] = (ur.castlingRights >> 0) & 0x1;
+	m_state.boardDescU8[W_LONG_CASTLE] = (ur.castlingRights >> 1) & 0x1;
+	m_state.boardDescU8[B_SHORT_CASTLE] = (ur.castlingRights >> 2) & 0x1;
+	m_state.boardDescU8[B_LONG_CASTLE] = (ur.castlingRights >> 3) & 0x1;
+	m_state.boardDescU8[HALF_MOVES_CLOCK] = ur.halfMovesClock;
+	m_state.boardDescU8[IN_CHECK] = ur.inCheck;
+	m_state.boardDescBB[HASH] = ur.hash;
+
+	m_undoStack.Pop();
+	PopHashHistory_();
+	m_moveStack.Pop();
 }
 
-void Board::UndoMove()
+void Board::SaveUndoRecord_(UndoRecord &ur, Move mv) const
 {
-	UndoListBB &ulBB = m_undoStackBB.Top();
-	UndoListU8 &ulU8 = m_undoStackU8.Top();
-
-	// this is the only thing not stored in the undo list
-	m_boardDescU8[SIDE_TO_MOVE] = m_boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
-
-	for (size_t i = 0; i < ulBB.GetSize(); ++i)
-	{
-		m_boardDescBB[ulBB[i].first] = ulBB[i].second;
-	}
-
-	for (size_t i = 0; i < ulU8.GetSize(); ++i)
-	{
-		m_boardDescU8[ulU8[i].first] = ulU8[i].second;
-	}
+	ur.hash = m_state.boardDescBB[HASH];
+	ur.move = mv;
+	ur.captured = (mv != NULL_MOVE) ? m_state.boardDescU8[GetToSquare(mv)] : EMPTY;
 
-	m_boardDescBB[HASH] = m_hashStack.Pop();
+	ur.castlingRights =
+		(m_state.boardDescU8[W_SHORT_CASTLE] << 0) |
+		(m_state.boardDescU8[W_LONG_CASTLE] << 1) |
+		(m_state.boardDescU8[B_SHORT_CASTLE] << 2) |
+		(m_state.boardDescU8[B_LONG_CASTLE] << 3);
 
-	m_undoStackBB.Pop();
-	m_undoStackU8.Pop();
+	// a1 can never be an en passant square, so we use it for none
+	ur.epSquare = m_state.boardDescBB[EN_PASS_SQUARE] ? BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE]) : 0;
 
-	m_moveStack.Pop();
+	ur.halfMovesClock = m_state.boardDescU8[HALF_MOVES_CLOCK];
+	ur.inCheck = m_state.boardDescU8[IN_CHECK];
 }
 
 std::string Board::MoveToAlg(Move mv, MoveFormat mf)
@@ -1246,11 +1351,51 @@ std::string Board::PVToStr(std::vector<Move> &pv) const
 	return ret;
 }
 
+void Board::CloneFrom(const Board &other)
+{
+	std::memcpy(&m_state, &other.m_state, sizeof(m_state));
+
+	m_undoStack.Clear();
+
+	// positions before the last irreversible move can never be repeated
+	size_t historySize = std::min<size_t>(other.m_hashStack.GetSize(), m_state.boardDescU8[HALF_MOVES_CLOCK]);
+	size_t historyStart = other.m_hashStack.GetSize() - historySize;
+
+	// every non-zero filter slot has a hash in the history, so this is cheaper than clearing the whole filter
+	for (size_t i = 0; i < m_hashStack.GetSize(); ++i)
+	{
+		m_repetitionFilter[RepetitionFilterSlot_(m_hashStack[i])] = 0;
+	}
+
+	m_hashStack.Clear();
+	m_moveStack.Clear();
+
+	for (size_t i = historyStart; i < other.m_hashStack.GetSize(); ++i)
+	{
+		PushHashHistory_(other.m_hashStack[i]);
+		m_moveStack.Push(other.m_moveStack[i]);
+	}
+}
+
+void Board::ReserveUndo(size_t moves)
+{
+	m_undoStack.Reserve(moves);
+	m_hashStack.Reserve(moves);
+	m_moveStack.Reserve(moves);
+}
+
+bool Board::CopyMake(const Board &parent, Move mv)
+{
+	CloneFrom(parent);
+
+	return ApplyMove(mv);
+}
+
 bool Board::operator==(const Board &other)
 {
 	for (size_t i = 0; i < BOARD_DESC_BB_SIZE; ++i)
 	{
-		if (m_boardDescBB[i] != other.m_boardDescBB[i])
+		if (m_state.boardDescBB[i] != other.m_state.boardDescBB[i])
 		{
 			//std::cout << i << std::endl;
 			//DebugPrint(m_boardDesc[i]);
@@ -1261,7 +1406,7 @@ bool Board::operator==(const Board &other)
 
 	for (size_t i = 0; i < BOARD_DESC_U8_SIZE; ++i)
 	{
-		if (m_boardDescU8[i] != other.m_boardDescU8[i])
+		if (m_state.boardDescU8[i] != other.m_state.boardDescU8[i])
 		{
 			//std::cout << i << std::endl;
 			//DebugPrint(m_boardDesc[i]);
@@ -1286,7 +1431,7 @@ Move Board::ParseMove(std::string str)
 		str.erase(std::remove(str.begin(), str.end(), decChars[i]), str.end());
 	}
 
-	if (PatternMatch(str, "[a-h][1-8][a-h][1-8]"))
+	if (MatchMovePattern(str, CoordinateMovePattern))
 	{
 		char srcX;
 		int srcY;
@@ -1314,7 +1459,7 @@ Move Board::ParseMove(std::string str)
 	}
 
 	// algebraic promotion
-	if (PatternMatch(str, "[a-h][1-8][a-h][1-8][QBRNqbrn]"))
+	if (MatchMovePattern(str, CoordinatePromoPattern))
 	{
 		char srcX;
 		int srcY;
@@ -1345,7 +1490,7 @@ Move Board::ParseMove(std::string str)
 				break;
 			}
 
-			promoType = static_cast<PieceType>(promoType | m_boardDescU8[SIDE_TO_MOVE]);
+			promoType = static_cast<PieceType>(promoType | m_state.boardDescU8[SIDE_TO_MOVE]);
 
 			srcX -= 'a';
 			dstX -= 'a';
@@ -1398,7 +1543,7 @@ Move Board::ParseMove(std::string str)
 		std::cerr << "Illegal castling: " << str << std::endl;
 		return 0;
 	}
-	else if (!PatternMatch(str, "[KQBNR]?[a-h]?[1-8]?[a-h][1-8][QBRN]?"))
+	else if (!MatchMovePattern(str, SanMovePattern))
 	{
 		return 0;
 	}
@@ -1576,21 +1721,21 @@ Move Board::ParseMove(std::string str)
 
 bool Board::IsZugzwangProbable()
 {
-	if (m_boardDescU8[SIDE_TO_MOVE] == WHITE)
+	if (m_state.boardDescU8[SIDE_TO_MOVE] == WHITE)
 	{
 		return !(
-			m_boardDescBB[WR] ||
-			m_boardDescBB[WQ] ||
-			m_boardDescBB[WB] ||
-			m_boardDescBB[WN]);
+			m_state.boardDescBB[WR] ||
+			m_state.boardDescBB[WQ] ||
+			m_state.boardDescBB[WB] ||
+			m_state.boardDescBB[WN]);
 	}
 	else
 	{
 		return !(
-			m_boardDescBB[BR] ||
-			m_boardDescBB[BQ] ||
-			m_boardDescBB[BB] ||
-			m_boardDescBB[BN]);
+			m_state.boardDescBB[BR] ||
+			m_state.boardDescBB[BQ] ||
+			m_state.boardDescBB[BB] ||
+			m_state.boardDescBB[BN]);
 	}
 }
 
@@ -1598,28 +1743,23 @@ void Board::MakeNullMove()
 {
 	assert(!InCheck());
 
-	UndoListBB &undoListBB = m_undoStackBB.PrePush();
-	UndoListU8 &undoListU8 = m_undoStackU8.PrePush(); // this is empty, but we still need to push
-
-	undoListBB.Clear();
-	undoListU8.Clear();
+	UndoRecord &ur = m_undoStack.PrePush();
+	SaveUndoRecord_(ur, NULL_MOVE);
 
-	m_hashStack.Push(m_boardDescBB[HASH]);
+	PushHashHistory_(m_state.boardDescBB[HASH]);
 
 	m_moveStack.Push(0);
 
 	// this doesn't need to be stored in the undo stack
-	m_boardDescU8[SIDE_TO_MOVE] ^= COLOR_MASK;
+	m_state.boardDescU8[SIDE_TO_MOVE] ^= COLOR_MASK;
 
-	if (m_boardDescBB[EN_PASS_SQUARE])
+	if (m_state.boardDescBB[EN_PASS_SQUARE])
 	{
-		undoListBB.PushBack(std::make_pair(EN_PASS_SQUARE, m_boardDescBB[EN_PASS_SQUARE]));
-		m_boardDescBB[HASH] ^= EN_PASS_ZOBRIST[BitScanForward(m_boardDescBB[EN_PASS_SQUARE])];
-		m_boardDescBB[EN_PASS_SQUARE] = 0;
+		m_state.boardDescBB[HASH] ^= EN_PASS_ZOBRIST[BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE])];
+		m_state.boardDescBB[EN_PASS_SQUARE] = 0;
 	}
 
-	undoListBB.PushBack(std::make_pair(HASH, m_boardDescBB[HASH]));
-	m_boardDescBB[HASH] ^= SIDE_TO_MOVE_ZOBRIST;
+	m_state.boardDescBB[HASH] ^= SIDE_TO_MOVE_ZOBRIST;
 
 	UpdateInCheck_();
 
@@ -1637,10 +1777,10 @@ bool Board::CheckPseudoLegal(Move mv)
 	Square to = GetToSquare(mv);
 	Color color = pt & COLOR_MASK;
 
-	PieceType toPt = m_boardDescU8[to];
-	Color toColor = m_boardDescU8[to] & COLOR_MASK;
+	PieceType toPt = m_state.boardDescU8[to];
+	Color toColor = m_state.boardDescU8[to] & COLOR_MASK;
 
-	uint64_t totalOccupancy = m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED];
+	uint64_t totalOccupancy = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
 
 	// there is no legal move where the destination is occupied by a friendly piece
 	if (toPt != EMPTY && toColor == color)
@@ -1649,13 +1789,13 @@ bool Board::CheckPseudoLegal(Move mv)
 	}
 
 	// if the from piece doesn't exist...
-	if (pt != m_boardDescU8[from])
+	if (pt != m_state.boardDescU8[from])
 	{
 		return false;
 	}
 
 	// wrong side to move
-	if (color != m_boardDescU8[SIDE_TO_MOVE])
+	if (color != m_state.boardDescU8[SIDE_TO_MOVE])
 	{
 		return false;
 	}
@@ -1669,24 +1809,24 @@ bool Board::CheckPseudoLegal(Move mv)
 	else if (ptNoColor == WR)
 	{
 		// for rooks, we actually have to do move generation, because there may be an additional blocker
-		return Rmagic(from, totalOccupancy) & Bit(to);
+		return SliderAttacks::Rook(from, totalOccupancy) & Bit(to);
 	}
 	else if (ptNoColor == WB)
 	{
 		// for bishops, we actually have to do move generation, because there may be an additional blocker
-		return Bmagic(from, totalOccupancy) & Bit(to);
+		return SliderAttacks::Bishop(from, totalOccupancy) & Bit(to);
 	}
 	else if (ptNoColor == WQ)
 	{
 		// for queens, we actually have to do move generation, because there may be an additional blocker
-		return Qmagic(from, totalOccupancy) & Bit(to);
+		return SliderAttacks::Queen(from, totalOccupancy) & Bit(to);
 	}
 	else if (ptNoColor == WP)
 	{
 		// if from and to are on different files, this must be a capture or en passant
 		if (GetX(from) != GetX(to))
 		{
-			return (toPt != EMPTY) || (m_boardDescBB[EN_PASS_SQUARE] && to == BitScanForward(m_boardDescBB[EN_PASS_SQUARE])); // we have already checked for friendly
+			return (toPt != EMPTY) || (m_state.boardDescBB[EN_PASS_SQUARE] && to == BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE])); // we have already checked for friendly
 		}
 		else if ((GetY(from) - GetY(to)) == 1 || (GetY(from) - GetY(to)) == -1)
 		{
@@ -1698,7 +1838,7 @@ bool Board::CheckPseudoLegal(Move mv)
 			// only other move type is a 2 square push, in which case both the destination and square jumped over
 			// must be empty
 			Square midSquare = (from + to) / 2;
-			return toPt == EMPTY && m_boardDescU8[midSquare] == EMPTY;
+			return toPt == EMPTY && m_state.boardDescU8[midSquare] == EMPTY;
 		}
 	}
 	else
@@ -1707,39 +1847,39 @@ bool Board::CheckPseudoLegal(Move mv)
 		// castling is the only special case here
 		if (from == E1 && to == G1)
 		{
-			return	m_boardDescU8[W_SHORT_CASTLE] &&
-					m_boardDescU8[H1] == WR &&
-					m_boardDescU8[F1] == EMPTY &&
-					m_boardDescU8[G1] == EMPTY &&
+			return	m_state.boardDescU8[W_SHORT_CASTLE] &&
+					m_state.boardDescU8[H1] == WR &&
+					m_state.boardDescU8[F1] == EMPTY &&
+					m_state.boardDescU8[G1] == EMPTY &&
 					!IsUnderAttack_(E1) &&
 					!IsUnderAttack_(F1);
 		}
 		else if (from == E1 && to == C1)
 		{
-			return	m_boardDescU8[W_LONG_CASTLE] &&
-					m_boardDescU8[A1] == WR &&
-					m_boardDescU8[B1] == EMPTY &&
-					m_boardDescU8[C1] == EMPTY &&
-					m_boardDescU8[D1] == EMPTY &&
+			return	m_state.boardDescU8[W_LONG_CASTLE] &&
+					m_state.boardDescU8[A1] == WR &&
+					m_state.boardDescU8[B1] == EMPTY &&
+					m_state.boardDescU8[C1] == EMPTY &&
+					m_state.boardDescU8[D1] == EMPTY &&
 					!IsUnderAttack_(E1) &&
 					!IsUnderAttack_(D1);
 		}
 		else if (from == E8 && to == G8)
 		{
-			return	m_boardDescU8[B_SHORT_CASTLE] &&
-					m_boardDescU8[H8] == BR &&
-					m_boardDescU8[F8] == EMPTY &&
-					m_boardDescU8[G8] == EMPTY &&
+			return	m_state.boardDescU8[B_SHORT_CASTLE] &&
+					m_state.boardDescU8[H8] == BR &&
+					m_state.boardDescU8[F8] == EMPTY &&
+					m_state.boardDescU8[G8] == EMPTY &&
 					!IsUnderAttack_(E8) &&
 					!IsUnderAttack_(F8);
 		}
 		else if (from == E8 && to == C8)
 		{
-			return	m_boardDescU8[B_LONG_CASTLE] &&
-					m_boardDescU8[A8] == BR &&
-					m_boardDescU8[B8] == EMPTY &&
-					m_boardDescU8[C8] == EMPTY &&
-					m_boardDescU8[D8] == EMPTY &&
+			return	m_state.boardDescU8[B_LONG_CASTLE] &&
+					m_state.boardDescU8[A8] == BR &&
+					m_state.boardDescU8[B8] == EMPTY &&
+					m_state.boardDescU8[C8] == EMPTY &&
+					m_state.boardDescU8[D8] == EMPTY &&
 					!IsUnderAttack_(E8) &&
 					!IsUnderAttack_(D8);
 		}
@@ -1754,43 +1894,43 @@ bool Board::CheckPseudoLegal(Move mv)
 bool Board::IsViolent(Move mv)
 {
 	bool isQPromo = GetPromoType(mv) == WQ || GetPromoType(mv) == BQ;
-	bool isCapture = m_boardDescU8[GetToSquare(mv)] != EMPTY || Bit(GetToSquare(mv)) == m_boardDescBB[EN_PASS_SQUARE];
+	bool isCapture = m_state.boardDescU8[GetToSquare(mv)] != EMPTY || Bit(GetToSquare(mv)) == m_state.boardDescBB[EN_PASS_SQUARE];
 
 	return isQPromo || isCapture;
 }
 
 bool Board::HasPawnOn7th()
 {
-	if (m_boardDescU8[SIDE_TO_MOVE] == WHITE)
+	if (m_state.boardDescU8[SIDE_TO_MOVE] == WHITE)
 	{
-		return RANKS[RANK_7] & m_boardDescBB[WP];
+		return RANKS[RANK_7] & m_state.boardDescBB[WP];
 	}
 	else
 	{
-		return RANKS[RANK_2] & m_boardDescBB[BP];
+		return RANKS[RANK_2] & m_state.boardDescBB[BP];
 	}
 }
 
 PieceType Board::GetOpponentLargestPieceType()
 {
-	Color opponentColor = m_boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
+	Color opponentColor = m_state.boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK;
 
-	if (m_boardDescBB[WQ | opponentColor])
+	if (m_state.boardDescBB[WQ | opponentColor])
 	{
 		return WQ;
 	}
 
-	if (m_boardDescBB[WR | opponentColor])
+	if (m_state.boardDescBB[WR | opponentColor])
 	{
 		return WR;
 	}
 
-	if (m_boardDescBB[WB | opponentColor])
+	if (m_state.boardDescBB[WB | opponentColor])
 	{
 		return WB;
 	}
 
-	if (m_boardDescBB[WN | opponentColor])
+	if (m_state.boardDescBB[WN | opponentColor])
 	{
 		return WN;
 	}
@@ -1799,14 +1939,20 @@ PieceType Board::GetOpponentLargestPieceType()
 	return WP;
 }
 
-bool Board::Is3Fold()
+bool Board::Is3Fold() const
 {
 	// see whether this position has appeared twice already (at this point, the current hash shouldn't be in the stack)
-	// it doesn't matter what order - we are iterating through the whole list anyways
+	if (m_repetitionFilter[RepetitionFilterSlot_(m_state.boardDescBB[HASH])] < 2)
+	{
+		return false;
+	}
+
+	size_t end = std::min<size_t>(m_state.boardDescU8[HALF_MOVES_CLOCK], m_hashStack.GetSize());
+
 	uint32_t count = 0;
-	for (size_t i = 0; i < m_hashStack.GetSize(); ++i)
+	for (size_t i = 2; i <= end; i += 2)
 	{
-		if (m_hashStack[i] == m_boardDescBB[HASH])
+		if (m_hashStack[m_hashStack.GetSize() - i] == m_state.boardDescBB[HASH])
 		{
 			++count;
 
@@ -1820,16 +1966,18 @@ bool Board::Is3Fold()
 	return false;
 }
 
-bool Board::Is2Fold(size_t numMoves)
+bool Board::Is2Fold() const
 {
-	if (numMoves > m_hashStack.GetSize())
+	if (m_repetitionFilter[RepetitionFilterSlot_(m_state.boardDescBB[HASH])] == 0)
 	{
-		numMoves = m_hashStack.GetSize();
+		return false;
 	}
 
-	for (size_t i = 0; i < numMoves; ++i)
+	size_t end = std::min<size_t>(m_state.boardDescU8[HALF_MOVES_CLOCK], m_hashStack.GetSize());
+
+	for (size_t i = 2; i <= end; i += 2)
 	{
-		if (m_hashStack[m_hashStack.GetSize() - 1 - i] == m_boardDescBB[HASH])
+		if (m_hashStack[m_hashStack.GetSize() - i] == m_state.boardDescBB[HASH])
 		{
 			return true;
 		}
@@ -1838,10 +1986,76 @@ bool Board::Is2Fold(size_t numMoves)
 	return false;
 }
 
+bool Board::HasUpcomingRepetition() const
+{
+	size_t end = std::min<size_t>(m_state.boardDescU8[HALF_MOVES_CLOCK], m_hashStack.GetSize());
+
+	uint64_t occupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
+
+	// a position an even number of plies ago has the same side to move, so it can't be reached in one move
+	// and the position 1 ply ago can only be reached by a null move
+	for (size_t i = 3; i <= end; i += 2)
+	{
+		uint64_t moveKey = m_state.boardDescBB[HASH] ^ m_hashStack[m_hashStack.GetSize() - i];
+
+		size_t slot = CuckooH1(moveKey);
+
+		if (CUCKOO_KEYS[slot] != moveKey)
+		{
+			slot = CuckooH2(moveKey);
+
+			if (CUCKOO_KEYS[slot] != moveKey)
+			{
+				continue;
+			}
+		}
+
+		Square sq1 = CUCKOO_SQUARES[slot] & 0xff;
+		Square sq2 = CUCKOO_SQUARES[slot] >> 8;
+
+		if (BETWEEN[sq1][sq2] & occupied)
+		{
+			continue;
+		}
+
+		// the move can go either way, but it has to be made by the side to move
+		PieceType pt = m_state.boardDescU8[(occupied & Bit(sq1)) ? sq1 : sq2];
+
+		if (pt != EMPTY && (pt & COLOR_MASK) == m_state.boardDescU8[SIDE_TO_MOVE])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Board::PushHashHistory_(uint64_t hash)
+{
+	m_hashStack.Push(hash);
+
+	uint8_t &count = m_repetitionFilter[RepetitionFilterSlot_(hash)];
+
+	if (count != 0xff)
+	{
+		++count;
+	}
+}
+
+void Board::PopHashHistory_()
+{
+	uint8_t &count = m_repetitionFilter[RepetitionFilterSlot_(m_hashStack.Pop())];
+
+	if (count != 0xff)
+	{
+		--count;
+	}
+}
+
 bool Board::HasInsufficientMaterial(bool relaxed) const
 {
 	// if we have any queen or rook or pawn, this is not insufficient
-	if (m_boardDescBB[WP] || m_boardDescBB[BP] || m_boardDescBB[WQ] || m_boardDescBB[BQ] || m_boardDescBB[WR] || m_boardDescBB[BR])
+	if (m_state.boardDescBB[WP] || m_state.boardDescBB[BP] || m_state.boardDescBB[WQ] || m_state.boardDescBB[BQ] || m_state.boardDescBB[WR] || m_state.boardDescBB[BR])
 	{
 		return false;
 	}
@@ -1880,7 +2094,7 @@ bool Board::HasInsufficientMaterial(bool relaxed) const
 		return true;
 	};
 
-	return !canWinFunc(m_boardDescBB[WN], m_boardDescBB[WB]) && !canWinFunc(m_boardDescBB[BN], m_boardDescBB[BB]);
+	return !canWinFunc(m_state.boardDescBB[WN], m_state.boardDescBB[WB]) && !canWinFunc(m_state.boardDescBB[BN], m_state.boardDescBB[BB]);
 }
 
 Board::GameStatus Board::GetGameStatus()
@@ -1892,7 +2106,7 @@ Board::GameStatus Board::GetGameStatus()
 	{
 		if (InCheck())
 		{
-			if (m_boardDescU8[SIDE_TO_MOVE] == WHITE)
+			if (m_state.boardDescU8[SIDE_TO_MOVE] == WHITE)
 			{
 				return BLACK_WINS;
 			}
@@ -1918,29 +2132,26 @@ Board::GameStatus Board::GetGameStatus()
 
 PieceType Board::ApplyMoveSee(PieceType pt, Square from, Square to)
 {
-	PieceType capturedPiece = m_boardDescU8[to];
+	PieceType capturedPiece = m_state.boardDescU8[to];
 
-	UndoListBB &ulBB = m_undoStackBB.PrePush();
-	UndoListU8 &ulU8 = m_undoStackU8.PrePush();
-
-	// no need to clear them because we know exactly how many elements will be on the list
+	// we only need the move and the captured piece to undo
+	UndoRecord &ur = m_undoStack.PrePush();
+	ur.move = 0;
+	SetFromSquare(ur.move, from);
+	SetToSquare(ur.move, to);
+	SetPieceType(ur.move, pt);
+	ur.captured = capturedPiece;
 
 	// we need to update the to-square MB because next ApplyMoveSee call will use it to determine captured piece
-	ulU8[0].first = to;
-	ulU8[0].second = m_boardDescU8[to];
-	m_boardDescU8[to] = pt;
+	m_state.boardDescU8[to] = pt;
 
 	// we need to update the PT BB because otherwise GenerateSmallestCapture will see it again
-	ulBB[0].first = pt;
-	ulBB[0].second = m_boardDescBB[pt];
-	m_boardDescBB[pt] &= InvBit(from);
+	m_state.boardDescBB[pt] &= InvBit(from);
 
 	// we need to update occupancy for discovered attacks
-	// borrow a space on the undo list for our own occupancy BB
-	ulBB[1].second = m_boardDescBB[pt];
 	m_seeTotalOccupancy &= InvBit(from);
 
-	m_boardDescU8[SIDE_TO_MOVE] ^= COLOR_MASK;
+	m_state.boardDescU8[SIDE_TO_MOVE] ^= COLOR_MASK;
 
 	return capturedPiece;
 }
@@ -1949,27 +2160,29 @@ bool Board::IsSeeEligible(Move mv)
 {
 	Square to = GetToSquare(mv);
 
-	return m_boardDescU8[to] != EMPTY;
+	return m_state.boardDescU8[to] != EMPTY;
 }
 
 void Board::UndoMoveSee()
 {
-	UndoListBB &ulBB = m_undoStackBB.Top();
-	UndoListU8 &ulU8 = m_undoStackU8.Top();
+	UndoRecord &ur = m_undoStack.Top();
+
+	PieceType pt = GetPieceType(ur.move);
+	Square from = GetFromSquare(ur.move);
+	Square to = GetToSquare(ur.move);
 
-	m_boardDescU8[ulU8[0].first] = ulU8[0].second;
-	m_boardDescBB[ulBB[0].first] = ulBB[0].second;
-	m_seeTotalOccupancy = ulBB[1].second;
+	m_state.boardDescU8[to] = ur.captured;
+	m_state.boardDescBB[pt] |= Bit(from);
+	m_seeTotalOccupancy |= Bit(from);
 
-	m_boardDescU8[SIDE_TO_MOVE] ^= COLOR_MASK;
+	m_state.boardDescU8[SIDE_TO_MOVE] ^= COLOR_MASK;
 
-	m_undoStackBB.Pop();
-	m_undoStackU8.Pop();
+	m_undoStack.Pop();
 }
 
 bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 {
-	Color stm = m_boardDescU8[SIDE_TO_MOVE];
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
 	PieceType lastPT = stm == WHITE ? m_seeLastWhitePT : m_seeLastBlackPT;
 
 	uint64_t attackers = 0ULL;
@@ -1977,7 +2190,7 @@ bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 	switch (lastPT)
 	{
 	case WP:
-		attackers = PAWN_ATK[to][stm == WHITE ? 1 : 0] & m_boardDescBB[WP | stm];
+		attackers = PAWN_ATK[to][stm == WHITE ? 1 : 0] & m_state.boardDescBB[WP | stm];
 
 		if (attackers)
 		{
@@ -1991,7 +2204,7 @@ bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 		}
 		// fallthrough
 	case WN:
-		attackers = KNIGHT_ATK[to] & m_boardDescBB[WN | stm];
+		attackers = KNIGHT_ATK[to] & m_state.boardDescBB[WN | stm];
 
 		if (attackers)
 		{
@@ -2005,7 +2218,7 @@ bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 		}
 		// fall through
 	case WB:
-		attackers = Bmagic(to, m_seeTotalOccupancy) & m_boardDescBB[WB | stm];
+		attackers = SliderAttacks::Bishop(to, m_seeTotalOccupancy) & m_state.boardDescBB[WB | stm];
 
 		if (attackers)
 		{
@@ -2019,7 +2232,7 @@ bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 		}
 		// fall through
 	case WR:
-		attackers = Rmagic(to, m_seeTotalOccupancy) & m_boardDescBB[WR | stm];
+		attackers = SliderAttacks::Rook(to, m_seeTotalOccupancy) & m_state.boardDescBB[WR | stm];
 
 		if (attackers)
 		{
@@ -2033,7 +2246,7 @@ bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 		}
 		// fall through
 	case WQ:
-		attackers = Qmagic(to, m_seeTotalOccupancy) & m_boardDescBB[WQ | stm];
+		attackers = SliderAttacks::Queen(to, m_seeTotalOccupancy) & m_state.boardDescBB[WQ | stm];
 
 		if (attackers)
 		{
@@ -2047,7 +2260,7 @@ bool Board::GenerateSmallestCaptureSee(PieceType &pt, Square &from, Square to)
 		}
 		// fall through
 	case WK:
-		attackers = KING_ATK[to] & m_boardDescBB[WK | stm];
+		attackers = KING_ATK[to] & m_state.boardDescBB[WK | stm];
 
 		if (attackers)
 		{
@@ -2085,24 +2298,73 @@ PieceType Board::GetCapturedPieceType(Move violentMove)
 	}
 }
 
-uint64_t Board::SpeculateHashAfterMove(Move mv)
+uint64_t Board::SpeculateHashAfterMove(Move mv) const
 {
-	uint64_t hash = m_boardDescBB[HASH];
+	uint64_t hash = m_state.boardDescBB[HASH];
 
 	PieceType pt = GetPieceType(mv);
 	Square from = GetFromSquare(mv);
 	Square to = GetToSquare(mv);
+	PieceType promoType = GetPromoType(mv);
+
+	hash ^= SIDE_TO_MOVE_ZOBRIST;
+
+	// en passant is only possible for one move
+	if (m_state.boardDescBB[EN_PASS_SQUARE])
+	{
+		hash ^= EN_PASS_ZOBRIST[BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE])];
+	}
 
 	hash ^= PIECES_ZOBRIST[from][pt];
-	hash ^= PIECES_ZOBRIST[to][pt];
+	hash ^= PIECES_ZOBRIST[to][promoType ? promoType : pt];
 
-	hash ^= SIDE_TO_MOVE_ZOBRIST;
+	if (IsCastling(mv))
+	{
+		Square rookFrom;
+		Square rookTo;
+		GetCastlingRookSquares(mv, rookFrom, rookTo);
+
+		hash ^= PIECES_ZOBRIST[rookFrom][WR | (pt & COLOR_MASK)];
+		hash ^= PIECES_ZOBRIST[rookTo][WR | (pt & COLOR_MASK)];
+	}
+	else if (m_state.boardDescU8[to] != EMPTY)
+	{
+		hash ^= PIECES_ZOBRIST[to][m_state.boardDescU8[to]];
+	}
+	else if (pt == WP || pt == BP)
+	{
+		if (Bit(to) == m_state.boardDescBB[EN_PASS_SQUARE])
+		{
+			hash ^= PIECES_ZOBRIST[(pt == WP) ? (to - 8) : (to + 8)][pt ^ COLOR_MASK];
+		}
+		else if (to == from + 16 || to + 16 == from)
+		{
+			hash ^= EN_PASS_ZOBRIST[(from + to) / 2];
+		}
+	}
+
+	// castling rights are lost when the king moves, or anything moves from or to a rook square (if we still
+	// have the right, the rook must still be there)
+	uint64_t touched = Bit(from) | Bit(to);
+
+	if (m_state.boardDescU8[W_SHORT_CASTLE] && (pt == WK || (touched & Bit(H1))))
+	{
+		hash ^= W_SHORT_CASTLE_ZOBRIST;
+	}
+
+	if (m_state.boardDescU8[W_LONG_CASTLE] && (pt == WK || (touched & Bit(A1))))
+	{
+		hash ^= W_LONG_CASTLE_ZOBRIST;
+	}
 
-	PieceType originalPiece = GetPieceAtSquare(to);
+	if (m_state.boardDescU8[B_SHORT_CASTLE] && (pt == BK || (touched & Bit(H8))))
+	{
+		hash ^= B_SHORT_CASTLE_ZOBRIST;
+	}
 
-	if (originalPiece != EMPTY)
+	if (m_state.boardDescU8[B_LONG_CASTLE] && (pt == BK || (touched & Bit(A8))))
 	{
-		hash ^= PIECES_ZOBRIST[to][originalPiece];
+		hash ^= B_LONG_CASTLE_ZOBRIST;
 	}
 
 	return hash;
@@ -2123,15 +2385,15 @@ uint64_t Board::GetAttackers(Square sq) const
 	}
 	else if (PT == WB || PT == BB)
 	{
-		atkMask = Bmagic(sq, m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED] | (1ULL << sq));
+		atkMask = SliderAttacks::Bishop(sq, m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED] | (1ULL << sq));
 	}
 	else if (PT == WR || PT == BR)
 	{
-		atkMask = Rmagic(sq, m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED] | (1ULL << sq));
+		atkMask = SliderAttacks::Rook(sq, m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED] | (1ULL << sq));
 	}
 	else if (PT == WQ || PT == BQ)
 	{
-		atkMask = Qmagic(sq, m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED] | (1ULL << sq));
+		atkMask = SliderAttacks::Queen(sq, m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED] | (1ULL << sq));
 	}
 	else if (PT == WP)
 	{
@@ -2146,7 +2408,7 @@ uint64_t Board::GetAttackers(Square sq) const
 		assert(false);
 	}
 
-	return atkMask & m_boardDescBB[PT];
+	return atkMask & m_state.boardDescBB[PT];
 }
 
 // instantiate templates
@@ -2185,12 +2447,12 @@ void Board::ApplyVariation(const std::vector<Move> &moves)
 
 void Board::ComputeLeastValuableAttackers(PieceType attackers[64], uint8_t numAttackers[64], Color side)
 {
-	uint64_t kings = m_boardDescBB[WK | side];
-	uint64_t queens = m_boardDescBB[WQ | side];
-	uint64_t rooks = m_boardDescBB[WR | side];
-	uint64_t bishops = m_boardDescBB[WB | side];
-	uint64_t knights = m_boardDescBB[WN | side];
-	uint64_t pawns = m_boardDescBB[WP | side];
+	uint64_t kings = m_state.boardDescBB[WK | side];
+	uint64_t queens = m_state.boardDescBB[WQ | side];
+	uint64_t rooks = m_state.boardDescBB[WR | side];
+	uint64_t bishops = m_state.boardDescBB[WB | side];
+	uint64_t knights = m_state.boardDescBB[WN | side];
+	uint64_t pawns = m_state.boardDescBB[WP | side];
 
 	// initialize everything to empty
 	for (Square sq = 0; sq < 64; ++sq)
@@ -2209,7 +2471,7 @@ void Board::ComputeLeastValuableAttackers(PieceType attackers[64], uint8_t numAt
 		}
 	};
 
-	uint64_t occupied = m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED];
+	uint64_t occupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
 
 	// now we start from the most valuable and go to least, and just keep overwriting
 	while (kings)
@@ -2223,21 +2485,21 @@ void Board::ComputeLeastValuableAttackers(PieceType attackers[64], uint8_t numAt
 	{
 		Square sq = Extract(queens);
 
-		updateTableFcn(WQ, Qmagic(sq, occupied));
+		updateTableFcn(WQ, SliderAttacks::Queen(sq, occupied));
 	}
 
 	while (rooks)
 	{
 		Square sq = Extract(rooks);
 
-		updateTableFcn(WR, Rmagic(sq, occupied));
+		updateTableFcn(WR, SliderAttacks::Rook(sq, occupied));
 	}
 
 	while (bishops)
 	{
 		Square sq = Extract(bishops);
 
-		updateTableFcn(WB, Bmagic(sq, occupied));
+		updateTableFcn(WB, SliderAttacks::Bishop(sq, occupied));
 	}
 
 	while (knights)
@@ -2273,12 +2535,12 @@ Board Board::GetMirroredPosition() const
 
 	for (uint32_t i = 0; i < BOARD_DESC_BB_SIZE; ++i)
 	{
-		newBoard.m_boardDescBB[i] = 0;
+		newBoard.m_state.boardDescBB[i] = 0;
 	}
 
 	for (uint32_t i = 0; i < BOARD_DESC_U8_SIZE; ++i)
 	{
-		newBoard.m_boardDescU8[i] = 0;
+		newBoard.m_state.boardDescU8[i] = 0;
 	}
 
 	for (Square sq = 0; sq < 64; ++sq)
@@ -2286,28 +2548,28 @@ Board Board::GetMirroredPosition() const
 		Square newSq = Sq(GetX(sq), 7 - GetY(sq));
 		newBoard.RemovePiece(newSq);
 
-		if (m_boardDescU8[sq] != EMPTY)
+		if (m_state.boardDescU8[sq] != EMPTY)
 		{
 			// mirror and change colour of all pieces
-			newBoard.PlacePiece(newSq, m_boardDescU8[sq] ^ COLOR_MASK);
+			newBoard.PlacePiece(newSq, m_state.boardDescU8[sq] ^ COLOR_MASK);
 		}
 	}
 
-	newBoard.m_boardDescU8[SIDE_TO_MOVE] = GetSideToMove() ^ COLOR_MASK;
+	newBoard.m_state.boardDescU8[SIDE_TO_MOVE] = GetSideToMove() ^ COLOR_MASK;
 
-	if (m_boardDescBB[EN_PASS_SQUARE])
+	if (m_state.boardDescBB[EN_PASS_SQUARE])
 	{
-		Square oldSq = BitScanForward(m_boardDescBB[EN_PASS_SQUARE]);
+		Square oldSq = BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE]);
 		Square newSq = Sq(GetX(oldSq), 7 - GetY(oldSq));
-		newBoard.m_boardDescBB[EN_PASS_SQUARE] = Bit(newSq);
+		newBoard.m_state.boardDescBB[EN_PASS_SQUARE] = Bit(newSq);
 	}
 
-	newBoard.m_boardDescU8[W_SHORT_CASTLE] = m_boardDescU8[B_SHORT_CASTLE];
-	newBoard.m_boardDescU8[W_LONG_CASTLE] = m_boardDescU8[B_LONG_CASTLE];
-	newBoard.m_boardDescU8[B_SHORT_CASTLE] = m_boardDescU8[W_SHORT_CASTLE];
-	newBoard.m_boardDescU8[B_LONG_CASTLE] = m_boardDescU8[W_LONG_CASTLE];
+	newBoard.m_state.boardDescU8[W_SHORT_CASTLE] = m_state.boardDescU8[B_SHORT_CASTLE];
+	newBoard.m_state.boardDescU8[W_LONG_CASTLE] = m_state.boardDescU8[B_LONG_CASTLE];
+	newBoard.m_state.boardDescU8[B_SHORT_CASTLE] = m_state.boardDescU8[W_SHORT_CASTLE];
+	newBoard.m_state.boardDescU8[B_LONG_CASTLE] = m_state.boardDescU8[W_LONG_CASTLE];
 
-	newBoard.m_boardDescU8[HALF_MOVES_CLOCK] = m_boardDescU8[HALF_MOVES_CLOCK];
+	newBoard.m_state.boardDescU8[HALF_MOVES_CLOCK] = m_state.boardDescU8[HALF_MOVES_CLOCK];
 
 	newBoard.UpdateInCheck_();
 	newBoard.UpdateHashFull_();
@@ -2320,55 +2582,60 @@ Board Board::GetMirroredPosition() const
 }
 
 template <Board::MOVE_TYPES MT>
-void Board::GenerateAllPseudoLegalMoves_(MoveList &moveList) const
+void Board::GenerateEvasions_(const CheckInfo &ci, MoveList &moveList) const
 {
-	Color sideToMove = m_boardDescU8[SIDE_TO_MOVE];
-	GeneratePawnMoves_<MT>(sideToMove, moveList);
-	GenerateKnightMoves_<MT>(sideToMove, moveList);
-	GenerateBishopMoves_<MT>(sideToMove, moveList);
-	GenerateRookMoves_<MT>(sideToMove, moveList);
-	GenerateQueenMoves_<MT>(sideToMove, moveList);
-	GenerateKingMoves_<MT>(sideToMove, moveList);
+	Color sideToMove = m_state.boardDescU8[SIDE_TO_MOVE];
 
-#ifdef DEBUG
-	if (MT == ALL)
+	// in double check, only the king can move
+	if (!(ci.checkers & (ci.checkers - 1)))
 	{
-		MoveList mlQuiet;
-		MoveList mlViolent;
-		GenerateAllPseudoLegalMoves_<QUIET>(mlQuiet);
-		GenerateAllPseudoLegalMoves_<VIOLENT>(mlViolent);
-		assert((mlQuiet.GetSize() + mlViolent.GetSize()) == moveList.GetSize());
+		// only captures of the checker and blocks are generated (ci.targets)
+		GeneratePawnMoves_<MT>(sideToMove, ci, moveList);
+		GenerateKnightMoves_<MT>(sideToMove, ci, moveList);
+		GenerateBishopMoves_<MT>(sideToMove, ci, moveList);
+		GenerateRookMoves_<MT>(sideToMove, ci, moveList);
+		GenerateQueenMoves_<MT>(sideToMove, ci, moveList);
 	}
-#endif
+
+	GenerateKingMoves_<MT>(sideToMove, ci, moveList);
 }
 
 template <Board::MOVE_TYPES MT>
-void Board::GenerateKingMoves_(Color color, MoveList &moveList) const
+uint64_t Board::GetDstMask_(Color color) const
 {
-	// there can only be one king
-#ifdef DEBUG
-	assert(PopCount(m_boardDescBB[WK | color]) == 1);
-#endif
-	PieceType pt = WK | color;
-
 	uint64_t dstMask = 0;
 	if (MT == ALL)
 	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
+		dstMask |= m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
+		dstMask |= ~(m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]);
 	}
 	else if (MT == VIOLENT)
 	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
+		dstMask |= m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
 	}
 	else
 	{
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
+		dstMask |= ~(m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]);
 	}
 
-	uint64_t kings = m_boardDescBB[pt];
-	uint32_t idx = BitScanForward(kings);
-	uint64_t dsts = KING_ATK[idx] & dstMask;
+	return dstMask;
+}
+
+template <Board::MOVE_TYPES MT>
+void Board::GenerateKingMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const
+{
+	// there can only be one king
+#ifdef DEBUG
+	assert(PopCount(m_state.boardDescBB[WK | color]) == 1);
+#endif
+	PieceType pt = WK | color;
+
+	uint32_t idx = ci.kingPos;
+	uint64_t dsts = KING_ATK[idx] & GetDstMask_<MT>(color);
+
+	// the king is removed from the occupancy, so we don't consider squares behind the king (on the line of a checking
+	// slider) safe
+	uint64_t occupancy = (m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]) ^ Bit(idx);
 
 	Move mvTemplate = 0;
 	SetFromSquare(mvTemplate, idx);
@@ -2378,6 +2645,11 @@ void Board::GenerateKingMoves_(Color color, MoveList &moveList) const
 	{
 		uint32_t dst = Extract(dsts);
 
+		if (GetAttackersOf_(dst, occupancy))
+		{
+			continue;
+		}
+
 		Move mv = mvTemplate;
 
 		SetToSquare(mv, dst);
@@ -2386,64 +2658,64 @@ void Board::GenerateKingMoves_(Color color, MoveList &moveList) const
 	}
 
 	// castling
-	if (MT != VIOLENT && !m_boardDescU8[IN_CHECK])
+	if (MT != VIOLENT && !ci.checkers)
 	{
-		if (pt == WK && m_boardDescU8[E1] == WK)
+		if (pt == WK && m_state.boardDescU8[E1] == WK)
 		{
-			if (m_boardDescU8[W_SHORT_CASTLE] &&
-				m_boardDescU8[H1] == WR &&
-				m_boardDescU8[F1] == EMPTY &&
-				m_boardDescU8[G1] == EMPTY &&
-				!IsUnderAttack_(F1))
+			if (m_state.boardDescU8[W_SHORT_CASTLE] &&
+				m_state.boardDescU8[H1] == WR &&
+				m_state.boardDescU8[F1] == EMPTY &&
+				m_state.boardDescU8[G1] == EMPTY &&
+				!IsUnderAttack_(F1) &&
+				!IsUnderAttack_(G1))
 			{
 				// we don't have to check current king pos for under attack because we checked that already
-				// we don't have to check destination because we are generating pseudo-legal moves
 				Move mv = mvTemplate;
 				SetCastlingType(mv, MoveConstants::CASTLE_WHITE_SHORT);
 				SetToSquare(mv, G1);
 				moveList.PushBack(mv);
 			}
 
-			if (m_boardDescU8[W_LONG_CASTLE] &&
-				m_boardDescU8[A1] == WR &&
-				m_boardDescU8[B1] == EMPTY &&
-				m_boardDescU8[C1] == EMPTY &&
-				m_boardDescU8[D1] == EMPTY &&
-				!IsUnderAttack_(D1))
+			if (m_state.boardDescU8[W_LONG_CASTLE] &&
+				m_state.boardDescU8[A1] == WR &&
+				m_state.boardDescU8[B1] == EMPTY &&
+				m_state.boardDescU8[C1] == EMPTY &&
+				m_state.boardDescU8[D1] == EMPTY &&
+				!IsUnderAttack_(D1) &&
+				!IsUnderAttack_(C1))
 			{
 				// we don't have to check current king pos for under attack because we checked that already
-				// we don't have to check destination because we are generating pseudo-legal moves
 				Move mv = mvTemplate;
 				SetCastlingType(mv, MoveConstants::CASTLE_WHITE_LONG);
 				SetToSquare(mv, C1);
 				moveList.PushBack(mv);
 			}
 		}
-		else if (pt == BK && m_boardDescU8[E8] == BK)
+		else if (pt == BK && m_state.boardDescU8[E8] == BK)
 		{
-			if (m_boardDescU8[B_SHORT_CASTLE] &&
-				m_boardDescU8[H8] == BR &&
-				m_boardDescU8[F8] == EMPTY &&
-				m_boardDescU8[G8] == EMPTY &&
-				!IsUnderAttack_(F8))
+			if (m_state.boardDescU8[B_SHORT_CASTLE] &&
+				m_state.boardDescU8[H8] == BR &&
+				m_state.boardDescU8[F8] == EMPTY &&
+				m_state.boardDescU8[G8] == EMPTY &&
+				!IsUnderAttack_(F8) &&
+				!IsUnderAttack_(G8))
 			{
 				// we don't have to check current king pos for under attack because we checked that already
-				// we don't have to check destination because we are generating pseudo-legal moves
 				Move mv = mvTemplate;
 				SetCastlingType(mv, MoveConstants::CASTLE_BLACK_SHORT);
 				SetToSquare(mv, G8);
 				moveList.PushBack(mv);
 			}
 
-			if (m_boardDescU8[B_LONG_CASTLE] &&
-				m_boardDescU8[A8] == BR &&
-				m_boardDescU8[B8] == EMPTY &&
-				m_boardDescU8[C8] == EMPTY &&
-				m_boardDescU8[D8] == EMPTY &&
-				!IsUnderAttack_(D8))
+			if (m_state.boardDescU8[B_LONG_CASTLE] &&
+				m_state.boardDescU8[A8] == BR &&
+				m_state.boardDescU8[B8] == EMPTY &&
+				m_state.boardDescU8[C8] == EMPTY &&
+				m_state.boardDescU8[D8] == EMPTY &&
+				!IsUnderAttack_(D8) &&
+				!IsUnderAttack_(C8))
 			{
 				// we don't have to check current king pos for under attack because we checked that already
-				// we don't have to check destination because we are generating pseudo-legal moves
 				Move mv = mvTemplate;
 				SetCastlingType(mv, MoveConstants::CASTLE_BLACK_LONG);
 				SetToSquare(mv, C8);
@@ -2453,37 +2725,30 @@ void Board::GenerateKingMoves_(Color color, MoveList &moveList) const
 	}
 }
 
-template void Board::GenerateKingMoves_<Board::QUIET>(Color color, MoveList &moveList) const;
-template void Board::GenerateKingMoves_<Board::VIOLENT>(Color color, MoveList &moveList) const;
-template void Board::GenerateKingMoves_<Board::ALL>(Color color, MoveList &moveList) const;
+template void Board::GenerateKingMoves_<Board::QUIET>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateKingMoves_<Board::VIOLENT>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateKingMoves_<Board::ALL>(Color color, const CheckInfo &ci, MoveList &moveList) const;
 
 template <Board::MOVE_TYPES MT>
-void Board::GenerateQueenMoves_(Color color, MoveList &moveList) const
+void Board::GenerateQueenMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const
 {
 	PieceType pt = WQ | color;
 
-	uint64_t dstMask = 0;
-	if (MT == ALL)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
-	else if (MT == VIOLENT)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-	}
-	else
-	{
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
+	uint64_t dstMask = GetDstMask_<MT>(color) & ci.targets;
 
-	uint64_t queens = m_boardDescBB[pt];
+	uint64_t queens = m_state.boardDescBB[pt];
 
 	while (queens)
 	{
 		uint32_t idx = Extract(queens);
 
-		uint64_t dsts = Qmagic(idx, m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]) & dstMask;
+		uint64_t dsts = SliderAttacks::Queen(idx, m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]) & dstMask;
+
+		// pinned pieces can only move along the pin
+		if (Bit(idx) & ci.pinned)
+		{
+			dsts &= LINE[ci.kingPos][idx];
+		}
 
 		Move mvTemplate = 0;
 		SetFromSquare(mvTemplate, idx);
@@ -2502,37 +2767,30 @@ void Board::GenerateQueenMoves_(Color color, MoveList &moveList) const
 	}
 }
 
-template void Board::GenerateQueenMoves_<Board::QUIET>(Color color, MoveList &moveList) const;
-template void Board::GenerateQueenMoves_<Board::VIOLENT>(Color color, MoveList &moveList) const;
-template void Board::GenerateQueenMoves_<Board::ALL>(Color color, MoveList &moveList) const;
+template void Board::GenerateQueenMoves_<Board::QUIET>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateQueenMoves_<Board::VIOLENT>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateQueenMoves_<Board::ALL>(Color color, const CheckInfo &ci, MoveList &moveList) const;
 
 template <Board::MOVE_TYPES MT>
-void Board::GenerateBishopMoves_(Color color, MoveList &moveList) const
+void Board::GenerateBishopMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const
 {
 	PieceType pt = WB | color;
 
-	uint64_t dstMask = 0;
-	if (MT == ALL)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
-	else if (MT == VIOLENT)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-	}
-	else
-	{
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
+	uint64_t dstMask = GetDstMask_<MT>(color) & ci.targets;
 
-	uint64_t bishops = m_boardDescBB[pt];
+	uint64_t bishops = m_state.boardDescBB[pt];
 
 	while (bishops)
 	{
 		uint32_t idx = Extract(bishops);
 
-		uint64_t dsts = Bmagic(idx, m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]) & dstMask;
+		uint64_t dsts = SliderAttacks::Bishop(idx, m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]) & dstMask;
+
+		// pinned pieces can only move along the pin
+		if (Bit(idx) & ci.pinned)
+		{
+			dsts &= LINE[ci.kingPos][idx];
+		}
 
 		Move mvTemplate = 0;
 		SetFromSquare(mvTemplate, idx);
@@ -2551,31 +2809,19 @@ void Board::GenerateBishopMoves_(Color color, MoveList &moveList) const
 	}
 }
 
-template void Board::GenerateBishopMoves_<Board::QUIET>(Color color, MoveList &moveList) const;
-template void Board::GenerateBishopMoves_<Board::VIOLENT>(Color color, MoveList &moveList) const;
-template void Board::GenerateBishopMoves_<Board::ALL>(Color color, MoveList &moveList) const;
+template void Board::GenerateBishopMoves_<Board::QUIET>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateBishopMoves_<Board::VIOLENT>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateBishopMoves_<Board::ALL>(Color color, const CheckInfo &ci, MoveList &moveList) const;
 
 template <Board::MOVE_TYPES MT>
-void Board::GenerateKnightMoves_(Color color, MoveList &moveList) const
+void Board::GenerateKnightMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const
 {
 	PieceType pt = WN | color;
 
-	uint64_t dstMask = 0;
-	if (MT == ALL)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
-	else if (MT == VIOLENT)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-	}
-	else
-	{
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
+	uint64_t dstMask = GetDstMask_<MT>(color) & ci.targets;
 
-	uint64_t knights = m_boardDescBB[pt];
+	// pinned knights can never move
+	uint64_t knights = m_state.boardDescBB[pt] & ~ci.pinned;
 
 	while (knights)
 	{
@@ -2600,37 +2846,30 @@ void Board::GenerateKnightMoves_(Color color, MoveList &moveList) const
 	}
 }
 
-template void Board::GenerateKnightMoves_<Board::QUIET>(Color color, MoveList &moveList) const;
-template void Board::GenerateKnightMoves_<Board::VIOLENT>(Color color, MoveList &moveList) const;
-template void Board::GenerateKnightMoves_<Board::ALL>(Color color, MoveList &moveList) const;
+template void Board::GenerateKnightMoves_<Board::QUIET>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateKnightMoves_<Board::VIOLENT>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateKnightMoves_<Board::ALL>(Color color, const CheckInfo &ci, MoveList &moveList) const;
 
 template <Board::MOVE_TYPES MT>
-void Board::GenerateRookMoves_(Color color, MoveList &moveList) const
+void Board::GenerateRookMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const
 {
 	PieceType pt = WR | color;
 
-	uint64_t dstMask = 0;
-	if (MT == ALL)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
-	else if (MT == VIOLENT)
-	{
-		dstMask |= m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
-	}
-	else
-	{
-		dstMask |= ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	}
+	uint64_t dstMask = GetDstMask_<MT>(color) & ci.targets;
 
-	uint64_t rooks = m_boardDescBB[pt];
+	uint64_t rooks = m_state.boardDescBB[pt];
 
 	while (rooks)
 	{
 		uint32_t idx = Extract(rooks);
 
-		uint64_t dsts = Rmagic(idx, m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]) & dstMask;
+		uint64_t dsts = SliderAttacks::Rook(idx, m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]) & dstMask;
+
+		// pinned pieces can only move along the pin
+		if (Bit(idx) & ci.pinned)
+		{
+			dsts &= LINE[ci.kingPos][idx];
+		}
 
 		Move mvTemplate = 0;
 		SetFromSquare(mvTemplate, idx);
@@ -2649,17 +2888,18 @@ void Board::GenerateRookMoves_(Color color, MoveList &moveList) const
 	}
 }
 
-template void Board::GenerateRookMoves_<Board::QUIET>(Color color, MoveList &moveList) const;
-template void Board::GenerateRookMoves_<Board::VIOLENT>(Color color, MoveList &moveList) const;
-template void Board::GenerateRookMoves_<Board::ALL>(Color color, MoveList &moveList) const;
+template void Board::GenerateRookMoves_<Board::QUIET>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateRookMoves_<Board::VIOLENT>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GenerateRookMoves_<Board::ALL>(Color color, const CheckInfo &ci, MoveList &moveList) const;
 
 template <Board::MOVE_TYPES MT>
-void Board::GeneratePawnMoves_(Color color, MoveList &moveList) const
+void Board::GeneratePawnMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const
 {
 	PieceType pt = WP | color;
-	uint64_t pawns = m_boardDescBB[pt];
-	uint64_t empty = ~(m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]);
-	uint64_t enemy = m_boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
+	uint64_t pawns = m_state.boardDescBB[pt];
+	uint64_t empty = ~(m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]);
+	uint64_t enemy = m_state.boardDescBB[WHITE_OCCUPIED | (color ^ COLOR_MASK)];
+	uint64_t epSquare = m_state.boardDescBB[EN_PASS_SQUARE];
 
 	while (pawns)
 	{
@@ -2681,7 +2921,7 @@ void Board::GeneratePawnMoves_(Color color, MoveList &moveList) const
 			dsts &= RANKS[RANK_1] | RANKS[RANK_8];
 		}
 
-		uint64_t captures = PAWN_ATK[idx][color == WHITE ? 0 : 1] & (enemy | m_boardDescBB[EN_PASS_SQUARE]);
+		uint64_t captures = PAWN_ATK[idx][color == WHITE ? 0 : 1] & enemy;
 
 		// only add captures if they are promotions in quiet mode
 		if (MT == QUIET)
@@ -2693,6 +2933,21 @@ void Board::GeneratePawnMoves_(Color color, MoveList &moveList) const
 			dsts |= captures;
 		}
 
+		dsts &= ci.targets;
+
+		// pinned pieces can only move along the pin
+		if (Bit(idx) & ci.pinned)
+		{
+			dsts &= LINE[ci.kingPos][idx];
+		}
+
+		// en passant is never a promotion, so it's only generated in violent mode
+		// it doesn't go through the masks above, since it captures a piece that's not on the destination square
+		if (MT != QUIET && (PAWN_ATK[idx][color == WHITE ? 0 : 1] & epSquare) && IsEpLegal_(idx, BitScanForward(epSquare)))
+		{
+			dsts |= epSquare;
+		}
+
 		while (dsts)
 		{
 			uint32_t dst = Extract(dsts);
@@ -2738,37 +2993,62 @@ void Board::GeneratePawnMoves_(Color color, MoveList &moveList) const
 	}
 }
 
-template void Board::GeneratePawnMoves_<Board::QUIET>(Color color, MoveList &moveList) const;
-template void Board::GeneratePawnMoves_<Board::VIOLENT>(Color color, MoveList &moveList) const;
-template void Board::GeneratePawnMoves_<Board::ALL>(Color color, MoveList &moveList) const;
+template void Board::GeneratePawnMoves_<Board::QUIET>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GeneratePawnMoves_<Board::VIOLENT>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+template void Board::GeneratePawnMoves_<Board::ALL>(Color color, const CheckInfo &ci, MoveList &moveList) const;
+
+bool Board::IsEpLegal_(Square from, Square to) const
+{
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
+	Square kingPos = BitScanForward(m_state.boardDescBB[WK | stm]);
+	Square capturedSq = (stm == WHITE) ? (to - 8) : (to + 8);
+
+	uint64_t occupancy = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
+	occupancy = (occupancy ^ Bit(from) ^ Bit(capturedSq)) | Bit(to);
+
+	// the captured pawn doesn't attack anything anymore
+	return (GetAttackersOf_(kingPos, occupancy) & ~Bit(capturedSq)) == 0;
+}
+
+uint64_t Board::GetAttackersOf_(Square sq, uint64_t occupancy) const
+{
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
+	Color enemyColor = stm ^ COLOR_MASK;
+
+	return (KING_ATK[sq] & m_state.boardDescBB[WK | enemyColor]) |
+		(KNIGHT_ATK[sq] & m_state.boardDescBB[WN | enemyColor]) |
+		(SliderAttacks::Rook(sq, occupancy) & (m_state.boardDescBB[WQ | enemyColor] | m_state.boardDescBB[WR | enemyColor])) |
+		(SliderAttacks::Bishop(sq, occupancy) & (m_state.boardDescBB[WQ | enemyColor] | m_state.boardDescBB[WB | enemyColor])) |
+		(PAWN_ATK[sq][stm == WHITE ? 0 : 1] & m_state.boardDescBB[WP | enemyColor]);
+}
 
 bool Board::IsUnderAttack_(Square sq) const
 {
-	Color stm = m_boardDescU8[SIDE_TO_MOVE];
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
 	Color enemyColor = stm ^ COLOR_MASK;
-	uint64_t allOccupied = m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED];
+	uint64_t allOccupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
 
-	if (KING_ATK[sq] & m_boardDescBB[WK | enemyColor])
+	if (KING_ATK[sq] & m_state.boardDescBB[WK | enemyColor])
 	{
 		return true;
 	}
 
-	if (KNIGHT_ATK[sq] & m_boardDescBB[WN | enemyColor])
+	if (KNIGHT_ATK[sq] & m_state.boardDescBB[WN | enemyColor])
 	{
 		return true;
 	}
 
-	if (Rmagic(sq, allOccupied) & (m_boardDescBB[WQ | enemyColor] | m_boardDescBB[WR | enemyColor]))
+	if (SliderAttacks::Rook(sq, allOccupied) & (m_state.boardDescBB[WQ | enemyColor] | m_state.boardDescBB[WR | enemyColor]))
 	{
 		return true;
 	}
 
-	if (Bmagic(sq, allOccupied) & (m_boardDescBB[WQ | enemyColor] | m_boardDescBB[WB | enemyColor]))
+	if (SliderAttacks::Bishop(sq, allOccupied) & (m_state.boardDescBB[WQ | enemyColor] | m_state.boardDescBB[WB | enemyColor]))
 	{
 		return true;
 	}
 
-	if (PAWN_ATK[sq][stm == WHITE ? 0 : 1] & m_boardDescBB[WP | enemyColor])
+	if (PAWN_ATK[sq][stm == WHITE ? 0 : 1] & m_state.boardDescBB[WP | enemyColor])
 	{
 		return true;
 	}
@@ -2778,10 +3058,10 @@ bool Board::IsUnderAttack_(Square sq) const
 
 void Board::UpdateInCheck_()
 {
-	Color stm = m_boardDescU8[SIDE_TO_MOVE];
-	Square kingPos = BitScanForward(m_boardDescBB[WK | stm]);
+	Color stm = m_state.boardDescU8[SIDE_TO_MOVE];
+	Square kingPos = BitScanForward(m_state.boardDescBB[WK | stm]);
 
-	m_boardDescU8[IN_CHECK] = IsUnderAttack_(kingPos);
+	m_state.boardDescU8[IN_CHECK] = IsUnderAttack_(kingPos);
 }
 
 void Board::UpdateHashFull_()
@@ -2789,45 +3069,45 @@ void Board::UpdateHashFull_()
 	uint64_t newHash = 0;
 
 	// first add all pieces
-	for (int32_t i = 0; i < 64; ++i)
+	uint64_t occupied = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED];
+
+	while (occupied)
 	{
-		if (m_boardDescU8[i] != EMPTY)
-		{
-			newHash ^= PIECES_ZOBRIST[i][m_boardDescU8[i]];
-		}
+		Square sq = Extract(occupied);
+		newHash ^= PIECES_ZOBRIST[sq][m_state.boardDescU8[sq]];
 	}
 
-	if (m_boardDescBB[EN_PASS_SQUARE])
+	if (m_state.boardDescBB[EN_PASS_SQUARE])
 	{
-		newHash ^= EN_PASS_ZOBRIST[BitScanForward(m_boardDescBB[EN_PASS_SQUARE])];
+		newHash ^= EN_PASS_ZOBRIST[BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE])];
 	}
 
-	if (m_boardDescU8[W_SHORT_CASTLE])
+	if (m_state.boardDescU8[W_SHORT_CASTLE])
 	{
 		newHash ^= W_SHORT_CASTLE_ZOBRIST;
 	}
 
-	if (m_boardDescU8[W_LONG_CASTLE])
+	if (m_state.boardDescU8[W_LONG_CASTLE])
 	{
 		newHash ^= W_LONG_CASTLE_ZOBRIST;
 	}
 
-	if (m_boardDescU8[B_SHORT_CASTLE])
+	if (m_state.boardDescU8[B_SHORT_CASTLE])
 	{
 		newHash ^= B_SHORT_CASTLE_ZOBRIST;
 	}
 
-	if (m_boardDescU8[B_LONG_CASTLE])
+	if (m_state.boardDescU8[B_LONG_CASTLE])
 	{
 		newHash ^= B_LONG_CASTLE_ZOBRIST;
 	}
 
-	if (m_boardDescU8[SIDE_TO_MOVE] == BLACK)
+	if (m_state.boardDescU8[SIDE_TO_MOVE] == BLACK)
 	{
 		newHash ^= SIDE_TO_MOVE_ZOBRIST;
 	}
 
-	m_boardDescBB[HASH] = newHash;
+	m_state.boardDescBB[HASH] = newHash;
 }
 
 uint64_t Perft(Board &b, uint32_t depth)
@@ -2974,6 +3254,84 @@ void DebugRunPerftTests()
 	if (!CheckPerftWithNull("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551ULL)) { abort(); }
 }
 
+uint64_t DebugCheckMoveInfo(Board &b, uint32_t depth)
+{
+	MoveList ml;
+	b.GenerateAllLegalMoves<Board::ALL>(ml);
+
+	Board::GivesCheckInfo gci = b.ComputeGivesCheckInfo();
+
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < ml.GetSize(); ++i)
+	{
+		bool givesCheck = b.GivesCheck(ml[i], gci);
+		uint64_t speculatedHash = b.SpeculateHashAfterMove(ml[i]);
+
+		b.ApplyMove(ml[i]);
+
+		if (givesCheck != b.InCheck())
+		{
+			b.UndoMove();
+			std::cout << "GivesCheck() is wrong for " << b.MoveToAlg(ml[i]) << " in " << b.GetFen() << std::endl;
+			abort();
+		}
+
+		if (speculatedHash != b.GetHash())
+		{
+			b.UndoMove();
+			std::cout << "SpeculateHashAfterMove() is wrong for " << b.MoveToAlg(ml[i]) << " in " << b.GetFen() << std::endl;
+			abort();
+		}
+
+		++sum;
+
+		if (depth > 1)
+		{
+			sum += DebugCheckMoveInfo(b, depth - 1);
+		}
+
+		b.UndoMove();
+	}
+
+	return sum;
+}
+
+void DebugRunMoveInfoTests()
+{
+	std::vector<std::pair<std::string, uint32_t>> positions =
+	{
+		{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4 },
+		{ "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -", 3 },
+		{ "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -", 5 },
+		{ "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4 },
+		{ "rnbqkb1r/pp1p1ppp/2p5/4P3/2B5/8/PPP1NnPP/RNBQK2R w KQkq - 0 6", 3 },
+		{ "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3 },
+		{ "8/PPPk4/8/8/8/8/4Kppp/8 w - - 0 1", 4 } // promotions
+	};
+
+	SliderAttacks::Backend originalBackend = SliderAttacks::GetBackend();
+
+	for (int backend = 0; backend < SliderAttacks::NUM_BACKENDS; ++backend)
+	{
+		if (!SliderAttacks::SetBackend(static_cast<SliderAttacks::Backend>(backend)))
+		{
+			continue;
+		}
+
+		for (const auto &position : positions)
+		{
+			std::cout << "Checking move info for " << position.first << ", Depth: " << position.second <<
+						 " (" << SliderAttacks::GetBackendName(SliderAttacks::GetBackend()) << ")" << std::endl;
+
+			Board b(position.first);
+			std::cout << DebugCheckMoveInfo(b, position.second) << " moves passed" << std::endl;
+		}
+	}
+
+	SliderAttacks::SetBackend(originalBackend);
+}
+
 void DebugRunSANTests()
 {
 	std::vector<std::string> positions =
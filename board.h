@@ -28,22 +28,29 @@
 #include "board_consts.h"
 #include "move.h"
 #include "bit_ops.h"
+#include "string_view.h"
 
 const static std::string DEFAULT_POSITION_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+// enough for any FEN written by Board::WriteFen, including the NUL
+const static size_t MAX_FEN_LENGTH = 96;
+
+// the undo and history stacks are allocated with this capacity (enough for most games), and searches reserve space for
+// the maximum search depth at the root (see ReserveUndo), so the stacks never reallocate in ApplyMove during a search
+const static size_t UNDO_STACK_INITIAL_CAPACITY = 256;
+
 // these definitions are used as indices for the board description arrays
 // all aspects of a position are in the 2 arrays (one for bitboards, one for byte fields, including mailbox representation) for ease of undo-ing moves
 
 // the first array starts with bitboards for each of the 12 piece types
-// 0x0 to 0xd are used for storing piece bitboards
+// 0x0 to 0xd are used for storing piece bitboards, and the 2 slots not used by piece types are used for the other fields,
+// so the whole array is 128 bytes
 const static ptrdiff_t WHITE_OCCUPIED = 0x6;
+const static ptrdiff_t EN_PASS_SQUARE = 0x7; // stored as a bitboard since we have 64 bits anyways
 const static ptrdiff_t BLACK_OCCUPIED = 0xe;
-const static ptrdiff_t EN_PASS_SQUARE = 0x10; // stored as a bitboard since we have 64 bits anyways
-const static ptrdiff_t BOARD_HASH = 0x11;
-
-const static ptrdiff_t HASH = 0x12;
+const static ptrdiff_t HASH = 0xf;
 
-const static ptrdiff_t BOARD_DESC_BB_SIZE = 0x13;
+const static ptrdiff_t BOARD_DESC_BB_SIZE = 0x10;
 
 // the second array starts with a mailbox representation of the board, from 0x0 to 0x3F
 // we also keep track of misc things in this array
@@ -90,11 +97,33 @@ public:
 
 	struct CheckInfo
 	{
-		// this struct contains things that can be precomputed once per position, and makes checking all the moves easier
-		bool opponentRQOnSameX = false;
-		bool opponentRQOnSameY = false;
-		bool opponentBQOnSameDiag0 = false;
-		bool opponentBQOnSameDiag1 = false;
+		// this struct contains things that can be precomputed once per position, so that move generation
+		// only has to generate legal moves
+		Square kingPos = 0;
+
+		// opponent pieces giving check
+		uint64_t checkers = 0;
+
+		// our pieces that are pinned to our king (they can only move along LINE[kingPos][sq])
+		uint64_t pinned = 0;
+
+		// squares non-king moves must go to (all squares if not in check, otherwise the checker and squares
+		// between the checker and the king, and nothing in double check)
+		uint64_t targets = 0;
+	};
+
+	struct GivesCheckInfo
+	{
+		// this struct contains things that can be precomputed once per position, so that whether a move gives
+		// check can be determined with a few bitwise operations, without applying it
+		Square enemyKingPos = 0;
+
+		// our pieces that are the only piece between one of our sliders and the enemy king (moving them off
+		// the line gives discovered check)
+		uint64_t discoveredCheckers = 0;
+
+		// squares our pieces would give check from, indexed by colour-neutral piece type (0 for king)
+		uint64_t checkSquares[P + 1] = {};
 	};
 
 	// these are features of the board that change slowly (used in eval caching)
@@ -127,46 +156,83 @@ public:
 
 	using MoveCountMap = std::array<size_t, 64>;
 
-	typedef FixedVector<std::pair<uint8_t, uint64_t>, 7> UndoListBB; // list of bitboards to revert on undo
-	// 6 maximum bitboards (black occupied, white occupied, source piece type, captured piece type, promotion/castling piece type, en passant, hash)
+	// everything needed to undo a move, besides the state after the move
+	struct UndoRecord
+	{
+		uint64_t hash;
+		Move move; // NULL_MOVE for null moves
+
+		// piece type on the destination square before the move (EMPTY for non-captures and en passant)
+		uint8_t captured;
 
-	typedef FixedVector<std::pair<uint8_t, uint8_t>, 8> UndoListU8;
-	// For en passant (en passants cannot result in promotion, or reducing castling rights):
-	// half moves, in check, source square, destination square, en pass captured square - 5
-	// For promotions (capture and non-capture, cannot reduce castling rights):
-	// half moves, in check, source square, destination square - 4
-	// For regular moves and captures
-	// half moves, in check, source square, destination square, changing at most 2 castling rights - 6
-	// For castling
-	// half moves, in check, king from, king to, rook from, rook to, 2 castling rights - 8
+		// W_SHORT_CASTLE, W_LONG_CASTLE, B_SHORT_CASTLE, B_LONG_CASTLE in bits 0-3
+		uint8_t castlingRights;
 
+		// 0 if no en passant (a1 can never be an en passant square)
+		uint8_t epSquare;
+
+		uint8_t halfMovesClock;
+		uint8_t inCheck;
+	};
 
+	// everything about a position except history, in one POD struct (~200 bytes) so it can be copied with a memcpy
+	struct State
+	{
+		uint64_t boardDescBB[BOARD_DESC_BB_SIZE];
+		uint8_t boardDescU8[BOARD_DESC_U8_SIZE];
+	};
+
+	// exits on invalid FEN
 	Board(const std::string &fen);
 	Board() : Board(DEFAULT_POSITION_FEN) {}
 	~Board() {}
 
+	// copying a board copies the whole game history and undo stacks (so moves before the copy can be undone)
+	// CloneFrom only copies the state and the part of the history that matters for repetition detection (positions
+	// since the last irreversible move), and reuses this board's memory, so cloning positions into a board that's
+	// kept around (for example, one per thread) doesn't allocate
+	// moves before the clone point cannot be undone
+	void CloneFrom(const Board &other);
+
+	// copy-make: clone parent, then apply mv (returns false and leaves the parent position if mv is illegal)
+	bool CopyMake(const Board &parent, Move mv);
+
+	const State &GetState() const { return m_state; }
+
 	void RemovePiece(Square sq);
 	void PlacePiece(Square sq, PieceType pt);
 
+	// moves are legal by construction (using pins and checkers computed once per position), and generated in the
+	// order pawns, knights, bishops, rooks, queens, king
 	template <MOVE_TYPES MT> void GenerateAllLegalMoves(MoveList &moveList);
 
 	// debug function to check consistency between occupied bitboards, piece bitboards, MB, and castling rights
 	void CheckBoardConsistency();
 
+	// replaces the position (and clears the game history), reusing this board's memory
+	// the move counters are optional, and anything after them is ignored (so EPD lines can be parsed directly)
+	// returns false and leaves the board unchanged if the FEN is invalid, with a description of the problem in
+	// error (if not null)
+	bool SetFen(StringView fen, const char **error = nullptr);
+
+	// writes a NUL-terminated FEN into buf, and returns its length (or 0 if bufSize < MAX_FEN_LENGTH)
+	size_t WriteFen(char *buf, size_t bufSize, bool omitMoveNums = false) const;
+
 	std::string GetFen(bool omitMoveNums = false) const;
 
 	std::string PrintBoard() const;
 
-	bool InCheck() const { return m_boardDescU8[IN_CHECK]; }
+	bool InCheck() const { return m_state.boardDescU8[IN_CHECK]; }
 
 	// returns whether the move is legal (if not, the move is reverted)
 	bool ApplyMove(Move mv);
 
 	CheckInfo ComputeCheckInfo() const;
 
-	// same as ApplyMove, but doesn't apply the move
-	// it also uses a few shortcuts to do the check faster
-	bool CheckLegal(const CheckInfo &ci, Move mv);
+	GivesCheckInfo ComputeGivesCheckInfo() const;
+
+	// mv must be legal
+	bool GivesCheck(Move mv, const GivesCheckInfo &gci) const;
 
 	void UndoMove();
 
@@ -176,22 +242,26 @@ public:
 
 	bool operator==(const Board &other);
 
-	uint64_t GetPieceTypeBitboard(PieceType pt) const { return m_boardDescBB[pt]; }
+	uint64_t GetPieceTypeBitboard(PieceType pt) const { return m_state.boardDescBB[pt]; }
 
 	template <Color COLOR>
 	uint64_t GetOccupiedBitboard() const
-	{ return (COLOR == WHITE) ? m_boardDescBB[WHITE_OCCUPIED] : m_boardDescBB[BLACK_OCCUPIED]; }
+	{ return (COLOR == WHITE) ? m_state.boardDescBB[WHITE_OCCUPIED] : m_state.boardDescBB[BLACK_OCCUPIED]; }
 
-	Color GetSideToMove() const { return m_boardDescU8[SIDE_TO_MOVE]; }
+	Color GetSideToMove() const { return m_state.boardDescU8[SIDE_TO_MOVE]; }
 
-	PieceType GetPieceAtSquare(Square sq) const { return m_boardDescU8[sq]; }
+	PieceType GetPieceAtSquare(Square sq) const { return m_state.boardDescU8[sq]; }
 
 	Move ParseMove(std::string str);
 
 	// how many moves can be undone from the current position
-	int32_t PossibleUndo() { return m_undoStackBB.GetSize(); }
+	int32_t PossibleUndo() { return m_undoStack.GetSize(); }
 
-	uint64_t GetHash() const { return m_boardDescBB[HASH]; }
+	// make sure at least this many more moves can be applied without allocating
+	// (the board starts with UNDO_STACK_INITIAL_CAPACITY)
+	void ReserveUndo(size_t moves);
+
+	uint64_t GetHash() const { return m_state.boardDescBB[HASH]; }
 
 	// is it probable that this position is zugzwang (used in null move)
 	bool IsZugzwangProbable();
@@ -218,17 +288,25 @@ public:
 	// we count it anyways since that's extremely rare, we never claim draws
 	// (only offer, which becomes a claim if the GUI thinks the draw is claimable)
 	// in the case that the "claim" is incorrect, we will simply play on (after offering a draw)
-	bool Is3Fold();
+	bool Is3Fold() const;
+
+	bool Is50Moves() { return m_state.boardDescU8[HALF_MOVES_CLOCK] >= 100; }
 
-	bool Is50Moves() { return m_boardDescU8[HALF_MOVES_CLOCK] >= 100; }
+	// if this position has appeared before (this is used in the search)
+	// only positions since the last irreversible move with the same side to move can be repetitions, so we only look
+	// at every other position, back to the half moves clock
+	// null moves don't advance the clock, so a repetition before a null move may be missed, but those aren't real
+	// repetitions anyways
+	bool Is2Fold() const;
 
-	// look for a repetition in the last numMoves
-	// this is used in the search
-	// we don't look through the whole history because that can be very slow in long games
-	bool Is2Fold(size_t numMoves);
+	// if the side to move has a reversible move that leads to a position that has appeared before (so the position
+	// is at least a draw for the side to move, assuming the opponent can't avoid it either)
+	// this finds the move by looking up hash differences with earlier positions in a table of all reversible
+	// moves (see CUCKOO_KEYS), so we don't have to generate moves
+	bool HasUpcomingRepetition() const;
 
-	bool IsEpAvailable() const { return m_boardDescBB[EN_PASS_SQUARE] != 0; }
-	Square GetEpSquare() const { return BitScanForward(m_boardDescBB[EN_PASS_SQUARE]); }
+	bool IsEpAvailable() const { return m_state.boardDescBB[EN_PASS_SQUARE] != 0; }
+	Square GetEpSquare() const { return BitScanForward(m_state.boardDescBB[EN_PASS_SQUARE]); }
 
 	// in relaxed mode, we include material configurations that are not drawn by rule, but are
 	// effectively drawn (helpmate situations)
@@ -248,7 +326,7 @@ public:
 		- ApplyMoveSee returns the captured piecetype
 		- ResetSee resets SEE status
 	*/
-	void ResetSee() { m_seeLastWhitePT = WP; m_seeLastBlackPT = WP; m_seeTotalOccupancy = m_boardDescBB[WHITE_OCCUPIED] | m_boardDescBB[BLACK_OCCUPIED]; }
+	void ResetSee() { m_seeLastWhitePT = WP; m_seeLastBlackPT = WP; m_seeTotalOccupancy = m_state.boardDescBB[WHITE_OCCUPIED] | m_state.boardDescBB[BLACK_OCCUPIED]; }
 	PieceType ApplyMoveSee(PieceType pt, Square from, Square to);
 	bool IsSeeEligible(Move mv);
 	void UndoMoveSee();
@@ -257,14 +335,15 @@ public:
 	// undefined behaviour if move is not violent
 	PieceType GetCapturedPieceType(Move violentMove);
 
-	uint64_t SpeculateHashAfterMove(Move mv);
+	// hash of the position after the move, without applying it (eg. for prefetching)
+	uint64_t SpeculateHashAfterMove(Move mv) const;
 
-	size_t GetPieceCount(PieceType pt) const { return PopCount(m_boardDescBB[pt]); }
+	size_t GetPieceCount(PieceType pt) const { return PopCount(m_state.boardDescBB[pt]); }
 
-	bool HasCastlingRight(uint32_t right) const { return m_boardDescU8[right]; }
+	bool HasCastlingRight(uint32_t right) const { return m_state.boardDescU8[right]; }
 
 	// get the position of any piece of piece type (this is mostly used for kings)
-	size_t GetFirstPiecePos(PieceType pt) const { return BitScanForward(m_boardDescBB[pt]); }
+	size_t GetFirstPiecePos(PieceType pt) const { return BitScanForward(m_state.boardDescBB[pt]); }
 
 	template <PieceType PT>
 	uint64_t GetAttackers(Square sq) const;
@@ -296,68 +375,85 @@ public:
 	void GetSlowFeatures(SlowFeatures &sf)
 	{
 		sf.stm = GetSideToMove();
-		sf.wk = BitScanForward(m_boardDescBB[WK]);
-		sf.bk = BitScanForward(m_boardDescBB[BK]);
-		sf.wp = m_boardDescBB[WP];
-		sf.bp = m_boardDescBB[BP];
+		sf.wk = BitScanForward(m_state.boardDescBB[WK]);
+		sf.bk = BitScanForward(m_state.boardDescBB[BK]);
+		sf.wp = m_state.boardDescBB[WP];
+		sf.bp = m_state.boardDescBB[BP];
 
 		for (uint32_t i = 0; i < NUM_PIECETYPES; ++i)
 		{
-			sf.pieceCounts[i] = PopCount(m_boardDescBB[PIECE_TYPE_INDICES[i]]);
+			sf.pieceCounts[i] = PopCount(m_state.boardDescBB[PIECE_TYPE_INDICES[i]]);
 		}
 	}
 
-	bool IsChecking(Move mv)
+	// use ComputeGivesCheckInfo() and GivesCheck() instead if checking more than one move
+	bool IsChecking(Move mv) const
 	{
-		// TODO: re-implement more efficiently if this becomes a bottleneck
-		ApplyMove(mv);
-		bool ret = InCheck();
-		UndoMove();
-
-		return ret;
+		return GivesCheck(mv, ComputeGivesCheckInfo());
 	}
 
 	int32_t GetHalfMoveCount() const
 	{
-		return static_cast<int32_t>(m_undoStackBB.GetSize());
+		return static_cast<int32_t>(m_undoStack.GetSize());
 	}
 
 	Board GetMirroredPosition() const;
 
 private:
-	template <MOVE_TYPES MT> void GenerateAllPseudoLegalMoves_(MoveList &moveList) const;
-	template <MOVE_TYPES MT> void GenerateKingMoves_(Color color, MoveList &moveList) const;
-	template <MOVE_TYPES MT> void GenerateQueenMoves_(Color color, MoveList &moveList) const;
-	template <MOVE_TYPES MT> void GenerateBishopMoves_(Color color, MoveList &moveList) const;
-	template <MOVE_TYPES MT> void GenerateKnightMoves_(Color color, MoveList &moveList) const;
-	template <MOVE_TYPES MT> void GenerateRookMoves_(Color color, MoveList &moveList) const;
+	// only called when in check, and only generates moves that get out of check
+	template <MOVE_TYPES MT> void GenerateEvasions_(const CheckInfo &ci, MoveList &moveList) const;
+
+	template <MOVE_TYPES MT> void GenerateKingMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const;
+
+	template <MOVE_TYPES MT> void GenerateQueenMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const;
+	template <MOVE_TYPES MT> void GenerateBishopMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const;
+	template <MOVE_TYPES MT> void GenerateKnightMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const;
+	template <MOVE_TYPES MT> void GenerateRookMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const;
 
 	// non-quiet only generates captures and promotion to queen
 	// quiet only generates non-captures and under-promotions (including captures that result in under-promotion)
-	template <MOVE_TYPES MT> void GeneratePawnMoves_(Color color, MoveList &moveList) const;
+	template <MOVE_TYPES MT> void GeneratePawnMoves_(Color color, const CheckInfo &ci, MoveList &moveList) const;
+
+	// destination squares for MT, not considering legality
+	template <MOVE_TYPES MT> uint64_t GetDstMask_(Color color) const;
+
+	// en passant can uncover an attack on the king along the rank through both pawns, so it's checked separately
+	bool IsEpLegal_(Square from, Square to) const;
+
+	// opponent pieces attacking sq, with the given occupancy
+	uint64_t GetAttackersOf_(Square sq, uint64_t occupancy) const;
 
 	bool IsUnderAttack_(Square sq) const;
 	void UpdateInCheck_();
 
 	void UpdateHashFull_();
 
-	uint64_t m_boardDescBB[BOARD_DESC_BB_SIZE];
+	State m_state;
 
-	// yes, we are using uint64_t to store these u8 values
-	// testing shows that this is the fastest
-	// testing also shows that using uint8_t in the undo list is the fastest, despite the size mismatch
-	uint64_t m_boardDescU8[BOARD_DESC_U8_SIZE];
+	void SaveUndoRecord_(UndoRecord &ur, Move mv) const;
 
-	GrowableStack<UndoListBB> m_undoStackBB;
-	GrowableStack<UndoListU8> m_undoStackU8;
+	// one record per move (and per SEE move), preallocated so apply and undo don't allocate
+	GrowableStack<UndoRecord> m_undoStack;
 
-	// stack of hashes, for detecting repetition
+	// repetition history (hashes of previous positions, and the moves made from them)
+	// these are separate from the undo stacks, because a clone only needs a part of them
 	GrowableStack<uint64_t> m_hashStack;
 
 	GrowableStack<Move> m_moveStack;
 
+	// these keep m_repetitionFilter in sync with m_hashStack
+	void PushHashHistory_(uint64_t hash);
+	void PopHashHistory_();
+
+	static size_t RepetitionFilterSlot_(uint64_t hash) { return hash >> (64 - REPETITION_FILTER_BITS); }
+
+	// number of hashes in m_hashStack in each slot, so we can skip scanning the history for most positions
+	// counts saturate (and then stay saturated), so a 0 always means the position has not appeared before
+	const static int REPETITION_FILTER_BITS = 10;
+	uint8_t m_repetitionFilter[1 << REPETITION_FILTER_BITS];
+
 	// both these fields are stored as white piece types
-	void UpdateseeLastPT_(PieceType lastPT) { if (m_boardDescU8[SIDE_TO_MOVE] == WHITE) m_seeLastWhitePT = lastPT; else m_seeLastBlackPT = lastPT; }
+	void UpdateseeLastPT_(PieceType lastPT) { if (m_state.boardDescU8[SIDE_TO_MOVE] == WHITE) m_seeLastWhitePT = lastPT; else m_seeLastBlackPT = lastPT; }
 	PieceType m_seeLastWhitePT;
 	PieceType m_seeLastBlackPT;
 	uint64_t m_seeTotalOccupancy;
@@ -370,6 +466,14 @@ uint64_t DebugPerftWithNull(Board &b, uint32_t depth);
 
 void DebugRunPerftTests();
 
+// checks that what we compute about moves without making them (GivesCheck() and SpeculateHashAfterMove()) agrees with
+// actually making them, for every move in the legal move tree (aborts on mismatch)
+// returns the number of moves checked
+uint64_t DebugCheckMoveInfo(Board &b, uint32_t depth);
+
+// runs DebugCheckMoveInfo() on a few perft positions with all supported slider attack backends
+void DebugRunMoveInfoTests();
+
 void DebugRunSANTests();
 
 #endif // BOARD_H
@@ -21,6 +21,7 @@
 #include <iostream>
 #include <iomanip>
 
+#ifdef GIRAFFE_TABLE_GENERATOR
 uint64_t KING_ATK[64];
 uint64_t KNIGHT_ATK[64];
 
@@ -33,6 +34,10 @@ uint64_t RANK_OF_SQ[64];
 uint64_t FILE_OF_SQ[64];
 uint64_t ADJACENT_FILES_OF_SQ[64];
 
+uint64_t BETWEEN[64][64];
+uint64_t LINE[64][64];
+#endif
+
 uint64_t SqOffset(int32_t sq, int32_t xOffset, int32_t yOffset)
 {
 	int32_t x = GetX(sq) + xOffset;
@@ -46,6 +51,7 @@ uint64_t SqOffset(int32_t sq, int32_t xOffset, int32_t yOffset)
 	return 0ULL;
 }
 
+#ifdef GIRAFFE_TABLE_GENERATOR
 void BoardConstsInit()
 {
 	// generate all the attack tables
@@ -96,8 +102,46 @@ void BoardConstsInit()
 			ADJACENT_FILES_OF_SQ[sq] = FILES[GetFile(sq) + 1] | FILES[GetFile(sq) - 1];
 		}
 	}
+
+	// walk the 8 directions from each square
+	const static int32_t DIRECTIONS[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { -1, -1 }, { 1, -1 }, { -1, 1 } };
+
+	for (int32_t sq = 0; sq < 64; ++sq)
+	{
+		for (int32_t dst = 0; dst < 64; ++dst)
+		{
+			BETWEEN[sq][dst] = 0;
+			LINE[sq][dst] = 0;
+		}
+
+		for (const auto &dir : DIRECTIONS)
+		{
+			// the full line is the ray in this direction, the ray in the opposite direction, and the square itself
+			uint64_t line = Bit(sq);
+
+			for (int32_t sign = -1; sign <= 1; sign += 2)
+			{
+				for (int32_t x = GetX(sq) + sign * dir[0], y = GetY(sq) + sign * dir[1]; Valid(x) && Valid(y); x += sign * dir[0], y += sign * dir[1])
+				{
+					line |= Bit(Sq(x, y));
+				}
+			}
+
+			uint64_t between = 0;
+
+			for (int32_t x = GetX(sq) + dir[0], y = GetY(sq) + dir[1]; Valid(x) && Valid(y); x += dir[0], y += dir[1])
+			{
+				BETWEEN[sq][Sq(x, y)] = between;
+				LINE[sq][Sq(x, y)] = line;
+
+				between |= Bit(Sq(x, y));
+			}
+		}
+	}
 }
 
+#endif // GIRAFFE_TABLE_GENERATOR
+
 void DebugPrint(uint64_t bb)
 {
 	for (int32_t y = 7; y >= 0; --y)
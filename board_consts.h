@@ -21,21 +21,28 @@
 #include <cstdint>
 
 #include "types.h"
+#include "generated_tables.h"
 
-// these are initialized on startup
-extern uint64_t KING_ATK[64];
-extern uint64_t KNIGHT_ATK[64];
+// these are generated at build time (see generated_tables.h)
+extern GENERATED_TABLE uint64_t KING_ATK[64];
+extern GENERATED_TABLE uint64_t KNIGHT_ATK[64];
 
 // 0 is white, 1 is black
-extern uint64_t PAWN_ATK[64][2];
-extern uint64_t PAWN_MOVE_1[64][2];
+extern GENERATED_TABLE uint64_t PAWN_ATK[64][2];
+extern GENERATED_TABLE uint64_t PAWN_MOVE_1[64][2];
 
 // these bitboards are all 0 except for the starting files, so there is no need to check for that
-extern uint64_t PAWN_MOVE_2[64][2];
+extern GENERATED_TABLE uint64_t PAWN_MOVE_2[64][2];
 
-extern uint64_t RANK_OF_SQ[64];
-extern uint64_t FILE_OF_SQ[64];
-extern uint64_t ADJACENT_FILES_OF_SQ[64];
+extern GENERATED_TABLE uint64_t RANK_OF_SQ[64];
+extern GENERATED_TABLE uint64_t FILE_OF_SQ[64];
+extern GENERATED_TABLE uint64_t ADJACENT_FILES_OF_SQ[64];
+
+// squares strictly between 2 squares on the same rank, file, or diagonal (0 if they are not aligned)
+extern GENERATED_TABLE uint64_t BETWEEN[64][64];
+
+// the whole rank, file, or diagonal going through 2 squares, including the squares themselves (0 if they are not aligned)
+extern GENERATED_TABLE uint64_t LINE[64][64];
 
 const static uint64_t ALL = 0xffffffffffffffffULL;
 
@@ -163,7 +170,9 @@ const static int32_t RANK_8 = 7;
 // if the offseted square is invalid (outside of board), no bit is set
 uint64_t SqOffset(int32_t sq, int32_t xOffset, int32_t yOffset);
 
+#ifdef GIRAFFE_TABLE_GENERATOR
 void BoardConstsInit();
+#endif
 
 void DebugPrint(uint64_t bb);
 
@@ -18,6 +18,7 @@
 #ifndef CONTAINERS_H
 #define CONTAINERS_H
 
+#include <algorithm>
 #include <vector>
 #include <set>
 
@@ -32,6 +33,27 @@ class GrowableStack
 {
 public:
 	GrowableStack() : m_data(1), m_size(0) {}
+	explicit GrowableStack(size_t initialCapacity) : m_data(initialCapacity > 0 ? initialCapacity : 1), m_size(0) {}
+
+	// copies only copy the elements in use (not the whole capacity)
+	GrowableStack(const GrowableStack &other)
+		: m_data(other.m_data.begin(), other.m_data.begin() + std::max<size_t>(other.m_size, 1)), m_size(other.m_size) {}
+
+	GrowableStack &operator=(const GrowableStack &other)
+	{
+		if (this != &other)
+		{
+			if (m_data.size() < other.m_size)
+			{
+				m_data.resize(other.m_size);
+			}
+
+			std::copy(other.m_data.begin(), other.m_data.begin() + other.m_size, m_data.begin());
+			m_size = other.m_size;
+		}
+
+		return *this;
+	}
 
 	void Push(const T &x)
 	{
@@ -68,6 +90,15 @@ public:
 
 	size_t GetSize() const { return m_size; }
 
+	// make sure n more elements can be pushed without reallocating
+	void Reserve(size_t n)
+	{
+		if ((m_size + n) > m_data.size())
+		{
+			m_data.resize(m_size + n);
+		}
+	}
+
 	T &operator[](size_t i)
 	{
 #ifdef DEBUG
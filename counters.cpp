@@ -0,0 +1,181 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "counters.h"
+
+#include <iostream>
+#include <iomanip>
+
+namespace
+{
+
+const char *CounterNames[Counters::NUM_COUNTERS] =
+{
+	"nodes",
+	"qs_nodes",
+	"tt_probes",
+	"tt_hits",
+	"tt_cutoffs_exact",
+	"tt_cutoffs_lower",
+	"tt_cutoffs_upper",
+	"null_move_tries",
+	"null_move_cutoffs",
+	"pvs_researches",
+	"eval_hash_probes",
+	"eval_hash_hits",
+	"nn_forwards",
+	"move_eval_cache_probes",
+	"move_eval_cache_hits",
+	"gtb_probes",
+	"gtb_hits",
+	"fail_highs_move_1",
+	"fail_highs_move_2",
+	"fail_highs_move_3_4",
+	"fail_highs_move_5_8",
+	"fail_highs_move_9_plus"
+};
+
+double Percent(uint64_t x, uint64_t total)
+{
+	return (total == 0) ? 0.0 : (100.0 * x / total);
+}
+
+}
+
+namespace Counters
+{
+
+Snapshot Aggregate()
+{
+	Snapshot ret(NUM_COUNTERS, 0);
+
+	Registry::ForEach([&](const ThreadCounters &threadCounters)
+	{
+		for (size_t i = 0; i < NUM_COUNTERS; ++i)
+		{
+			ret[i] += threadCounters.counts[i].load(std::memory_order_relaxed);
+		}
+	});
+
+	return ret;
+}
+
+std::vector<uint64_t> GetThreadNodeCounts()
+{
+	std::vector<uint64_t> ret;
+
+	Registry::ForEach([&](const ThreadCounters &threadCounters)
+	{
+		uint64_t nodes = threadCounters.counts[NODES].load(std::memory_order_relaxed) +
+			threadCounters.counts[QS_NODES].load(std::memory_order_relaxed);
+
+		if (nodes != 0)
+		{
+			ret.push_back(nodes);
+		}
+	});
+
+	return ret;
+}
+
+void Reset()
+{
+	Registry::ForEach([](ThreadCounters &threadCounters)
+	{
+		for (auto &c : threadCounters.counts)
+		{
+			c.store(0, std::memory_order_relaxed);
+		}
+	});
+}
+
+const char *GetName(Counter counter)
+{
+	return CounterNames[counter];
+}
+
+void Print(const Snapshot &s)
+{
+	uint64_t ttCutoffs = s[TT_CUTOFFS_EXACT] + s[TT_CUTOFFS_LOWER] + s[TT_CUTOFFS_UPPER];
+
+	uint64_t failHighs = 0;
+	for (size_t i = FAIL_HIGHS_MOVE_1; i <= FAIL_HIGHS_MOVE_9_PLUS; ++i)
+	{
+		failHighs += s[i];
+	}
+
+	std::ios::fmtflags oldFlags = std::cout.flags();
+	std::streamsize oldPrecision = std::cout.precision();
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	std::cout << "Nodes: " << (s[NODES] + s[QS_NODES]) << " (QS: " << s[QS_NODES] << ", " << Percent(s[QS_NODES], s[NODES] + s[QS_NODES]) << "%)" << std::endl;
+
+	std::cout << "TT probes: " << s[TT_PROBES] << ", hits: " << s[TT_HITS] << " (" << Percent(s[TT_HITS], s[TT_PROBES]) << "%)"
+			  << ", cutoffs: " << ttCutoffs << " (" << Percent(ttCutoffs, s[TT_PROBES]) << "%; exact: " << s[TT_CUTOFFS_EXACT]
+			  << ", lower: " << s[TT_CUTOFFS_LOWER] << ", upper: " << s[TT_CUTOFFS_UPPER] << ")" << std::endl;
+
+	std::cout << "Null move tries: " << s[NULL_MOVE_TRIES] << ", cutoffs: " << s[NULL_MOVE_CUTOFFS] << " (" << Percent(s[NULL_MOVE_CUTOFFS], s[NULL_MOVE_TRIES]) << "%)" << std::endl;
+
+	std::cout << "PVS re-searches: " << s[PVS_RESEARCHES] << std::endl;
+
+	std::cout << "Eval hash probes: " << s[EVAL_HASH_PROBES] << ", hits: " << s[EVAL_HASH_HITS] << " (" << Percent(s[EVAL_HASH_HITS], s[EVAL_HASH_PROBES]) << "%)" << std::endl;
+
+	std::cout << "NN forwards: " << s[NN_FORWARDS] << std::endl;
+
+	std::cout << "Move eval cache probes: " << s[MOVE_EVAL_CACHE_PROBES] << ", hits: " << s[MOVE_EVAL_CACHE_HITS] << " (" << Percent(s[MOVE_EVAL_CACHE_HITS], s[MOVE_EVAL_CACHE_PROBES]) << "%)" << std::endl;
+
+	std::cout << "GTB probes: " << s[GTB_PROBES] << ", hits: " << s[GTB_HITS] << " (" << Percent(s[GTB_HITS], s[GTB_PROBES]) << "%)" << std::endl;
+
+	std::cout << "Fail highs: " << failHighs
+			  << " (move 1: " << Percent(s[FAIL_HIGHS_MOVE_1], failHighs) << "%"
+			  << ", 2: " << Percent(s[FAIL_HIGHS_MOVE_2], failHighs) << "%"
+			  << ", 3-4: " << Percent(s[FAIL_HIGHS_MOVE_3_4], failHighs) << "%"
+			  << ", 5-8: " << Percent(s[FAIL_HIGHS_MOVE_5_8], failHighs) << "%"
+			  << ", 9+: " << Percent(s[FAIL_HIGHS_MOVE_9_PLUS], failHighs) << "%)" << std::endl;
+
+	std::vector<uint64_t> threadNodes = GetThreadNodeCounts();
+
+	if (threadNodes.size() > 1)
+	{
+		std::cout << "Nodes per thread:";
+
+		for (auto n : threadNodes)
+		{
+			std::cout << " " << n;
+		}
+
+		std::cout << std::endl;
+	}
+
+	std::cout.flags(oldFlags);
+	std::cout.precision(oldPrecision);
+}
+
+void PrintMachineReadable(const Snapshot &s)
+{
+	std::cout << "stats";
+
+	for (size_t i = 0; i < NUM_COUNTERS; ++i)
+	{
+		std::cout << " " << CounterNames[i] << "=" << s[i];
+	}
+
+	std::cout << std::endl;
+}
+
+}
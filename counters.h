@@ -0,0 +1,135 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include "thread_registry.h"
+
+// search statistics, counted per thread, and only aggregated when someone asks for them (see "stats"
+// xboard command, and "bench")
+// each thread owns its own block of counters, so incrementing is just a load and a store to a cache line
+// no other thread writes to, with no locking or atomic read-modify-write
+// the counters are relaxed atomics only so that aggregating while threads are searching is well defined
+// (the totals may be slightly stale)
+namespace Counters
+{
+
+enum Counter
+{
+	NODES,
+	QS_NODES,
+
+	TT_PROBES,
+	TT_HITS,
+	TT_CUTOFFS_EXACT,
+	TT_CUTOFFS_LOWER,
+	TT_CUTOFFS_UPPER,
+
+	NULL_MOVE_TRIES,
+	NULL_MOVE_CUTOFFS,
+
+	PVS_RESEARCHES,
+
+	EVAL_HASH_PROBES,
+	EVAL_HASH_HITS,
+
+	// number of positions (not batches) evaluated by networks
+	NN_FORWARDS,
+
+	MOVE_EVAL_CACHE_PROBES,
+	MOVE_EVAL_CACHE_HITS,
+
+	GTB_PROBES,
+	GTB_HITS,
+
+	// where in the move list fail highs happen (in main search only)
+	FAIL_HIGHS_MOVE_1,
+	FAIL_HIGHS_MOVE_2,
+	FAIL_HIGHS_MOVE_3_4,
+	FAIL_HIGHS_MOVE_5_8,
+	FAIL_HIGHS_MOVE_9_PLUS,
+
+	NUM_COUNTERS
+};
+
+struct ThreadCounters
+{
+	ThreadCounters()
+	{
+		for (auto &c : counts)
+		{
+			c.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	// padding so no other thread's data (including other blocks) can share a cache line with the counts
+	char paddingBefore[64];
+	std::atomic<uint64_t> counts[NUM_COUNTERS];
+	char paddingAfter[64];
+};
+
+// totals, indexed by Counter
+typedef std::vector<uint64_t> Snapshot;
+
+typedef ThreadRegistry<ThreadCounters> Registry;
+
+inline ThreadCounters *GetThreadCounters()
+{
+	return Registry::Get();
+}
+
+inline void Inc(Counter counter, uint64_t n = 1)
+{
+	std::atomic<uint64_t> &c = GetThreadCounters()->counts[counter];
+	c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void IncFailHigh(size_t moveNum)
+{
+	if (moveNum == 0) { Inc(FAIL_HIGHS_MOVE_1); }
+	else if (moveNum == 1) { Inc(FAIL_HIGHS_MOVE_2); }
+	else if (moveNum < 4) { Inc(FAIL_HIGHS_MOVE_3_4); }
+	else if (moveNum < 8) { Inc(FAIL_HIGHS_MOVE_5_8); }
+	else { Inc(FAIL_HIGHS_MOVE_9_PLUS); }
+}
+
+Snapshot Aggregate();
+
+// per thread node counts (NODES + QS_NODES), for threads that have counted anything
+std::vector<uint64_t> GetThreadNodeCounts();
+
+// this is racy if threads are still counting (some increments may be lost)
+void Reset();
+
+const char *GetName(Counter counter);
+
+// human readable, with hit rates
+void Print(const Snapshot &snapshot);
+
+// one line of "stats name=value name=value ...", for scripts
+void PrintMachineReadable(const Snapshot &snapshot);
+
+}
+
+#endif // COUNTERS_H
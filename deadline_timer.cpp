@@ -0,0 +1,143 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "deadline_timer.h"
+
+#include <chrono>
+
+#include "util.h"
+
+DeadlineTimer::DeadlineTimer()
+	: m_nextId(1), m_runningId(0), m_quitting(false)
+{
+	m_thread = std::thread(&DeadlineTimer::TimerLoop_, this);
+}
+
+DeadlineTimer::~DeadlineTimer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quitting = true;
+	}
+
+	m_cvChanged.notify_all();
+
+	m_thread.join();
+}
+
+DeadlineTimer::TimerId DeadlineTimer::Schedule(double time, Callback callback)
+{
+	TimerId id;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		id = m_nextId++;
+
+		Entry entry;
+		entry.time = time;
+		entry.callback = std::move(callback);
+
+		m_entries[id] = std::move(entry);
+	}
+
+	m_cvChanged.notify_all();
+
+	return id;
+}
+
+bool DeadlineTimer::Reschedule(TimerId id, double time)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_entries.find(id);
+
+		if (it == m_entries.end())
+		{
+			return false;
+		}
+
+		it->second.time = time;
+	}
+
+	m_cvChanged.notify_all();
+
+	return true;
+}
+
+void DeadlineTimer::Cancel(TimerId id)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_entries.erase(id);
+
+	// if the callback is running right now, we have to wait for it to finish
+	while (m_runningId == id)
+	{
+		m_cvChanged.wait(lock);
+	}
+}
+
+void DeadlineTimer::TimerLoop_()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_quitting)
+	{
+		// there are never more than a few timers, so a linear scan is fine
+		auto earliest = m_entries.end();
+
+		for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+		{
+			if (earliest == m_entries.end() || it->second.time < earliest->second.time)
+			{
+				earliest = it;
+			}
+		}
+
+		if (earliest == m_entries.end())
+		{
+			m_cvChanged.wait(lock);
+			continue;
+		}
+
+		double timeTillDeadline = earliest->second.time - CurrentTime();
+
+		if (timeTillDeadline > 0.0)
+		{
+			// don't use wait_until here, because of libstdc++ bug #58038
+			// we re-scan after waking up, since entries may have been added, moved, or removed
+			m_cvChanged.wait_for(lock, std::chrono::microseconds(static_cast<uint64_t>(timeTillDeadline * 1000000) + 1));
+			continue;
+		}
+
+		TimerId id = earliest->first;
+		Callback callback = std::move(earliest->second.callback);
+		m_entries.erase(earliest);
+
+		m_runningId = id;
+
+		lock.unlock();
+		callback();
+		lock.lock();
+
+		m_runningId = 0;
+
+		m_cvChanged.notify_all();
+	}
+}
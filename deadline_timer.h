@@ -0,0 +1,80 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DEADLINE_TIMER_H
+#define DEADLINE_TIMER_H
+
+#include <functional>
+#include <map>
+
+#include <cstdint>
+
+#include "thread_wrapper.h"
+#include "mutex_wrapper.h"
+#include "condition_variable_wrapper.h"
+
+// a single thread that calls callbacks at scheduled times (in CurrentTime() units)
+// this replaces having a sleeping timer thread per search
+class DeadlineTimer
+{
+public:
+	typedef uint64_t TimerId;
+	typedef std::function<void ()> Callback;
+
+	DeadlineTimer();
+
+	DeadlineTimer(const DeadlineTimer&) = delete;
+	DeadlineTimer &operator=(const DeadlineTimer&) = delete;
+
+	// pending callbacks are dropped
+	~DeadlineTimer();
+
+	TimerId Schedule(double time, Callback callback);
+
+	// move a pending deadline
+	// returns false if the callback has already been called (or cancelled)
+	bool Reschedule(TimerId id, double time);
+
+	// when this returns, the callback is not running, and will not be called
+	// must not be called from the callback itself
+	void Cancel(TimerId id);
+
+private:
+	struct Entry
+	{
+		double time;
+		Callback callback;
+	};
+
+	void TimerLoop_();
+
+	std::map<TimerId, Entry> m_entries;
+
+	TimerId m_nextId;
+
+	// id of the callback currently being called (0 if none)
+	TimerId m_runningId;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cvChanged;
+
+	bool m_quitting;
+
+	std::thread m_thread;
+};
+
+#endif // DEADLINE_TIMER_H
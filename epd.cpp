@@ -0,0 +1,335 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "epd.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "util.h"
+
+namespace
+{
+
+// without the surrounding quotes (if any)
+StringView Unquote(StringView s)
+{
+	if (s.Size() >= 2 && s[0] == '"' && s[s.Size() - 1] == '"')
+	{
+		return s.Substr(1, s.Size() - 2);
+	}
+
+	return s;
+}
+
+bool IsNumber(StringView s)
+{
+	if (s.Empty())
+	{
+		return false;
+	}
+
+	for (char c : s)
+	{
+		if (c < '0' || c > '9')
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ParseInt(StringView s, int &x)
+{
+	bool negative = !s.Empty() && s[0] == '-';
+
+	if (negative)
+	{
+		s = s.Substr(1);
+	}
+
+	if (!IsNumber(s) || s.Size() > 9)
+	{
+		return false;
+	}
+
+	int ret = 0;
+
+	for (char c : s)
+	{
+		ret = ret * 10 + (c - '0');
+	}
+
+	x = negative ? -ret : ret;
+
+	return true;
+}
+
+// returns the part of s up to the first delimiter that's not in a quoted string, and removes it (and the delimiter)
+StringView NextField(StringView &s, char delim)
+{
+	bool inQuotes = false;
+	size_t end = 0;
+
+	while (end < s.Size() && (inQuotes || s[end] != delim))
+	{
+		if (s[end] == '"')
+		{
+			inQuotes = !inQuotes;
+		}
+
+		++end;
+	}
+
+	StringView field = s.Substr(0, end);
+	s = s.Substr(end + 1);
+
+	return field;
+}
+
+Move ParseMove(Board &board, StringView mvStr)
+{
+	// move strings are short enough for the small string optimization, so this doesn't allocate
+	return board.ParseMove(mvStr.ToString());
+}
+
+void ParseMoveScores(StringView operands, Board &board, Epd::Record &record)
+{
+	while (!operands.Empty())
+	{
+		StringView moveScore = NextField(operands, ',');
+
+		size_t eq = moveScore.Find('=');
+
+		if (eq == StringView::npos)
+		{
+			continue;
+		}
+
+		int points;
+
+		if (!ParseInt(moveScore.Substr(eq + 1).Trim(), points))
+		{
+			continue;
+		}
+
+		Move mv = ParseMove(board, moveScore.Substr(0, eq).Trim());
+
+		if (mv != 0)
+		{
+			record.moveScores.push_back(std::make_pair(mv, points));
+		}
+	}
+}
+
+}
+
+namespace Epd
+{
+
+void Record::Clear()
+{
+	id.clear();
+	comment.clear();
+	bestMoves.clear();
+	avoidMoves.clear();
+	moveScores.clear();
+}
+
+bool Parse(StringView line, Board &board, Record &record)
+{
+	record.Clear();
+
+	// the position is 4 FEN fields, optionally followed by the 2 move counters
+	StringView rest = line;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		rest.NextToken();
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		StringView afterCounter = rest;
+
+		if (!IsNumber(afterCounter.NextToken()))
+		{
+			break;
+		}
+
+		rest = afterCounter;
+	}
+
+	if (!board.SetFen(StringView(line.Data(), rest.Data() - line.Data())))
+	{
+		return false;
+	}
+
+	while (!rest.Empty())
+	{
+		StringView operands = NextField(rest, ';').Trim();
+		StringView opcode = operands.NextToken();
+		operands = operands.Trim();
+
+		if (opcode.Empty() || operands.Empty())
+		{
+			continue;
+		}
+
+		if (opcode == "id")
+		{
+			StringView id = Unquote(operands);
+			record.id.assign(id.Data(), id.Size());
+		}
+		else if (opcode == "c0")
+		{
+			StringView comment = Unquote(operands);
+			record.comment.assign(comment.Data(), comment.Size());
+
+			// in STS files this is a list of move=points, but other suites use it as a free-form comment
+			ParseMoveScores(comment, board, record);
+		}
+		else if (opcode == "bm" || opcode == "am")
+		{
+			std::vector<Move> &moves = (opcode == "bm") ? record.bestMoves : record.avoidMoves;
+
+			for (StringView mvStr = operands.NextToken(); !mvStr.Empty(); mvStr = operands.NextToken())
+			{
+				Move mv = ParseMove(board, mvStr);
+
+				if (mv == 0)
+				{
+					std::cerr << "Failed to parse " << opcode.ToString() << " " << mvStr.ToString() << " in " << line.ToString() << std::endl;
+					continue;
+				}
+
+				moves.push_back(mv);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool DebugBenchmark(const std::string &filename)
+{
+	std::ifstream infile(filename, std::ios::binary);
+
+	if (!infile)
+	{
+		std::cerr << "Failed to open " << filename << " for reading" << std::endl;
+		return false;
+	}
+
+	std::string contents((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+
+	std::vector<StringView> lines;
+	StringView rest(contents);
+
+	while (!rest.Empty())
+	{
+		size_t end = rest.Find('\n');
+		StringView line = rest.Substr(0, end).Trim();
+
+		if (!line.Empty())
+		{
+			lines.push_back(line);
+		}
+
+		rest = rest.Substr((end == StringView::npos) ? rest.Size() : (end + 1));
+	}
+
+	std::cout << lines.size() << " lines" << std::endl;
+
+	if (lines.empty())
+	{
+		return true;
+	}
+
+	Board board;
+	Record record;
+	char fenBuf[MAX_FEN_LENGTH];
+
+	// the checksums make sure the work can't be optimized away, and are printed so different builds can be compared
+	auto report = [&](const char *name, double startTime, uint64_t failures, uint64_t checksum)
+	{
+		double duration = CurrentTime() - startTime;
+
+		std::cout << name << ": " << duration << " seconds, " << static_cast<uint64_t>(lines.size() / duration) << " lines/s, "
+			<< (duration * 1e9 / lines.size()) << " ns/line (" << failures << " invalid, checksum " << std::hex << checksum << std::dec << ")" << std::endl;
+	};
+
+	double startTime = CurrentTime();
+	uint64_t failures = 0;
+	uint64_t checksum = 0;
+
+	for (const auto &line : lines)
+	{
+		if (board.SetFen(line))
+		{
+			checksum ^= board.GetHash();
+		}
+		else
+		{
+			++failures;
+		}
+	}
+
+	report("SetFen", startTime, failures, checksum);
+
+	startTime = CurrentTime();
+	failures = 0;
+	checksum = 0;
+
+	for (const auto &line : lines)
+	{
+		if (Parse(line, board, record))
+		{
+			checksum ^= board.GetHash() + record.bestMoves.size() + record.avoidMoves.size() + record.id.size();
+		}
+		else
+		{
+			++failures;
+		}
+	}
+
+	report("Epd::Parse", startTime, failures, checksum);
+
+	startTime = CurrentTime();
+	failures = 0;
+	checksum = 0;
+
+	for (const auto &line : lines)
+	{
+		if (board.SetFen(line))
+		{
+			checksum += board.WriteFen(fenBuf, sizeof(fenBuf));
+		}
+		else
+		{
+			++failures;
+		}
+	}
+
+	report("SetFen + WriteFen", startTime, failures, checksum);
+
+	return true;
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EPD_H
+#define EPD_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "move.h"
+#include "string_view.h"
+
+// EPD lines are a position (FEN, optionally with move counters), followed by operations separated by ';'
+// we only use bm (best moves), am (moves to avoid), id, and c0 (a comment, or move=points pairs in STS files)
+namespace Epd
+{
+
+struct Record
+{
+	std::string id;
+
+	// c0, without the quotes
+	std::string comment;
+
+	std::vector<Move> bestMoves;
+	std::vector<Move> avoidMoves;
+
+	// c0 as move=points pairs (empty if c0 is a free-form comment)
+	std::vector<std::pair<Move, int>> moveScores;
+
+	// whether there is a bm or am operation to check moves against
+	bool IsScorable() const { return !bestMoves.empty() || !avoidMoves.empty(); }
+
+	// clears all fields, but keeps their memory, so a record reused for many lines doesn't allocate
+	void Clear();
+};
+
+// parses the position into board (see Board::SetFen), and the operations into record
+// other operations are ignored, and moves that can't be parsed are reported to std::cerr and skipped
+// lines without operations (plain FENs) are accepted
+// returns false if the position is invalid (or the line is empty)
+bool Parse(StringView line, Board &board, Record &record);
+
+// measures FEN and EPD parsing and FEN writing throughput on every line of a file (meant for files with millions of
+// lines), and prints lines per second
+// the file is read into memory first, so this doesn't include I/O
+// returns false if the file cannot be read
+bool DebugBenchmark(const std::string &filename);
+
+}
+
+#endif // EPD_H
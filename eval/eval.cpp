@@ -18,7 +18,7 @@
 #include "eval.h"
 #include "types.h"
 #include "bit_ops.h"
-#include "magic_moves.h"
+#include "slider_attacks.h"
 #include "evaluator.h"
 
 #include <cmath>
@@ -101,7 +101,7 @@ Score EvaluateBishops(uint64_t bb, Phase phase, uint64_t safeDestinations, uint6
 	{
 		uint32_t idx = Extract(bb);
 
-		uint32_t mobility = PopCount(Bmagic(idx, occupancy) & safeDestinations);
+		uint32_t mobility = PopCount(SliderAttacks::Bishop(idx, occupancy) & safeDestinations);
 
 		ret += ScalePhase(BISHOP_MOBILITY[0][mobility] * MOBILITY_MULTIPLIERS[0],
 						  BISHOP_MOBILITY[1][mobility] * MOBILITY_MULTIPLIERS[1], phase);
@@ -126,7 +126,7 @@ Score EvaluateRooks(uint64_t bb, Phase phase, uint64_t safeDestinations, uint64_
 	{
 		uint32_t idx = Extract(bb);
 
-		uint32_t mobility = PopCount(Rmagic(idx, occupancy) & safeDestinations);
+		uint32_t mobility = PopCount(SliderAttacks::Rook(idx, occupancy) & safeDestinations);
 
 		ret += ScalePhase(ROOK_MOBILITY[0][mobility] * MOBILITY_MULTIPLIERS[0],
 						  ROOK_MOBILITY[1][mobility] * MOBILITY_MULTIPLIERS[1], phase);
@@ -151,7 +151,7 @@ Score EvaluateQueens(uint64_t bb, Phase phase, uint64_t safeDestinations, uint64
 	{
 		uint32_t idx = Extract(bb);
 
-		uint32_t mobility = PopCount(Qmagic(idx, occupancy) & safeDestinations);
+		uint32_t mobility = PopCount(SliderAttacks::Queen(idx, occupancy) & safeDestinations);
 
 		ret += ScalePhase(QUEEN_MOBILITY[0][mobility] * MOBILITY_MULTIPLIERS[0],
 						  QUEEN_MOBILITY[1][mobility] * MOBILITY_MULTIPLIERS[1], phase);
@@ -33,6 +33,9 @@ class EvaluatorIface
 public:
 	constexpr static float EvalFullScale = 10000.0f;
 
+	// how many positions ahead to prefetch in batch evaluation
+	const static size_t BatchPrefetchDistance = 2;
+
 	virtual bool IsANNEval() { return false; }
 
 	// return score for side to move
@@ -74,13 +77,31 @@ public:
 
 		for (size_t i = 0; i < positions.size(); ++i)
 		{
+			if ((i + BatchPrefetchDistance) < positions.size())
+			{
+				Prefetch(positions[i + BatchPrefetchDistance].GetHash());
+			}
+
 			results[i] = EvaluateForWhiteImpl(positions[i], lowerBound, upperBound);
 		}
 	}
 
+	// hint that a position with this hash will probably be evaluated soon, so evaluators with a cache can
+	// prefetch the entry (the hash may also be wrong, so this shouldn't do anything else)
+	virtual void Prefetch(uint64_t /*hash*/) {}
+
 	// this is optional
 	virtual void PrintDiag(Board &/*board*/) {}
 
+	// resize the evaluator's cache (if it has one) to use at most this many bytes
+	// returns the number of bytes actually used (0 if there is no cache)
+	virtual size_t SetCacheSize(size_t /*bytes*/) { return 0; }
+
+	// identifies the evaluation function (eg. network weights), so results computed with a
+	// different evaluator can be rejected
+	// evaluators without parameters only have to return something different from other evaluators
+	virtual uint64_t GetSignature() { return 0; }
+
 	virtual ~EvaluatorIface() {}
 };
 
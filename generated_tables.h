@@ -0,0 +1,31 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GENERATED_TABLES_H
+#define GENERATED_TABLES_H
+
+// attack, magic, PEXT, Zobrist, and board constant tables are not computed on startup
+// tools/gen_tables.cpp is built at build time with GIRAFFE_TABLE_GENERATOR defined, which compiles in the code
+// that fills the tables (initmagicmoves(), BoardConstsInit(), etc), runs it, and writes the results out as
+// obj/generated_tables.cpp, which is then compiled into the engine as read-only data
+#ifdef GIRAFFE_TABLE_GENERATOR
+#define GENERATED_TABLE
+#else
+#define GENERATED_TABLE const
+#endif
+
+#endif // GENERATED_TABLES_H
@@ -24,6 +24,10 @@
 #include <cassert>
 #include <cstdlib>
 
+#include "counters.h"
+#include "large_pages.h"
+#include "profiling.h"
+
 namespace
 {
 
@@ -138,6 +142,7 @@ namespace GTB
 
 static bool initialized = false;
 static const char **paths;
+static size_t cacheSize = DefaultCacheSize;
 
 std::string Init(std::string path)
 {
@@ -176,7 +181,10 @@ std::string Init(std::string path)
 		}
 	}
 
-	tbcache_init(CacheSize, WdlFraction);
+	// the cache is probed randomly, so it benefits from huge pages like the ttable
+	tbcache_set_allocator(LargePages::AllocateGTBCache, LargePages::FreeGTBCache);
+
+	tbcache_init(cacheSize, WdlFraction);
 
 	tbstats_reset();
 
@@ -194,6 +202,8 @@ ProbeResult Probe(const Board &b)
 		return ret;
 	}
 
+	Profiling::ScopedTimer timer(Profiling::GTB_PROBE);
+
 	// first we check total number of pawns, to rule out the majority of positions
 	// if we have more than MaxPieces-2 pawns, the position won't be in TB (2 for 2 kings)
 	if ((b.GetPieceCount(WP) + b.GetPieceCount(BP)) > (MaxPieces - 2))
@@ -228,6 +238,8 @@ ProbeResult Probe(const Board &b)
 
 	bool avail = false;
 
+	Counters::Inc(Counters::GTB_PROBES);
+
 	#pragma omp critical(tbProbe)
 	{
 		avail = tb_probe_hard(
@@ -246,7 +258,10 @@ ProbeResult Probe(const Board &b)
 	{
 		return ret;
 	}
-	else if (info == tb_DRAW)
+
+	Counters::Inc(Counters::GTB_HITS);
+
+	if (info == tb_DRAW)
 	{
 		ret = 0;
 	}
@@ -267,6 +282,22 @@ ProbeResult Probe(const Board &b)
 	return ret;
 }
 
+bool IsInitialized()
+{
+	return initialized;
+}
+
+void SetCacheSize(size_t bytes)
+{
+	cacheSize = bytes;
+
+	if (initialized)
+	{
+		// this frees the old cache
+		tbcache_restart(cacheSize, WdlFraction);
+	}
+}
+
 void DeInit()
 {
 	if (!initialized)
@@ -31,7 +31,7 @@
 namespace GTB
 {
 
-static const size_t CacheSize = 256*MB;
+static const size_t DefaultCacheSize = 256*MB;
 static const size_t WdlFraction = 96; // use 3/4 of the cache for WDL
 static const size_t MaxPieces = 5;
 
@@ -41,6 +41,11 @@ std::string Init(std::string path = "");
 
 ProbeResult Probe(const Board &b);
 
+bool IsInitialized();
+
+// can be called before or after Init()
+void SetCacheSize(size_t bytes);
+
 void DeInit();
 
 }
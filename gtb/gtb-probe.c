@@ -2438,6 +2438,20 @@ static bool_t			get_WDL_from_cache (tbkey_t key, unsigned side, index_t idx, uns
 static void				wdl_movetotop (wdl_block_t *t);
 static bool_t			wdl_preload_cache (tbkey_t key, unsigned side, index_t idx);
 #endif
+/*--------------------------------------------------------------------------*/
+/*- CACHE BUFFER ALLOCATION ------------------------------------------------*/
+
+/* the big cache buffers can be allocated by the host program (eg. on huge pages) */
+static tbcache_alloc_fn	cache_buffer_alloc = malloc;
+static tbcache_free_fn	cache_buffer_free  = free;
+
+extern void
+tbcache_set_allocator (tbcache_alloc_fn alloc_fn, tbcache_free_fn free_fn)
+{
+	cache_buffer_alloc = (NULL == alloc_fn)? malloc: alloc_fn;
+	cache_buffer_free  = (NULL == free_fn )? free  : free_fn;
+}
+
 /*--------------------------------------------------------------------------*/
 /*- DTM --------------------------------------------------------------------*/
 static bool_t			dtm_cache_is_on (void);
@@ -2498,7 +2512,7 @@ dtm_cache_init (size_t cache_mem)
 	dtm_cache.bot 				= NULL;
 	dtm_cache.n 				= 0;
 
-	if (0 == cache_mem || NULL == (dtm_cache.buffer = (dtm_t *)  malloc (cache_mem))) {
+	if (0 == cache_mem || NULL == (dtm_cache.buffer = (dtm_t *)  cache_buffer_alloc (cache_mem))) {
 		dtm_cache.cached = FALSE;
 		dtm_cache.buffer = NULL;
 		dtm_cache.entry = NULL;
@@ -2508,7 +2522,7 @@ dtm_cache_init (size_t cache_mem)
 	if (0 == max_blocks|| NULL == (dtm_cache.entry  = (dtm_block_t *) malloc (max_blocks * sizeof(dtm_block_t)))) {
 		dtm_cache.cached = FALSE;
 		dtm_cache.entry = NULL;
-		free (dtm_cache.buffer);
+		cache_buffer_free (dtm_cache.buffer);
 		dtm_cache.buffer = NULL;
 		return 0;
 	}
@@ -2549,7 +2563,7 @@ dtm_cache_done (void)
 	dtm_cache.n = 0;
 
 	if (dtm_cache.buffer != NULL)
-		free (dtm_cache.buffer);
+		cache_buffer_free (dtm_cache.buffer);
 	dtm_cache.buffer = NULL;
 
 	if (dtm_cache.entry != NULL)
@@ -7413,14 +7427,14 @@ wdl_cache_init (size_t cache_mem)
 	wdl_cache.bot 				= NULL;
 	wdl_cache.n 				= 0;
 
-	if (0 == cache_mem || NULL == (wdl_cache.buffer = (unit_t *) malloc (cache_mem))) {
+	if (0 == cache_mem || NULL == (wdl_cache.buffer = (unit_t *) cache_buffer_alloc (cache_mem))) {
 		wdl_cache.cached = FALSE;
 		return 0;
 	}
 
 	if (0 == max_blocks|| NULL == (wdl_cache.blocks = (wdl_block_t *) malloc (max_blocks * sizeof(wdl_block_t)))) {
 		wdl_cache.cached = FALSE;
-		free (wdl_cache.buffer);
+		cache_buffer_free (wdl_cache.buffer);
 		return 0;
 	}
 	
@@ -7460,7 +7474,7 @@ wdl_cache_done (void)
 	wdl_cache.n = 0;
 
 	if (wdl_cache.buffer != NULL)
-		free (wdl_cache.buffer);
+		cache_buffer_free (wdl_cache.buffer);
 	wdl_cache.buffer = NULL;
 
 	if (wdl_cache.blocks != NULL)
@@ -169,6 +169,12 @@ extern size_t		tb_indexmemory (void);
 |         	cache
 \*----------------------------------*/
 
+typedef void *(*tbcache_alloc_fn) (size_t);
+typedef void  (*tbcache_free_fn)  (void *);
+
+/* optional, must be called before tbcache_init (NULL restores malloc/free) */
+extern void			tbcache_set_allocator (tbcache_alloc_fn alloc_fn, tbcache_free_fn free_fn);
+
 extern int /*bool*/	tbcache_init    (size_t cache_mem, int wdl_fraction);
 extern int /*bool*/	tbcache_restart (size_t cache_mem, int wdl_fraction);
 extern void			tbcache_done (void);
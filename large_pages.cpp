@@ -0,0 +1,363 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "large_pages.h"
+
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include "mutex_wrapper.h"
+#include "types.h"
+#include "util.h"
+
+namespace
+{
+
+enum class AllocationType
+{
+	Normal,
+	Huge1GB,
+	Huge2MB,
+	Transparent
+};
+
+struct Allocation
+{
+	size_t mappedSize;
+	AllocationType type;
+};
+
+// we only bother with huge pages for allocations at least this big
+const static size_t MinLargePageAllocation = 2*MB;
+
+const static size_t CacheLineSize = 64;
+
+// Free() doesn't get a size, and has to know how the memory was allocated
+// (static objects owning tables free them during static destruction)
+std::map<void*, Allocation> &Allocations()
+{
+	return LeakedStatic<Allocation, std::map<void*, Allocation>>();
+}
+
+std::mutex &AllocationsMutex()
+{
+	return LeakedStatic<Allocation, std::mutex>();
+}
+
+size_t RoundUp(size_t x, size_t multiple)
+{
+	return (x + multiple - 1) / multiple * multiple;
+}
+
+const char *TypeName(AllocationType type)
+{
+	switch (type)
+	{
+	case AllocationType::Huge1GB:
+		return "1GB huge pages";
+	case AllocationType::Huge2MB:
+		return "2MB huge pages";
+	case AllocationType::Transparent:
+		return "transparent huge pages";
+	default:
+		return "normal pages";
+	}
+}
+
+void *AllocateNormal(size_t size)
+{
+#ifdef __linux__
+	void *ret = nullptr;
+
+	if (posix_memalign(&ret, CacheLineSize, size) != 0)
+	{
+		return nullptr;
+	}
+
+	memset(ret, 0, size);
+
+	return ret;
+#else
+	return calloc(size, 1);
+#endif
+}
+
+#ifdef __linux__
+// anonymous mappings are zeroed by the kernel on first touch, so unlike AllocateNormal(), we never
+// clear these (which would also physically allocate all the pages up front)
+void *TryMmap(size_t size, int extraFlags)
+{
+	void *ret = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+
+	return (ret == MAP_FAILED) ? nullptr : ret;
+}
+
+// mmap doesn't give us 2MB alignment, so we over-allocate and trim both ends,
+// otherwise THP can't use huge pages for the partial pages at the ends
+void *AllocateTransparent(size_t size)
+{
+	size_t paddedSize = size + MinLargePageAllocation;
+
+	char *raw = static_cast<char*>(TryMmap(paddedSize, 0));
+
+	if (!raw)
+	{
+		return nullptr;
+	}
+
+	char *aligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(raw), MinLargePageAllocation));
+
+	size_t headSize = aligned - raw;
+	size_t tailSize = paddedSize - headSize - size;
+
+	if (headSize)
+	{
+		munmap(raw, headSize);
+	}
+
+	if (tailSize)
+	{
+		munmap(aligned + size, tailSize);
+	}
+
+	madvise(aligned, size, MADV_HUGEPAGE);
+
+	return aligned;
+}
+
+// returns bitmask of online NUMA nodes, parsed from a list like "0-3,5"
+std::vector<unsigned long> GetNumaNodes(int &numNodes)
+{
+	std::vector<unsigned long> mask;
+	numNodes = 0;
+
+	std::ifstream nodesFile("/sys/devices/system/node/online");
+
+	std::string list;
+
+	if (!nodesFile || !std::getline(nodesFile, list))
+	{
+		return mask;
+	}
+
+	std::stringstream ss(list);
+	std::string range;
+
+	const size_t BitsPerWord = sizeof(unsigned long) * 8;
+
+	while (std::getline(ss, range, ','))
+	{
+		int first = 0;
+		int last = 0;
+
+		size_t dash = range.find('-');
+
+		if (dash == std::string::npos)
+		{
+			first = last = std::atoi(range.c_str());
+		}
+		else
+		{
+			first = std::atoi(range.substr(0, dash).c_str());
+			last = std::atoi(range.substr(dash + 1).c_str());
+		}
+
+		for (int node = first; node <= last; ++node)
+		{
+			if (mask.size() <= node / BitsPerWord)
+			{
+				mask.resize(node / BitsPerWord + 1, 0);
+			}
+
+			mask[node / BitsPerWord] |= 1UL << (node % BitsPerWord);
+			++numNodes;
+		}
+	}
+
+	return mask;
+}
+
+// spread pages over all nodes, so all threads see the same average latency, and
+// no single memory controller gets all the traffic
+// this must happen before the pages are touched
+// returns number of nodes interleaved over (0 if not interleaved)
+int InterleaveOverNodes(void *ptr, size_t size)
+{
+	static int numNodes = 0;
+	static std::vector<unsigned long> nodeMask = GetNumaNodes(numNodes);
+
+	if (numNodes < 2)
+	{
+		return 0;
+	}
+
+	unsigned long maxNode = nodeMask.size() * sizeof(unsigned long) * 8 + 1;
+
+	if (syscall(SYS_mbind, ptr, size, MPOL_INTERLEAVE, nodeMask.data(), maxNode, 0) != 0)
+	{
+		return 0;
+	}
+
+	return numNodes;
+}
+#endif // __linux__
+
+}
+
+namespace LargePages
+{
+
+void *Allocate(size_t size, const char *name, bool shared)
+{
+	if (size == 0)
+	{
+		return nullptr;
+	}
+
+	void *ret = nullptr;
+	Allocation allocation;
+	allocation.mappedSize = size;
+	allocation.type = AllocationType::Normal;
+	int numNodes = 0;
+
+#ifdef __linux__
+	if (size >= MinLargePageAllocation)
+	{
+		// explicit huge pages only work if the admin reserved some (vm.nr_hugepages)
+		// so these usually fail, and we fall back to transparent huge pages
+#ifdef MAP_HUGE_1GB
+		if (size >= 1024*MB)
+		{
+			allocation.mappedSize = RoundUp(size, 1024*MB);
+			ret = TryMmap(allocation.mappedSize, MAP_HUGETLB | MAP_HUGE_1GB);
+			allocation.type = AllocationType::Huge1GB;
+		}
+#endif
+
+		if (!ret)
+		{
+			allocation.mappedSize = RoundUp(size, MinLargePageAllocation);
+			ret = TryMmap(allocation.mappedSize, MAP_HUGETLB);
+			allocation.type = AllocationType::Huge2MB;
+		}
+
+		if (!ret)
+		{
+			allocation.mappedSize = RoundUp(size, MinLargePageAllocation);
+			ret = AllocateTransparent(allocation.mappedSize);
+			allocation.type = AllocationType::Transparent;
+		}
+
+		if (ret && shared)
+		{
+			numNodes = InterleaveOverNodes(ret, allocation.mappedSize);
+		}
+	}
+#endif
+
+	if (!ret)
+	{
+		allocation.mappedSize = size;
+		allocation.type = AllocationType::Normal;
+		ret = AllocateNormal(size);
+	}
+
+	if (!ret)
+	{
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(AllocationsMutex());
+		Allocations()[ret] = allocation;
+	}
+
+	if (shared)
+	{
+		std::cout << "# " << name << ": " << (size / MB) << " MB on " << TypeName(allocation.type);
+
+		if (numNodes > 0)
+		{
+			std::cout << ", interleaved over " << numNodes << " NUMA nodes";
+		}
+
+		std::cout << std::endl;
+	}
+
+	return ret;
+}
+
+void Free(void *ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	Allocation allocation;
+
+	{
+		std::lock_guard<std::mutex> lock(AllocationsMutex());
+
+		auto it = Allocations().find(ptr);
+
+		if (it == Allocations().end())
+		{
+			std::cerr << "LargePages::Free() called on unknown pointer" << std::endl;
+			return;
+		}
+
+		allocation = it->second;
+		Allocations().erase(it);
+	}
+
+#ifdef __linux__
+	if (allocation.type != AllocationType::Normal)
+	{
+		munmap(ptr, allocation.mappedSize);
+		return;
+	}
+#endif
+
+	free(ptr);
+}
+
+void *AllocateGTBCache(size_t size)
+{
+	return Allocate(size, "GTB cache", true);
+}
+
+void FreeGTBCache(void *ptr)
+{
+	Free(ptr);
+}
+
+}
@@ -0,0 +1,131 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LARGE_PAGES_H
+#define LARGE_PAGES_H
+
+#include <iostream>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// allocation of big, long-lived tables (transposition table, eval hash, GTB cache)
+// on Linux, we try to back them with 1GB or 2MB huge pages, to cut down on TLB misses
+// when probing randomly, and interleave tables shared by all threads over all NUMA nodes,
+// so no single memory controller gets all the traffic
+// everything falls back to a normal allocation if the system doesn't support it
+namespace LargePages
+{
+
+// name is only used for logging
+// shared tables are interleaved over NUMA nodes (and logged), others are left to the default
+// first-touch policy, so they end up on the node of the (only) thread using them
+// returned memory is at least cache line aligned, and zeroed
+// (for big allocations, pages are only physically allocated when first touched, so this is free)
+// returns nullptr on failure (like malloc)
+void *Allocate(size_t size, const char *name, bool shared);
+
+// ptr must have come from Allocate (or be nullptr)
+void Free(void *ptr);
+
+// C-style interface for GTB
+void *AllocateGTBCache(size_t size);
+void FreeGTBCache(void *ptr);
+
+}
+
+// a fixed size array allocated using LargePages
+// T must be trivially copyable (entries are written without being constructed), and
+// all zero bytes must be a valid (empty) entry
+template <typename T>
+class LargePageArray
+{
+public:
+	// see LargePages::Allocate() for what shared means
+	LargePageArray(const char *name, size_t size, bool shared)
+		: m_name(name), m_shared(shared), m_data(nullptr), m_size(0)
+	{
+		Resize(size);
+	}
+
+	LargePageArray(const LargePageArray&) = delete;
+	LargePageArray &operator=(const LargePageArray&) = delete;
+
+	~LargePageArray()
+	{
+		LargePages::Free(m_data);
+	}
+
+	// old contents are NOT preserved, all entries are zeroed
+	// this doesn't touch the new memory, so it takes about the same time no matter how big the
+	// table is, and pages are allocated when they are first used
+	void Resize(size_t newSize)
+	{
+		LargePages::Free(m_data);
+		m_data = nullptr;
+		m_size = 0;
+
+		if (newSize == 0)
+		{
+			return;
+		}
+
+		m_data = static_cast<T*>(LargePages::Allocate(newSize * sizeof(T), m_name, m_shared));
+
+		if (!m_data)
+		{
+			std::cerr << "Failed to allocate " << (newSize * sizeof(T)) << " bytes for " << m_name << std::endl;
+			exit(1);
+		}
+
+		m_size = newSize;
+	}
+
+	// big tables are filled in parallel
+	// if this is called from inside a parallel region (eg. on a per-thread table), it runs on the calling
+	// thread only, since nested regions are serialized
+	void Fill(const T &val)
+	{
+		int64_t size = static_cast<int64_t>(m_size);
+		T *data = m_data;
+
+		#pragma omp parallel for schedule(static) if (m_size * sizeof(T) >= ParallelFillThreshold)
+		for (int64_t i = 0; i < size; ++i)
+		{
+			data[i] = val;
+		}
+	}
+
+	T &operator[](size_t idx) { return m_data[idx]; }
+	const T &operator[](size_t idx) const { return m_data[idx]; }
+
+	T *Data() { return m_data; }
+	const T *Data() const { return m_data; }
+
+	size_t GetSize() const { return m_size; }
+
+private:
+	const static size_t ParallelFillThreshold = 16 * 1024 * 1024;
+
+	const char *m_name;
+	bool m_shared;
+	T *m_data;
+	size_t m_size;
+};
+
+#endif // LARGE_PAGES_H
@@ -27,11 +27,14 @@
 #include "thread_wrapper.h"
 
 #include <cmath>
+#include <cctype>
+#include <limits>
 
 #include <omp.h>
 
 #include "matrix_ops.h"
 #include "board.h"
+#include "epd.h"
 #include "ann/features_conv.h"
 #include "omp_scoped_thread_limiter.h"
 #include "eval/eval.h"
@@ -234,7 +237,7 @@ void TDL(const std::string &positionsFilename, const std::string &stsFilename)
 			#pragma omp parallel
 			{
 				Killer killer;
-				TTable ttable(1*MB); // we want the ttable to fit in L3
+				TTable ttable(1*MB, false); // we want the ttable to fit in L3
 				History history;
 
 				ttable.InvalidateAllEntries();
@@ -261,10 +264,12 @@ void TDL(const std::string &positionsFilename, const std::string &stsFilename)
 				// FEN, search score (from white), leaf color
 				std::vector<std::tuple<std::string, float, Color>> playout;
 
+				Board pos;
+
 				#pragma omp for schedule(dynamic, 1)
 				for (int64_t rootPosNum = 0; rootPosNum < numRootPositions; ++rootPosNum)
 				{
-					Board pos = Board(rootPositions[positionDrawFunc()]);
+					pos.SetFen(rootPositions[positionDrawFunc()]);
 
 					killer.Clear();
 					ttable.ClearTable();
@@ -293,11 +298,13 @@ void TDL(const std::string &positionsFilename, const std::string &stsFilename)
 					playout.clear();
 
 					// make a few moves, and store the leaves of each move into trainingBatch
+					Board leaf;
+
 					for (int64_t moveNum = 0; moveNum < HalfMovesToMake; ++moveNum)
 					{
 						Search::SearchResult result = Search::SyncSearchNodeLimited(pos, SearchNodeBudget, &annEvalThread, &gStaticMoveEvaluator, &killer, &ttable, &history);
 
-						Board leaf = pos;
+						leaf.CloneFrom(pos);
 						leaf.ApplyVariation(result.pv);
 
 						auto whiteScore = result.score * (pos.GetSideToMove() == WHITE ? 1 : -1);
@@ -356,11 +363,12 @@ void TDL(const std::string &positionsFilename, const std::string &stsFilename)
 			#pragma omp parallel
 			{
 				std::vector<float> featureConvTemp;
+				Board b;
 
 				#pragma omp for
 				for (size_t i = 0; i < positions.size(); ++i)
 				{
-					Board b(positions[i]);
+					b.SetFen(positions[i]);
 					FeaturesConv::ConvertBoardToNN(b, featureConvTemp);
 					trainingFeatures.block(static_cast<int64_t>(i), 0, 1, numFeatures) = MapStdVector(featureConvTemp);
 				}
@@ -424,32 +432,6 @@ void TDL(const std::string &positionsFilename, const std::string &stsFilename)
 	}
 }
 
-namespace
-{
-
-std::vector<std::string> split(const std::string &s, char delim)
-{
-	std::vector<std::string> ret;
-	std::stringstream ss(s);
-	std::string str;
-
-	while (std::getline(ss, str, delim))
-	{
-		ret.push_back(str);
-	}
-
-	return ret;
-}
-
-std::string trim(const std::string &input)
-{
-	auto start = input.find_first_not_of(" \t");
-	auto len = input.find_last_not_of(" \t") - start + 1;
-	return input.substr(start, len);
-}
-
-}
-
 STS::STS(const std::string &filename)
 {
 	std::ifstream stsFile(filename);
@@ -461,101 +443,174 @@ STS::STS(const std::string &filename)
 	}
 
 	std::string line;
+	Board position;
+	Epd::Record record;
+
 	while (std::getline(stsFile, line))
 	{
-		STSEntry entry;
-		std::stringstream ss(line);
-		std::string field;
-		while (std::getline(ss, field, ';'))
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
 		{
-			field = trim(field);
+			continue;
+		}
 
-			if (field.find('\"') == std::string::npos)
-			{
-				entry.position = Board(field);
-			}
-			else if (field.substr(0, 2) == "id")
-			{
-				field = field.substr(4, field.size() - 5);
-				entry.id = field;
-			}
-			else if (field.substr(0, 2) == "c0")
-			{
-				field = field.substr(4, field.size() - 5);
-				auto moveScores = split(field, ',');
-				for (auto &s : moveScores)
-				{
-					auto p = split(s, '=');
-					Move mv = entry.position.ParseMove(trim(p[0]));
-					entry.moveScores[mv] = ParseStr<int>(trim(p[1]));
-				}
-			}
+		if (!Epd::Parse(line, position, record))
+		{
+			std::cerr << "Invalid position: " << line << std::endl;
+			continue;
 		}
 
+		STSEntry entry;
+		entry.position = position;
+		entry.id = record.id;
+		entry.moveScores.insert(record.moveScores.begin(), record.moveScores.end());
+		entry.bestMoves = record.bestMoves;
+		entry.avoidMoves = record.avoidMoves;
+
 		m_entries.push_back(entry);
 	}
 }
 
-int64_t STS::Run(float maxTime, EvaluatorIface *evaluator)
+int64_t STS::Run(float maxTime, EvaluatorIface *evaluator, NodeBudget nodeBudget, bool printResults)
 {
-	std::atomic<int> finalScore = {0};
+	if (maxTime <= 0.0f && nodeBudget == 0)
+	{
+		std::cerr << "Either a time or a node budget is required" << std::endl;
+		return 0;
+	}
+
+	ANNEvaluator *annEval = nullptr;
+	std::string evaluatorString;
 
-	if (!evaluator->IsANNEval())
+	if (evaluator->IsANNEval())
 	{
-		std::cerr << "Only ANN evaluator is supported" << std::endl;
+		// ANN evaluators aren't thread-safe, so each thread needs its own copy
+		annEval = static_cast<ANNEvaluator*>(evaluator);
+		evaluatorString = annEval->ToString();
 	}
 
-	ANNEvaluator *annEval = reinterpret_cast<ANNEvaluator*>(evaluator);
+	std::vector<STSResult> results(m_entries.size());
 
-	std::string evaluatorString = annEval->ToString();
+	double startTime = CurrentTime();
 
 	#pragma omp parallel
 	{
-		std::unique_ptr<TTable> ttable_u(new TTable(1 * MB));
+		TTable ttable(StsTTableEntries, false);
 		Killer killer;
 		History history;
-		ANNEvaluator threadEval(true);
-		threadEval.FromString(evaluatorString);
 
-		#pragma omp barrier
+		std::unique_ptr<ANNEvaluator> threadEval;
+		EvaluatorIface *searchEval = evaluator;
 
-		#pragma omp for
+		if (annEval)
+		{
+			threadEval.reset(new ANNEvaluator(true));
+			threadEval->FromString(evaluatorString);
+			searchEval = threadEval.get();
+		}
+
+		#pragma omp for schedule(dynamic, 1)
 		for (size_t i = 0; i < m_entries.size(); ++i)
 		{
-			Search::RootSearchContext context;
+			// every position starts from the same state, no matter which thread it's on
+			ttable.InvalidateAllEntries();
+			killer.Clear();
+			history.Clear();
+
+			double positionStartTime = CurrentTime();
+
+			Search::SearchResult result = Search::SyncSearchTimeLimited(
+				m_entries[i].position,
+				maxTime,
+				nodeBudget == 0 ? std::numeric_limits<NodeBudget>::max() / 1024 : nodeBudget,
+				searchEval,
+				&gStaticMoveEvaluator,
+				&killer,
+				&ttable,
+				&history);
+
+			results[i].time = CurrentTime() - positionStartTime;
+			results[i].move = result.pv.empty() ? 0 : result.pv[0];
+			results[i].score = result.score;
+			results[i].nodeCount = result.nodeCount;
+
+			if (results[i].move == 0)
+			{
+				std::cerr << "Search did not return a result!" << std::endl;
+			}
+		}
+	}
 
-			context.timeAlloc = { maxTime, maxTime };
-			context.searchType = Search::SearchType_makeMove;
-			context.nodeBudget = 0;
-			context.transpositionTable = ttable_u.get();
-			context.killer = &killer;
-			context.history = &history;
-			context.evaluator = &threadEval;
-			context.moveEvaluator = &gStaticMoveEvaluator;
-			context.stopRequest = false;
+	double totalTime = CurrentTime() - startTime;
 
-			context.startBoard = m_entries[i].position;
+	int64_t finalScore = 0;
+	int64_t numSolved = 0;
+	int64_t numScorable = 0;
+	double totalSearchTime = 0.0;
+	uint64_t totalNodes = 0;
 
-			Search::AsyncSearch search(context);
-			search.Start();
-			search.Join();
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		STSEntry &entry = m_entries[i];
+		STSResult &result = results[i];
 
-			Move returnedMove = search.GetResult().pv[0];
+		int points = 0;
+		auto it = entry.moveScores.find(result.move);
+		if (it != entry.moveScores.end())
+		{
+			points = it->second;
+		}
 
-			if (returnedMove == 0)
-			{
-				std::cerr << "Search did not return a result!" << std::endl;
-			}
+		finalScore += points;
 
-			auto it = m_entries[i].moveScores.find(returnedMove);
-			if (it != m_entries[i].moveScores.end())
-			{
-				finalScore += it->second;
-			}
+		bool scorable = entry.IsScorable();
+		bool solved = scorable && IsSolved(entry, result.move);
+
+		numScorable += scorable;
+		numSolved += solved;
+		totalSearchTime += result.time;
+		totalNodes += result.nodeCount;
+
+		if (printResults)
+		{
+			std::cout << (entry.id.empty() ? ToStr(i) : entry.id) << ": " <<
+						 (result.move == 0 ? std::string("none") : entry.position.MoveToAlg(result.move, Board::SAN)) <<
+						 (scorable ? (solved ? " solved" : " failed") : "") <<
+						 (entry.moveScores.empty() ? "" : (" points: " + ToStr(points))) <<
+						 " score: " << result.score <<
+						 " nodes: " << result.nodeCount <<
+						 " time: " << result.time << "s" << std::endl;
 		}
 	}
 
+	if (printResults)
+	{
+		if (numScorable > 0)
+		{
+			std::cout << "Solved: " << numSolved << "/" << numScorable << std::endl;
+		}
+
+		std::cout << "Positions: " << m_entries.size() << std::endl;
+		std::cout << "Total nodes: " << totalNodes << std::endl;
+		std::cout << "Average time per position: " << (totalSearchTime / m_entries.size()) << "s" << std::endl;
+		std::cout << "Wall time: " << totalTime << "s" << std::endl;
+	}
+
 	return finalScore;
 }
 
+bool STS::IsSolved(const STSEntry &entry, Move mv)
+{
+	if (!entry.bestMoves.empty() && std::find(entry.bestMoves.begin(), entry.bestMoves.end(), mv) == entry.bestMoves.end())
+	{
+		return false;
+	}
+
+	if (std::find(entry.avoidMoves.begin(), entry.avoidMoves.end(), mv) != entry.avoidMoves.end())
+	{
+		return false;
+	}
+
+	return true;
+}
+
 }
@@ -27,6 +27,7 @@
 
 #include "Eigen/Core"
 
+#include "types.h"
 #include "board.h"
 #include "evaluator.h"
 
@@ -45,22 +46,49 @@ const static int64_t HalfMovesToMake = 64;
 const static int64_t SgdBatchSize = 1024;
 const static int64_t SgdEpochs = 10;
 const static int64_t SearchNodeBudget = 512;
+
+// transposition table entries per STS worker (what STS has always used, so results stay comparable)
+const static size_t StsTTableEntries = 1 * MB;
 const static std::string TrainingLogFileName = "training.log";
 
 void TDL(const std::string &positionsFilename, const std::string &stsFilename);
 
+// runs STS files, as well as EPD test suites with bm/am opcodes (eg. tests/testsuites)
 class STS
 {
 public:
-	STS(const std::string &filename);
-	int64_t Run(float maxTime, EvaluatorIface *evaluator);
-
-private:
 	struct STSEntry
 	{
 		Board position;
 		std::string id;
 		std::map<Move, int> moveScores;
+		std::vector<Move> bestMoves;
+		std::vector<Move> avoidMoves;
+
+		// whether there is a bm or am opcode to check moves against
+		bool IsScorable() const { return !bestMoves.empty() || !avoidMoves.empty(); }
+	};
+
+	STS(const std::string &filename);
+
+	const std::vector<STSEntry> &GetEntries() const { return m_entries; }
+
+	// whether mv is one of the best moves (if given), and not one of the moves to avoid
+	static bool IsSolved(const STSEntry &entry, Move mv);
+
+	// each position is searched synchronously for maxTime seconds (if > 0) and/or nodeBudget (if > 0)
+	// every position starts with a clean transposition table, so with only a node budget, results
+	// are deterministic regardless of the number of threads
+	// returns the total STS score (sum of c0 points)
+	int64_t Run(float maxTime, EvaluatorIface *evaluator, NodeBudget nodeBudget = 0, bool printResults = false);
+
+private:
+	struct STSResult
+	{
+		Move move;
+		Score score;
+		uint64_t nodeCount;
+		double time;
 	};
 
 	std::vector<STSEntry> m_entries;
@@ -171,6 +171,8 @@ const U64 magicmoves_b_mask[64]=
 	C64(0x0028440200000000), C64(0x0050080402000000), C64(0x0020100804020000), C64(0x0040201008040200)
 };
 
+#ifdef GIRAFFE_TABLE_GENERATOR
+
 #ifdef MINIMIZE_MAGIC
 U64 magicmovesbdb[5248];
 const U64* magicmoves_b_indices[64]=
@@ -478,3 +480,5 @@ void initmagicmoves(void)
 		}
 	}
 }
+
+#endif // GIRAFFE_TABLE_GENERATOR
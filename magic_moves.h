@@ -25,6 +25,7 @@
  *
  *Usage:
  *You must first initialize the generator with a call to initmagicmoves().
+ *(Giraffe: this is done at build time by the table generator, see generated_tables.h)
  *Then you can use the following macros for generating move bitboards by
  *giving them a square and an occupancy.  The macro will then "return"
  *the correct move bitboard for that particular square and occupancy. It
@@ -94,6 +95,8 @@
 #ifndef __MAGIC_MOVES_H
 #define __MAGIC_MOVES_H
 
+#include "generated_tables.h"
+
 /*********MODIFY THE FOLLOWING IF NECESSARY********/
 //the default configuration is the best
 
@@ -107,6 +110,11 @@
 
 #define USE_INLINING /*the MMINLINE keyword is assumed to be available*/
 
+//Giraffe: the tables are generated at build time (see generated_tables.h), which is only done for the default configuration
+#if (defined(MINIMIZE_MAGIC) || defined(PERFECT_MAGIC_HASH)) && !defined(GIRAFFE_TABLE_GENERATOR)
+    #error magicmoves - only the default configuration can be used with generated tables
+#endif
+
 #ifndef __64_BIT_INTEGER_DEFINED__
     #define __64_BIT_INTEGER_DEFINED__
     #if defined(_MSC_VER) && _MSC_VER<1300
@@ -176,8 +184,8 @@ extern const unsigned int magicmoves_r_shift[64];
             #define RmagicNOMASK(square, occupancy) magicmovesrdb[square][((occupancy)*magicmoves_r_magics[square])>>MINIMAL_R_BITS_SHIFT(square)]
         #endif //USE_INLINING
 
-        extern U64 magicmovesbdb[64][1<<9];
-        extern U64 magicmovesrdb[64][1<<12];
+        extern GENERATED_TABLE U64 magicmovesbdb[64][1<<9];
+        extern GENERATED_TABLE U64 magicmovesrdb[64][1<<12];
 
     #endif //MINIMIAZE_MAGICMOVES
 #else //PERFCT_MAGIC_HASH defined
@@ -264,7 +272,9 @@ extern const unsigned int magicmoves_r_shift[64];
 
 #endif //USE_INLINING
 
+#ifdef GIRAFFE_TABLE_GENERATOR
 void initmagicmoves(void);
+#endif
 
 #endif // __MAGIC_MOVES_H
 
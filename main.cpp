@@ -23,11 +23,13 @@
 #include "mutex_wrapper.h"
 
 #include <cstdint>
+#include <cstdlib>
 
 #include "magic_moves.h"
 #include "board_consts.h"
 #include "move.h"
 #include "board.h"
+#include "epd.h"
 #include "eval/eval.h"
 #include "see.h"
 #include "search.h"
@@ -44,6 +46,12 @@
 #include "move_evaluator.h"
 #include "static_move_evaluator.h"
 #include "move_stats/move_stats.h"
+#include "batch_analysis.h"
+#include "bench_suite.h"
+#include "time_manager.h"
+#include "counters.h"
+#include "profiling.h"
+#include "slider_attacks.h"
 
 #include "Eigen/Dense"
 
@@ -116,9 +124,7 @@ void Initialize()
 	// turn off IO buffering
 	std::cout.setf(std::ios::unitbuf);
 
-	initmagicmoves();
-	BoardConstsInit();
-	InitializeZobrist();
+	SliderAttacks::Init();
 }
 
 int main(int argc, char **argv)
@@ -249,6 +255,8 @@ int main(int argc, char **argv)
 	}
 	else if (argc >= 2 && std::string(argv[1]) == "bench")
 	{
+		Counters::Reset();
+
 		double startTime = CurrentTime();
 
 		static const NodeBudget BenchNodeBudget = 64*1024*1024;
@@ -262,8 +270,105 @@ int main(int argc, char **argv)
 
 		std::cout << "Time: " << (CurrentTime() - startTime) << "s" << std::endl;
 
+		Counters::PrintMachineReadable(Counters::Aggregate());
+
+		return 0;
+	}
+	else if (argc >= 2 && std::string(argv[1]) == "bench_suite")
+	{
+		BenchSuite::Config config;
+		std::string jsonFilename;
+		std::string baselineFilename;
+
+		for (int i = 2; (i + 1) < argc; i += 2)
+		{
+			std::string param = argv[i];
+
+			if (param == "nodes")
+			{
+				config.nodeBudget = ParseStr<NodeBudget>(argv[i + 1]);
+			}
+			else if (param == "json")
+			{
+				jsonFilename = argv[i + 1];
+			}
+			else if (param == "baseline")
+			{
+				baselineFilename = argv[i + 1];
+			}
+			else if (param == "suite")
+			{
+				config.suites.push_back(argv[i + 1]);
+			}
+			else
+			{
+				std::cerr << "Unknown parameter: " << param << std::endl;
+				std::cout << "Usage: " << argv[0] << " bench_suite [nodes <node budget>] [json <output file>] [baseline <baseline JSON file>] [suite <EPD file>]..." << std::endl;
+				return 1;
+			}
+		}
+
+		if (config.suites.empty())
+		{
+			config.suites = BenchSuite::GetDefaultSuites();
+		}
+
+		BenchSuite::Report baseline;
+
+		// read the baseline first, so we don't find out it's broken after running everything
+		if (!baselineFilename.empty() && !BenchSuite::ReadJson(baselineFilename, baseline))
+		{
+			return 1;
+		}
+
+		BenchSuite::Report report;
+
+		if (!BenchSuite::Run(config, backend.GetEvaluator(), backend.GetMoveEvaluator(), report))
+		{
+			return 1;
+		}
+
+		if (!jsonFilename.empty() && !BenchSuite::WriteJson(report, jsonFilename))
+		{
+			return 1;
+		}
+
+		if (!baselineFilename.empty())
+		{
+			return (BenchSuite::Compare(baseline, report) == 0) ? 0 : 2;
+		}
+
 		return 0;
 	}
+	else if (argc >= 2 && std::string(argv[1]) == "bench_compare")
+	{
+		if (argc < 4)
+		{
+			std::cout << "Usage: " << argv[0] << " bench_compare <baseline JSON file> <JSON file>" << std::endl;
+			return 0;
+		}
+
+		BenchSuite::Report baseline;
+		BenchSuite::Report report;
+
+		if (!BenchSuite::ReadJson(argv[2], baseline) || !BenchSuite::ReadJson(argv[3], report))
+		{
+			return 1;
+		}
+
+		// so this can be used in scripts
+		return (BenchSuite::Compare(baseline, report) == 0) ? 0 : 2;
+	}
+	else if (argc >= 2 && std::string(argv[1]) == "epd_bench")
+	{
+		if (argc < 3)
+		{
+			std::cout << "Usage: " << argv[0] << " epd_bench <EPD/FEN file>" << std::endl;
+			return 0;
+		}
+
+		return Epd::DebugBenchmark(argv[2]) ? 0 : 1;
+	}
 	else if (argc >= 2 && std::string(argv[1]) == "sample_internal")
 	{
 		// MUST UNCOMMENT "#define SAMPLING" in static move evaluator
@@ -411,11 +516,53 @@ int main(int argc, char **argv)
 
 		return 0;
 	}
+	else if (argc >= 2 && std::string(argv[1]) == "analyze_batch")
+	{
+		if (argc < 4)
+		{
+			std::cout << "Usage: " << argv[0] << " analyze_batch <EPD/FEN file> <output file> [nodes <node budget>] [time <seconds per position>] [threads <num threads>]" << std::endl;
+			return 0;
+		}
+
+		BatchAnalysis::Config config;
+
+		for (int i = 4; (i + 1) < argc; i += 2)
+		{
+			std::string param = argv[i];
+
+			if (param == "nodes")
+			{
+				config.nodeBudget = ParseStr<NodeBudget>(argv[i + 1]);
+			}
+			else if (param == "time")
+			{
+				config.maxTime = ParseStr<double>(argv[i + 1]);
+			}
+			else if (param == "threads")
+			{
+				config.numThreads = ParseStr<int>(argv[i + 1]);
+			}
+			else
+			{
+				std::cerr << "Unknown parameter: " << param << std::endl;
+				return 1;
+			}
+		}
+
+		// ANN evaluators are not thread-safe, so each worker gets a copy
+		// the ANN move evaluator isn't either, so we always use the static one here (like label_bm)
+		ANNEvaluator *annEvaluator = (backend.GetEvaluator() == &evaluator) ? &evaluator : nullptr;
+
+		BatchAnalysis::Run(argv[2], argv[3], config, backend.GetEvaluator(), annEvaluator, &gStaticMoveEvaluator);
+
+		return 0;
+	}
 	else if (argc >= 2 && std::string(argv[1]) == "train_move_eval")
 	{
 		if (argc < 4)
 		{
-			std::cout << "Usage: " << argv[0] << " train_move_eval <EPD/FEN file> <output file>" << std::endl;
+			std::cout << "Usage: " << argv[0] << " train_move_eval <EPD/FEN file> <output file> [dataset file]" << std::endl;
+			std::cout << "If a dataset file is given, training examples are streamed from it (it's created from the training positions if it doesn't exist)" << std::endl;
 			return 0;
 		}
 
@@ -475,7 +622,22 @@ int main(int argc, char **argv)
 
 		ANNMoveEvaluator meval(evaluator);
 
-		meval.Train(fens, bestMoves);
+		if (argc >= 5)
+		{
+			std::string datasetFilename = argv[4];
+
+			if (!FileReadable(datasetFilename))
+			{
+				std::cout << "Writing dataset to " << datasetFilename << std::endl;
+				meval.WriteDataset(fens, bestMoves, datasetFilename);
+			}
+
+			meval.TrainFromDataset(datasetFilename);
+		}
+		else
+		{
+			meval.Train(fens, bestMoves);
+		}
 
 		meval.Test(fensTest, bestMovesTest);
 
@@ -483,6 +645,18 @@ int main(int argc, char **argv)
 
 		return 0;
 	}
+	else if (argc >= 2 && std::string(argv[1]) == "time_sim")
+	{
+		if (argc < 3)
+		{
+			std::cout << "Usage: " << argv[0] << " time_sim <engine log> [param=value]..." << std::endl;
+			return 0;
+		}
+
+		SimulateTimeManagement(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+
+		return 0;
+	}
 	else if (argc >= 2 && std::string(argv[1]) == "move_stats")
 	{
 		if (argc < 3)
@@ -533,10 +707,15 @@ int main(int argc, char **argv)
 
 				std::cout << "feature ping=1 setboard=1 playother=0 san=0 usermove=1 time=1 draw=0 sigint=0 sigterm=0 "
 							 "reuse=1 analyze=1 myname=\"" << name << "\" variants=normal colors=0 ics=0 name=0 pause=0 nps=0 "
-							 "debug=1 memory=0 smp=0 done=0" << std::endl;
+							 "debug=1 memory=1 smp=0 done=0" << std::endl;
 
 				std::cout << "feature option=\"GaviotaTbPath -path .\"" << std::endl;
 
+				// same as the memory command, for GUIs that don't send it
+				std::cout << "feature option=\"Memory -spin " << (Backend::DEFAULT_TTABLE_SIZE / MB) << " 8 1048576\"" << std::endl;
+
+				std::cout << "feature option=\"MultiPV -spin 1 1 64\"" << std::endl;
+
 				std::cout << "feature done=1" << std::endl;
 			}
 		}
@@ -612,6 +791,13 @@ int main(int argc, char **argv)
 			line >> maxDepth;
 			backend.SetMaxDepth(maxDepth);
 		}
+		else if (cmd == "memory")
+		{
+			// in MB
+			size_t memory = 0;
+			line >> memory;
+			backend.SetMemoryBudget(memory * MB);
+		}
 		else if (cmd == "time")
 		{
 			double t;
@@ -702,9 +888,48 @@ int main(int argc, char **argv)
 		}
 		else if (cmd == "perft")
 		{
+			// perft <depth> [threads <N>] [hash <MB>] [nobulk] [divide]
+			// hash 0 disables the hash table, and nobulk makes and unmakes moves at the last ply
+			int32_t depth = 0;
+			line >> depth;
+
+			ParallelPerft::Config config;
+			std::string param;
+
+			while (line >> param)
+			{
+				if (param == "threads")
+				{
+					line >> config.numThreads;
+				}
+				else if (param == "hash")
+				{
+					size_t hashMB = 0;
+					line >> hashMB;
+					config.hashSize = hashMB * MB;
+				}
+				else if (param == "nobulk")
+				{
+					config.bulkCount = false;
+				}
+				else if (param == "divide")
+				{
+					config.divide = true;
+				}
+				else
+				{
+					std::cout << "Error: unknown perft option " << param << std::endl;
+				}
+			}
+
+			backend.DebugRunPerft(depth, config);
+		}
+		else if (cmd == "perft_ref")
+		{
+			// the original single threaded perft without hashing, for comparison
 			int32_t depth;
 			line >> depth;
-			backend.DebugRunPerft(depth);
+			backend.DebugRunReferencePerft(depth);
 		}
 		else if (cmd == "perft_with_null")
 		{
@@ -728,8 +953,9 @@ int main(int argc, char **argv)
 		}
 		else if (cmd == "runtests")
 		{
-			//SEE::DebugRunSeeTests();
+			SEE::DebugRunSeeTests();
 			//DebugRunPerftTests();
+			DebugRunMoveInfoTests();
 			DebugRunSANTests();
 			std::cout << "All passed!" << std::endl;
 		}
@@ -811,6 +1037,17 @@ int main(int argc, char **argv)
 				if (optionName == "GaviotaTbPath")
 				{
 					std::cout << GTB::Init(optionValue) << std::endl;
+
+					// the GTB cache now needs a share of the memory budget
+					backend.ReapplyMemoryBudget();
+				}
+				else if (optionName == "Memory")
+				{
+					backend.SetMemoryBudget(std::strtoull(optionValue.c_str(), nullptr, 10) * MB);
+				}
+				else if (optionName == "MultiPV")
+				{
+					backend.SetMultiPV(std::strtoull(optionValue.c_str(), nullptr, 10));
 				}
 				else
 				{
@@ -822,14 +1059,96 @@ int main(int argc, char **argv)
 				std::cout << "Error: option requires value" << std::endl;
 			}
 		}
+		else if (cmd == "savett")
+		{
+			// savett <filename> [max entries]
+			// with max entries, only the entries with the highest node budgets are saved
+			std::string filename;
+			size_t maxEntries = 0;
+			line >> filename >> maxEntries;
+
+			backend.SaveTTableSnapshot(filename, maxEntries);
+		}
+		else if (cmd == "loadtt")
+		{
+			// loadtt <filename>
+			// this can be put in the init file to load a snapshot at startup
+			std::string filename;
+			line >> filename;
+
+			backend.LoadTTableSnapshot(filename);
+		}
+		else if (cmd == "stats")
+		{
+			// stats [reset|raw]
+			// counters are totals over all searches since startup (or the last reset)
+			std::string arg;
+			line >> arg;
+
+			if (arg == "reset")
+			{
+				Counters::Reset();
+			}
+			else if (arg == "raw")
+			{
+				Counters::PrintMachineReadable(Counters::Aggregate());
+			}
+			else
+			{
+				Counters::Print(Counters::Aggregate());
+			}
+		}
+		else if (cmd == "profile")
+		{
+			// profile <N> - time 1 in every N calls of the profiled functions (0 to disable)
+			// profile [reset] - print (or clear) totals since profiling was enabled
+			// while enabled, a breakdown is also printed at the end of each search
+			std::string arg;
+			line >> arg;
+
+			if (arg == "reset")
+			{
+				Profiling::Reset();
+			}
+			else if (!arg.empty())
+			{
+				Profiling::SetSamplingInterval(std::atoi(arg.c_str()));
+			}
+			else
+			{
+				Profiling::SectionTotals zero = { 0, 0, 0 };
+				Profiling::PrintBreakdown(Profiling::Snapshot(Profiling::NUM_SECTIONS, zero), Profiling::Aggregate(), 0.0, "#");
+			}
+		}
+		else if (cmd == "attacks")
+		{
+			// attacks [magic|pext] - print (or select) the sliding attack lookup backend
+			std::string arg;
+			line >> arg;
+
+			if (!arg.empty())
+			{
+				SliderAttacks::Backend attacksBackend = SliderAttacks::ParseBackendName(arg);
+
+				if (attacksBackend == SliderAttacks::NUM_BACKENDS || !SliderAttacks::SetBackend(attacksBackend))
+				{
+					std::cout << "Error: " << arg << " is not supported" << std::endl;
+				}
+			}
+
+			std::cout << "# Slider attacks: " << SliderAttacks::GetBackendName(SliderAttacks::GetBackend()) << std::endl;
+		}
 		else if (cmd == "runsts")
 		{
+			// runsts <STS/EPD file> <time per position> [node budget]
+			// with time 0 and a node budget, results are deterministic
 			std::string filename;
-			float timePerPosition;
-			line >> filename >> timePerPosition;
+			float timePerPosition = 0.0f;
+			NodeBudget nodeBudget = 0;
+			line >> filename >> timePerPosition >> nodeBudget;
 
 			Learn::STS sts(filename);
-			auto score = sts.Run(timePerPosition, &evaluator);
+			auto score = sts.Run(timePerPosition, backend.GetEvaluator(), nodeBudget, true);
 
 			std::cout << "Score: " << score << std::endl;
 		}
@@ -0,0 +1,682 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// microbenchmarks for core primitives, to validate optimizations without search noise
+// this is a separate binary ("make microbench"), linked against everything except main.cpp
+//
+// giraffe_microbench [positions <EPD/FEN file>] [net <eval net>] [mnet <move eval net>] [runs <N>]
+//                    [run_time <seconds>] [pin <cpu>] [filter <substring>]
+//
+// each benchmark loops over all positions in the corpus (repeatedly, until a run takes at least run_time),
+// and reports mean and standard deviation of ns/op over all runs, the fastest run, and cycles/op
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <omp.h>
+
+#include "Eigen/Dense"
+
+#include "ann/eigen_ann.h"
+#include "ann/features_conv.h"
+#include "board.h"
+#include "board_consts.h"
+#include "learn.h"
+#include "magic_moves.h"
+#include "profiling.h"
+#include "see.h"
+#include "slider_attacks.h"
+#include "util.h"
+#include "zobrist.h"
+
+namespace
+{
+
+const static std::string DefaultCorpus = "tests/testsuites/WAC.epd";
+const static std::string DefaultEvalNet = "eval.t7";
+const static std::string DefaultMoveEvalNet = "meval.t7";
+
+// used if there's no corpus file
+const static char *FallbackFens[] =
+{
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"2r2rk1/pp3pp1/b2Pp3/P1Q4p/RPqN2n1/8/2P2PPP/2B1R1K1 w - - 0 1",
+	"8/1nr3pk/p3p1r1/4p3/P3P1q1/4PR1N/3Q2PK/5R2 w - - 0 1",
+	"5R2/8/7r/7P/5RPK/1k6/4r3/8 w - - 0 1",
+	"r5k1/2p2pp1/1nppr2p/8/p2PPp2/PPP2P1P/3N2P1/R3RK2 w - - 0 1",
+	"8/R7/8/1k6/1p1Bq3/8/4NK2/8 w - - 0 1"
+};
+
+// rows per ForwardMultiple call when benchmarking the eval net
+const static int64_t EvalBatchSize = 64;
+
+// results are accumulated here so the compiler can't optimize benchmarked calls away
+volatile int64_t gSink = 0;
+
+struct Config
+{
+	std::string corpusFilename = DefaultCorpus;
+	std::string evalNetFilename = DefaultEvalNet;
+	std::string moveEvalNetFilename = DefaultMoveEvalNet;
+	int runs = 10;
+	double runTime = 0.1;
+	int pinCpu = -1;
+	std::string filter;
+};
+
+// a single pass over the corpus, returns number of ops performed
+typedef std::function<uint64_t ()> BenchmarkPass;
+
+void RunBenchmark(const Config &config, const std::string &name, BenchmarkPass pass)
+{
+	if (!config.filter.empty() && name.find(config.filter) == std::string::npos)
+	{
+		return;
+	}
+
+	// warm up caches and branch predictors, and find out how many passes make a run
+	uint64_t passesPerRun = 1;
+
+	while (true)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint64_t i = 0; i < passesPerRun; ++i)
+		{
+			pass();
+		}
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (elapsed >= config.runTime || passesPerRun >= (1ULL << 30))
+		{
+			break;
+		}
+
+		passesPerRun *= 2;
+	}
+
+	std::vector<double> nsPerOp;
+	double totalCycles = 0.0;
+	uint64_t totalOps = 0;
+
+	for (int run = 0; run < config.runs; ++run)
+	{
+		uint64_t ops = 0;
+
+		uint64_t startCycles = Profiling::ReadCycleCounter();
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint64_t i = 0; i < passesPerRun; ++i)
+		{
+			ops += pass();
+		}
+
+		auto end = std::chrono::steady_clock::now();
+		uint64_t cycles = Profiling::ReadCycleCounter() - startCycles;
+
+		if (ops == 0)
+		{
+			std::cout << name << ": nothing to do" << std::endl;
+			return;
+		}
+
+		nsPerOp.push_back(std::chrono::duration<double, std::nano>(end - start).count() / ops);
+		totalCycles += cycles;
+		totalOps += ops;
+	}
+
+	double mean = 0.0;
+	double best = nsPerOp[0];
+
+	for (double x : nsPerOp)
+	{
+		mean += x;
+		best = std::min(best, x);
+	}
+
+	mean /= nsPerOp.size();
+
+	double variance = 0.0;
+
+	for (double x : nsPerOp)
+	{
+		variance += (x - mean) * (x - mean);
+	}
+
+	double stdDev = (nsPerOp.size() > 1) ? std::sqrt(variance / (nsPerOp.size() - 1)) : 0.0;
+
+	std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+			  << std::setw(12) << mean << " ns/op"
+			  << " +- " << std::setw(5) << (mean > 0.0 ? (100.0 * stdDev / mean) : 0.0) << "%"
+			  << "  best: " << std::setw(10) << best << " ns/op"
+			  << "  " << std::setw(10) << (totalCycles / totalOps) << " cycles/op"
+			  << "  (" << (totalOps / config.runs) << " ops/run)" << std::endl;
+}
+
+std::vector<Board> LoadCorpus(const std::string &filename)
+{
+	std::vector<Board> ret;
+
+	if (std::ifstream(filename))
+	{
+		Learn::STS corpus(filename);
+
+		for (const auto &entry : corpus.GetEntries())
+		{
+			ret.push_back(entry.position);
+		}
+
+		std::cout << "Corpus: " << ret.size() << " positions from " << filename << std::endl;
+	}
+	else
+	{
+		for (const char *fen : FallbackFens)
+		{
+			ret.push_back(Board(fen));
+		}
+
+		std::cout << "Corpus: " << filename << " not found, using " << ret.size() << " built-in positions" << std::endl;
+	}
+
+	return ret;
+}
+
+void PinToCpu(int cpu)
+{
+#ifdef __linux__
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+
+	if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+	{
+		std::cerr << "Failed to pin to CPU " << cpu << std::endl;
+	}
+	else
+	{
+		std::cout << "Pinned to CPU " << cpu << std::endl;
+	}
+#else
+	std::cerr << "Pinning is only supported on Linux (CPU " << cpu << " ignored)" << std::endl;
+#endif
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	Config config;
+
+	for (int i = 1; (i + 1) < argc; i += 2)
+	{
+		std::string param = argv[i];
+
+		if (param == "positions")
+		{
+			config.corpusFilename = argv[i + 1];
+		}
+		else if (param == "net")
+		{
+			config.evalNetFilename = argv[i + 1];
+		}
+		else if (param == "mnet")
+		{
+			config.moveEvalNetFilename = argv[i + 1];
+		}
+		else if (param == "runs")
+		{
+			config.runs = std::max(ParseStr<int>(argv[i + 1]), 1);
+		}
+		else if (param == "run_time")
+		{
+			config.runTime = ParseStr<double>(argv[i + 1]);
+		}
+		else if (param == "pin")
+		{
+			config.pinCpu = ParseStr<int>(argv[i + 1]);
+		}
+		else if (param == "filter")
+		{
+			config.filter = argv[i + 1];
+		}
+		else
+		{
+			std::cerr << "Unknown parameter: " << param << std::endl;
+			std::cout << "Usage: " << argv[0] << " [positions <EPD/FEN file>] [net <eval net>] [mnet <move eval net>] [runs <N>] [run_time <seconds>] [pin <cpu>] [filter <substring>]" << std::endl;
+			return 1;
+		}
+	}
+
+	if ((argc % 2) == 0)
+	{
+		std::cerr << "Parameter " << argv[argc - 1] << " requires a value" << std::endl;
+		return 1;
+	}
+
+	// everything here is single threaded
+	omp_set_num_threads(1);
+	Eigen::setNbThreads(1);
+
+	SliderAttacks::Init();
+
+	if (config.pinCpu >= 0)
+	{
+		PinToCpu(config.pinCpu);
+	}
+
+	std::vector<Board> corpus = LoadCorpus(config.corpusFilename);
+
+	// things that are inputs to the benchmarks, but shouldn't be timed
+	std::vector<MoveList> legalMoves(corpus.size());
+	std::vector<MoveList> violentMoves(corpus.size());
+	std::vector<FeaturesConv::ConvertMovesInfo> convInfos(corpus.size());
+	NNMatrixRM boardFeatures;
+	std::vector<NNMatrixRM> moveFeatures(corpus.size());
+
+	for (size_t i = 0; i < corpus.size(); ++i)
+	{
+		Board &board = corpus[i];
+
+		board.GenerateAllLegalMoves<Board::ALL>(legalMoves[i]);
+		board.GenerateAllLegalMoves<Board::VIOLENT>(violentMoves[i]);
+
+		MoveList &ml = legalMoves[i];
+
+		convInfos[i].see.resize(ml.GetSize());
+		convInfos[i].nmSee.resize(ml.GetSize());
+
+		for (size_t j = 0; j < ml.GetSize(); ++j)
+		{
+			convInfos[i].see[j] = SEE::StaticExchangeEvaluation(board, ml[j]);
+			convInfos[i].nmSee[j] = SEE::NMStaticExchangeEvaluation(board, ml[j]);
+		}
+
+		std::vector<float> features;
+		FeaturesConv::ConvertBoardToNN(board, features);
+
+		if (i == 0)
+		{
+			boardFeatures.resize(corpus.size(), features.size());
+		}
+
+		boardFeatures.row(i) = Eigen::Map<NNVector>(&features[0], 1, features.size());
+
+		if (ml.GetSize() > 0)
+		{
+			FeaturesConv::ConvertMovesToNN(board, convInfos[i], ml, moveFeatures[i]);
+		}
+	}
+
+	// none of the benchmarks should be timing the profiling timers
+	Profiling::SetSamplingInterval(0);
+
+	std::cout << std::endl;
+
+	RunBenchmark(config, "apply_undo_move", [&]()
+	{
+		uint64_t ops = 0;
+
+		for (size_t i = 0; i < corpus.size(); ++i)
+		{
+			Board &board = corpus[i];
+			MoveList &ml = legalMoves[i];
+
+			for (size_t j = 0; j < ml.GetSize(); ++j)
+			{
+				board.ApplyMove(ml[j]);
+				gSink += board.GetHash();
+				board.UndoMove();
+			}
+
+			ops += ml.GetSize();
+		}
+
+		return ops;
+	});
+
+	RunBenchmark(config, "copy_make", [&]()
+	{
+		uint64_t ops = 0;
+		Board child;
+
+		for (size_t i = 0; i < corpus.size(); ++i)
+		{
+			MoveList &ml = legalMoves[i];
+
+			for (size_t j = 0; j < ml.GetSize(); ++j)
+			{
+				child.CopyMake(corpus[i], ml[j]);
+				gSink += child.GetHash();
+			}
+
+			ops += ml.GetSize();
+		}
+
+		return ops;
+	});
+
+	// copying a board with the copy constructor (copies undo stacks and all history)
+	RunBenchmark(config, "board_copy", [&]()
+	{
+		for (const auto &board : corpus)
+		{
+			Board copy = board;
+			gSink += copy.GetHash();
+		}
+
+		return static_cast<uint64_t>(corpus.size());
+	});
+
+	RunBenchmark(config, "board_clone", [&]()
+	{
+		Board clone;
+
+		for (const auto &board : corpus)
+		{
+			clone.CloneFrom(board);
+			gSink += clone.GetHash();
+		}
+
+		return static_cast<uint64_t>(corpus.size());
+	});
+
+	// check status of every legal move, with the precomputed per-position info (per move, including computing it)
+	RunBenchmark(config, "gives_check", [&]()
+	{
+		uint64_t ops = 0;
+
+		for (size_t i = 0; i < corpus.size(); ++i)
+		{
+			MoveList &ml = legalMoves[i];
+
+			Board::GivesCheckInfo gci = corpus[i].ComputeGivesCheckInfo();
+
+			for (size_t j = 0; j < ml.GetSize(); ++j)
+			{
+				gSink += corpus[i].GivesCheck(ml[j], gci);
+			}
+
+			ops += ml.GetSize();
+		}
+
+		return ops;
+	});
+
+	// the same by applying and undoing each move, for comparison
+	RunBenchmark(config, "gives_check_apply_undo", [&]()
+	{
+		uint64_t ops = 0;
+
+		for (size_t i = 0; i < corpus.size(); ++i)
+		{
+			MoveList &ml = legalMoves[i];
+
+			for (size_t j = 0; j < ml.GetSize(); ++j)
+			{
+				corpus[i].ApplyMove(ml[j]);
+				gSink += corpus[i].InCheck();
+				corpus[i].UndoMove();
+			}
+
+			ops += ml.GetSize();
+		}
+
+		return ops;
+	});
+
+	// slider attack lookups are most of movegen and SEE, so we run them with each supported attacks backend
+	SliderAttacks::Backend defaultBackend = SliderAttacks::GetBackend();
+
+	for (int backend = 0; backend < SliderAttacks::NUM_BACKENDS; ++backend)
+	{
+		if (!SliderAttacks::SetBackend(static_cast<SliderAttacks::Backend>(backend)))
+		{
+			continue;
+		}
+
+		std::string backendName = SliderAttacks::GetBackendName(static_cast<SliderAttacks::Backend>(backend));
+
+		RunBenchmark(config, "generate_legal_moves_all/" + backendName, [&]()
+		{
+			for (auto &board : corpus)
+			{
+				MoveList ml;
+				board.GenerateAllLegalMoves<Board::ALL>(ml);
+				gSink += ml.GetSize();
+			}
+
+			return static_cast<uint64_t>(corpus.size());
+		});
+
+		RunBenchmark(config, "generate_legal_moves_violent/" + backendName, [&]()
+		{
+			for (auto &board : corpus)
+			{
+				MoveList ml;
+				board.GenerateAllLegalMoves<Board::VIOLENT>(ml);
+				gSink += ml.GetSize();
+			}
+
+			return static_cast<uint64_t>(corpus.size());
+		});
+
+		RunBenchmark(config, "see/" + backendName, [&]()
+		{
+			uint64_t ops = 0;
+
+			for (size_t i = 0; i < corpus.size(); ++i)
+			{
+				MoveList &ml = violentMoves[i];
+
+				for (size_t j = 0; j < ml.GetSize(); ++j)
+				{
+					gSink += SEE::StaticExchangeEvaluation(corpus[i], ml[j]);
+				}
+
+				ops += ml.GetSize();
+			}
+
+			return ops;
+		});
+
+		// the same with one batch evaluator per position
+		RunBenchmark(config, "see_batch/" + backendName, [&]()
+		{
+			uint64_t ops = 0;
+
+			for (size_t i = 0; i < corpus.size(); ++i)
+			{
+				MoveList &ml = violentMoves[i];
+				SEE::BatchEvaluator see(corpus[i]);
+
+				for (size_t j = 0; j < ml.GetSize(); ++j)
+				{
+					gSink += see.StaticExchangeEvaluation(ml[j]);
+				}
+
+				ops += ml.GetSize();
+			}
+
+			return ops;
+		});
+
+		// SEE and non-move SEE of every legal move, as the move evaluators use them
+		RunBenchmark(config, "see_all_moves/" + backendName, [&]()
+		{
+			uint64_t ops = 0;
+
+			for (size_t i = 0; i < corpus.size(); ++i)
+			{
+				MoveList &ml = legalMoves[i];
+
+				for (size_t j = 0; j < ml.GetSize(); ++j)
+				{
+					gSink += SEE::StaticExchangeEvaluation(corpus[i], ml[j]);
+					gSink += SEE::NMStaticExchangeEvaluation(corpus[i], ml[j]);
+				}
+
+				ops += ml.GetSize();
+			}
+
+			return ops;
+		});
+
+		RunBenchmark(config, "see_all_moves_batch/" + backendName, [&]()
+		{
+			uint64_t ops = 0;
+			Score see[MAX_LEGAL_MOVES];
+			Score nmSee[MAX_LEGAL_MOVES];
+
+			for (size_t i = 0; i < corpus.size(); ++i)
+			{
+				MoveList &ml = legalMoves[i];
+
+				SEE::BatchEvaluator batchEvaluator(corpus[i]);
+				batchEvaluator.EvaluateMoves(ml, see, nmSee);
+
+				for (size_t j = 0; j < ml.GetSize(); ++j)
+				{
+					gSink += see[j] + nmSee[j];
+				}
+
+				ops += ml.GetSize();
+			}
+
+			return ops;
+		});
+	}
+
+	SliderAttacks::SetBackend(defaultBackend);
+
+	RunBenchmark(config, "convert_board_to_nn", [&]()
+	{
+		std::vector<float> features;
+
+		for (auto &board : corpus)
+		{
+			FeaturesConv::ConvertBoardToNN(board, features);
+			gSink += features.size();
+		}
+
+		return static_cast<uint64_t>(corpus.size());
+	});
+
+	RunBenchmark(config, "convert_moves_to_nn", [&]()
+	{
+		uint64_t ops = 0;
+		NNMatrixRM features;
+
+		for (size_t i = 0; i < corpus.size(); ++i)
+		{
+			if (legalMoves[i].GetSize() == 0)
+			{
+				continue;
+			}
+
+			FeaturesConv::ConvertMovesToNN(corpus[i], convInfos[i], legalMoves[i], features);
+			gSink += features.rows();
+			++ops;
+		}
+
+		return ops;
+	});
+
+	if (FileReadable(config.evalNetFilename))
+	{
+		EigenANN evalNet(config.evalNetFilename);
+
+		RunBenchmark(config, "eval_forward_single", [&]()
+		{
+			float sum = 0.0f;
+
+			for (int64_t i = 0; i < boardFeatures.rows(); ++i)
+			{
+				sum += evalNet.ForwardSingle(boardFeatures.row(i));
+			}
+
+			gSink += static_cast<int64_t>(sum);
+
+			return static_cast<uint64_t>(boardFeatures.rows());
+		});
+
+		// per position, not per call
+		RunBenchmark(config, "eval_forward_multiple_64", [&]()
+		{
+			float sum = 0.0f;
+
+			for (int64_t i = 0; i < boardFeatures.rows(); i += EvalBatchSize)
+			{
+				int64_t rows = std::min(EvalBatchSize, boardFeatures.rows() - i);
+				sum += (*evalNet.ForwardMultiple(boardFeatures.middleRows(i, rows)))(0, 0);
+			}
+
+			gSink += static_cast<int64_t>(sum);
+
+			return static_cast<uint64_t>(boardFeatures.rows());
+		});
+	}
+	else
+	{
+		std::cout << config.evalNetFilename << " not found, skipping eval net benchmarks" << std::endl;
+	}
+
+	if (FileReadable(config.moveEvalNetFilename))
+	{
+		EigenANN moveEvalNet(config.moveEvalNetFilename);
+
+		// one call per position, for all legal moves (like the move evaluator does)
+		RunBenchmark(config, "move_eval_forward_multiple", [&]()
+		{
+			uint64_t ops = 0;
+			float sum = 0.0f;
+
+			for (size_t i = 0; i < corpus.size(); ++i)
+			{
+				if (moveFeatures[i].rows() == 0)
+				{
+					continue;
+				}
+
+				sum += (*moveEvalNet.ForwardMultiple(moveFeatures[i]))(0, 0);
+				++ops;
+			}
+
+			gSink += static_cast<int64_t>(sum);
+
+			return ops;
+		});
+	}
+	else
+	{
+		std::cout << config.moveEvalNetFilename << " not found, skipping move eval net benchmarks" << std::endl;
+	}
+
+	return 0;
+}
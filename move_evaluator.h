@@ -40,6 +40,9 @@ public:
 
 		Score seeScore;
 		Score nmSeeScore;
+
+		// not all evaluators set this
+		bool givesCheck = false;
 	};
 
 	// this struct stores things that may be useful for move ordering
@@ -98,7 +101,7 @@ public:
 
 		for (auto &mi : list)
 		{
-			std::cout << b.MoveToAlg(mi.move) << ": " << mi.nodeAllocation << std::endl;
+			std::cout << b.MoveToAlg(mi.move) << ": " << mi.nodeAllocation << (mi.givesCheck ? " (check)" : "") << std::endl;
 		}
 	}
 
@@ -123,6 +126,9 @@ public:
 	// this is for search to notify the move evaluator what the actual best move turned out to be
 	virtual void NotifyBestMove(Board &/*board*/, SearchInfo &/*si*/, MoveInfoList &/*list*/, Move /*bestMove*/, size_t /*movesSearched*/) {}
 
+	// same as EvaluatorIface::SetCacheSize()
+	virtual size_t SetCacheSize(size_t /*bytes*/) { return 0; }
+
 	// implementations must override this function
 	// implementation can assume that list is already populated with legal moves of the correct type (QS vs non-QS)
 	virtual void EvaluateMoves(Board &board, SearchInfo &si, MoveInfoList &list, MoveList &ml) = 0;
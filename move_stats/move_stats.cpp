@@ -73,10 +73,17 @@ void ProcessStats(const std::string &filename)
 		filters.push_back(&x.second);
 	}
 
+	Board board;
+
 	while (infile && positionsProcessed < 100000)
 	{
 		std::getline(infile, line);
-		Board board(line);
+
+		if (!board.SetFen(line))
+		{
+			break;
+		}
+
 		std::getline(infile, line);
 		Move bestMove = board.ParseMove(line);
 
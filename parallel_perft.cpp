@@ -0,0 +1,278 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "parallel_perft.h"
+
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <omp.h>
+
+#include "move.h"
+#include "omp_scoped_thread_limiter.h"
+#include "util.h"
+
+namespace
+{
+
+// the hash is only used for subtrees at least this deep (shallower ones are cheaper to recompute than to look up)
+const static uint32_t MinHashDepth = 2;
+
+// lock-free table using the XOR trick: each entry stores (key ^ data) and data, so an entry torn by
+// concurrent writes fails the key check instead of returning a wrong count
+class PerftHash
+{
+public:
+	PerftHash(size_t sizeBytes)
+	{
+		size_t numEntries = 1;
+
+		while ((numEntries * 2 * sizeof(Entry)) <= sizeBytes)
+		{
+			numEntries *= 2;
+		}
+
+		m_entries.reset(new Entry[numEntries]);
+		m_mask = numEntries - 1;
+	}
+
+	bool Probe(uint64_t hash, uint32_t depth, uint64_t &count) const
+	{
+		uint64_t key = MakeKey_(hash, depth);
+		const Entry &entry = m_entries[key & m_mask];
+
+		uint64_t data = entry.data.load(std::memory_order_relaxed);
+		uint64_t check = entry.keyXorData.load(std::memory_order_relaxed);
+
+		if ((check ^ data) != key || data == 0)
+		{
+			return false;
+		}
+
+		count = data;
+		return true;
+	}
+
+	void Store(uint64_t hash, uint32_t depth, uint64_t count)
+	{
+		uint64_t key = MakeKey_(hash, depth);
+		Entry &entry = m_entries[key & m_mask];
+
+		entry.keyXorData.store(key ^ count, std::memory_order_relaxed);
+		entry.data.store(count, std::memory_order_relaxed);
+	}
+
+private:
+	struct Entry
+	{
+		Entry() : keyXorData(0), data(0) {}
+
+		std::atomic<uint64_t> keyXorData;
+		std::atomic<uint64_t> data;
+	};
+
+	static uint64_t MakeKey_(uint64_t hash, uint32_t depth)
+	{
+		// positions are the same at different depths, so we mix depth into the key
+		return hash ^ (depth * 0x9E3779B97F4A7C15ULL);
+	}
+
+	std::unique_ptr<Entry[]> m_entries;
+	size_t m_mask;
+};
+
+uint64_t PerftRecursive(Board &b, uint32_t depth, const ParallelPerft::Config &config, PerftHash *hash)
+{
+	if (depth == 0)
+	{
+		return 1;
+	}
+
+	uint64_t count = 0;
+
+	if (hash && depth >= MinHashDepth && hash->Probe(b.GetHash(), depth, count))
+	{
+		return count;
+	}
+
+	MoveList ml;
+	b.GenerateAllLegalMoves<Board::ALL>(ml);
+
+	if (depth == 1 && config.bulkCount)
+	{
+		// moves are legal, so we don't have to make them
+		return ml.GetSize();
+	}
+
+	for (size_t i = 0; i < ml.GetSize(); ++i)
+	{
+		b.ApplyMove(ml[i]);
+		count += PerftRecursive(b, depth - 1, config, hash);
+		b.UndoMove();
+	}
+
+	if (hash && depth >= MinHashDepth)
+	{
+		hash->Store(b.GetHash(), depth, count);
+	}
+
+	return count;
+}
+
+// a subtree to be searched by one thread
+struct Job
+{
+	Move rootMove;
+
+	// 0 if the job is the whole subtree of the root move
+	Move reply;
+
+	uint64_t count;
+};
+
+}
+
+namespace ParallelPerft
+{
+
+uint64_t Run(const Board &b, uint32_t depth, const Config &config)
+{
+	if (depth == 0)
+	{
+		return 1;
+	}
+
+	std::unique_ptr<PerftHash> hash;
+
+	if (config.hashSize > 0)
+	{
+		hash.reset(new PerftHash(config.hashSize));
+	}
+
+	Board root = b;
+
+	MoveList rootMoves;
+	root.GenerateAllLegalMoves<Board::ALL>(rootMoves);
+
+	// we split at the second ply if we can, since root moves can have very different subtree sizes
+	// (and there aren't many of them)
+	std::vector<Job> jobs;
+
+	for (size_t i = 0; i < rootMoves.GetSize(); ++i)
+	{
+		Job job;
+		job.rootMove = rootMoves[i];
+		job.reply = 0;
+		job.count = 0;
+
+		if (depth >= 3)
+		{
+			root.ApplyMove(rootMoves[i]);
+
+			MoveList replies;
+			root.GenerateAllLegalMoves<Board::ALL>(replies);
+
+			for (size_t j = 0; j < replies.GetSize(); ++j)
+			{
+				job.reply = replies[j];
+				jobs.push_back(job);
+			}
+
+			root.UndoMove();
+		}
+		else
+		{
+			jobs.push_back(job);
+		}
+	}
+
+	std::unique_ptr<ScopedThreadLimiter> threadLimiter;
+
+	if (config.numThreads > 0)
+	{
+		threadLimiter.reset(new ScopedThreadLimiter(config.numThreads));
+	}
+
+	int64_t numJobs = static_cast<int64_t>(jobs.size());
+
+	#pragma omp parallel
+	{
+		Board board = root;
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int64_t i = 0; i < numJobs; ++i)
+		{
+			Job &job = jobs[i];
+
+			board.ApplyMove(job.rootMove);
+
+			if (job.reply != 0)
+			{
+				board.ApplyMove(job.reply);
+				job.count = PerftRecursive(board, depth - 2, config, hash.get());
+				board.UndoMove();
+			}
+			else
+			{
+				job.count = PerftRecursive(board, depth - 1, config, hash.get());
+			}
+
+			board.UndoMove();
+		}
+	}
+
+	uint64_t total = 0;
+
+	// root moves without replies (mates and stalemates) don't have jobs when splitting at the second ply, but
+	// contribute nothing to perft at depth >= 3 anyways
+	std::map<std::string, uint64_t> rootMoveCounts;
+
+	for (const auto &job : jobs)
+	{
+		total += job.count;
+
+		if (config.divide)
+		{
+			rootMoveCounts[root.MoveToAlg(job.rootMove)] += job.count;
+		}
+	}
+
+	for (const auto &rootMoveCount : rootMoveCounts)
+	{
+		std::cout << rootMoveCount.first << ": " << rootMoveCount.second << std::endl;
+	}
+
+	return total;
+}
+
+uint64_t DebugRun(const Board &b, uint32_t depth, const Config &config)
+{
+	double startTime = CurrentTime();
+	uint64_t result = Run(b, depth, config);
+	double duration = CurrentTime() - startTime;
+
+	std::cout << result << std::endl;
+	std::cout << "Took: " << duration << " seconds" << std::endl;
+	std::cout << static_cast<uint64_t>(result / duration) << " NPS" << std::endl;
+
+	return result;
+}
+
+}
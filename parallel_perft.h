@@ -0,0 +1,54 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLEL_PERFT_H
+#define PARALLEL_PERFT_H
+
+#include <cstdint>
+
+#include "board.h"
+#include "types.h"
+
+// perft for measuring move generator throughput (and checking correctness) at depths where DebugPerft is too slow
+// the first 2 plies are split into jobs and distributed over OpenMP threads, and subtrees are cached in a
+// shared lock-free hash table keyed by position and remaining depth
+namespace ParallelPerft
+{
+
+struct Config
+{
+	// 0 = use all OpenMP threads
+	int numThreads = 0;
+
+	// 0 disables the hash table
+	size_t hashSize = 64*MB;
+
+	// count legal moves at the last ply, instead of making and unmaking them
+	bool bulkCount = true;
+
+	// print node counts for each root move
+	bool divide = false;
+};
+
+uint64_t Run(const Board &b, uint32_t depth, const Config &config);
+
+// prints result, time, and nodes per second
+uint64_t DebugRun(const Board &b, uint32_t depth, const Config &config);
+
+}
+
+#endif // PARALLEL_PERFT_H
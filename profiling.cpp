@@ -0,0 +1,155 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profiling.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "thread_wrapper.h"
+#include "util.h"
+
+namespace
+{
+
+const char *SectionNames[Profiling::NUM_SECTIONS] =
+{
+	"convert_board_to_nn",
+	"nn_forward",
+	"generate_legal_moves",
+	"see",
+	"move_eval",
+	"gtb_probe"
+};
+
+// cycle counter ticks per second, measured against the wall clock the first time it's needed
+double CyclesPerSecond()
+{
+	static double cyclesPerSecond = []()
+	{
+		double startTime = CurrentTime();
+		uint64_t startCycles = Profiling::ReadCycleCounter();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		double elapsed = CurrentTime() - startTime;
+		uint64_t cycles = Profiling::ReadCycleCounter() - startCycles;
+
+		return (elapsed > 0.0 && cycles > 0) ? (cycles / elapsed) : 1e9;
+	}();
+
+	return cyclesPerSecond;
+}
+
+}
+
+namespace Profiling
+{
+
+std::atomic<uint32_t> gSamplingInterval(0);
+
+ThreadTimers::ThreadTimers()
+{
+	for (size_t i = 0; i < NUM_SECTIONS; ++i)
+	{
+		calls[i].store(0, std::memory_order_relaxed);
+		samples[i].store(0, std::memory_order_relaxed);
+		sampledCycles[i].store(0, std::memory_order_relaxed);
+		countdown[i] = 0;
+	}
+}
+
+void SetSamplingInterval(uint32_t interval)
+{
+	if (interval != 0)
+	{
+		// calibrate now, so we don't stall the first search that prints a breakdown
+		CyclesPerSecond();
+	}
+
+	gSamplingInterval.store(interval, std::memory_order_relaxed);
+}
+
+Snapshot Aggregate()
+{
+	SectionTotals zero = { 0, 0, 0 };
+	Snapshot ret(NUM_SECTIONS, zero);
+
+	Registry::ForEach([&](const ThreadTimers &threadTimers)
+	{
+		for (size_t i = 0; i < NUM_SECTIONS; ++i)
+		{
+			ret[i].calls += threadTimers.calls[i].load(std::memory_order_relaxed);
+			ret[i].samples += threadTimers.samples[i].load(std::memory_order_relaxed);
+			ret[i].sampledCycles += threadTimers.sampledCycles[i].load(std::memory_order_relaxed);
+		}
+	});
+
+	return ret;
+}
+
+void Reset()
+{
+	Registry::ForEach([](ThreadTimers &threadTimers)
+	{
+		for (size_t i = 0; i < NUM_SECTIONS; ++i)
+		{
+			threadTimers.calls[i].store(0, std::memory_order_relaxed);
+			threadTimers.samples[i].store(0, std::memory_order_relaxed);
+			threadTimers.sampledCycles[i].store(0, std::memory_order_relaxed);
+		}
+	});
+}
+
+void PrintBreakdown(const Snapshot &before, const Snapshot &after, double wallTime, const std::string &prefix)
+{
+	std::ios::fmtflags oldFlags = std::cout.flags();
+	std::streamsize oldPrecision = std::cout.precision();
+
+	std::cout << std::fixed;
+
+	for (size_t i = 0; i < NUM_SECTIONS; ++i)
+	{
+		uint64_t calls = after[i].calls - before[i].calls;
+		uint64_t samples = after[i].samples - before[i].samples;
+		uint64_t sampledCycles = after[i].sampledCycles - before[i].sampledCycles;
+
+		if (calls == 0)
+		{
+			continue;
+		}
+
+		double cyclesPerCall = (samples > 0) ? (static_cast<double>(sampledCycles) / samples) : 0.0;
+		double time = cyclesPerCall * calls / CyclesPerSecond();
+
+		std::cout << prefix << " " << SectionNames[i] << ": " << std::setprecision(2) << (time * 1000.0) << "ms";
+
+		if (wallTime > 0.0)
+		{
+			std::cout << " (" << std::setprecision(1) << (100.0 * time / wallTime) << "%)";
+		}
+
+		std::cout << " calls: " << calls << " samples: " << samples
+				  << " cycles/call: " << std::setprecision(0) << cyclesPerCall << std::endl;
+	}
+
+	std::cout.flags(oldFlags);
+	std::cout.precision(oldPrecision);
+}
+
+}
@@ -0,0 +1,170 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#include "thread_registry.h"
+
+// built-in timers for a few hot functions, so we can see where a normal (optimized, not -pg) build
+// spends its time
+// timing is off by default, and costs one relaxed load and a branch per timed call
+// when it's on, every call is counted, but only one in every N calls (per thread and section) is timed,
+// and time for the section is estimated from the average of the sampled calls
+// times are inclusive, and sections nest (eg. MOVE_EVAL includes the SEE and NN_FORWARD calls it makes)
+namespace Profiling
+{
+
+enum Section
+{
+	CONVERT_BOARD_TO_NN,
+	NN_FORWARD,
+	GENERATE_LEGAL_MOVES,
+	SEE,
+	MOVE_EVAL,
+	GTB_PROBE,
+
+	NUM_SECTIONS
+};
+
+// 0 means disabled
+extern std::atomic<uint32_t> gSamplingInterval;
+
+struct ThreadTimers
+{
+	ThreadTimers();
+
+	char paddingBefore[64];
+
+	std::atomic<uint64_t> calls[NUM_SECTIONS];
+	std::atomic<uint64_t> samples[NUM_SECTIONS];
+	std::atomic<uint64_t> sampledCycles[NUM_SECTIONS];
+
+	// only accessed by the owning thread
+	uint32_t countdown[NUM_SECTIONS];
+
+	char paddingAfter[64];
+};
+
+struct SectionTotals
+{
+	uint64_t calls;
+	uint64_t samples;
+	uint64_t sampledCycles;
+};
+
+// indexed by Section
+typedef std::vector<SectionTotals> Snapshot;
+
+typedef ThreadRegistry<ThreadTimers> Registry;
+
+inline ThreadTimers *GetThreadTimers()
+{
+	return Registry::Get();
+}
+
+inline uint64_t ReadCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline void AddRelaxed(std::atomic<uint64_t> &x, uint64_t n)
+{
+	x.store(x.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(Section section)
+		: m_timers(nullptr), m_section(section), m_start(0)
+	{
+		uint32_t interval = gSamplingInterval.load(std::memory_order_relaxed);
+
+		if (interval == 0)
+		{
+			return;
+		}
+
+		ThreadTimers *timers = GetThreadTimers();
+
+		AddRelaxed(timers->calls[section], 1);
+
+		if (timers->countdown[section] == 0)
+		{
+			timers->countdown[section] = interval - 1;
+			m_timers = timers;
+			m_start = ReadCycleCounter();
+		}
+		else
+		{
+			--timers->countdown[section];
+		}
+	}
+
+	~ScopedTimer()
+	{
+		if (m_timers)
+		{
+			uint64_t cycles = ReadCycleCounter() - m_start;
+			AddRelaxed(m_timers->samples[m_section], 1);
+			AddRelaxed(m_timers->sampledCycles[m_section], cycles);
+		}
+	}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer &operator=(const ScopedTimer&) = delete;
+
+private:
+	ThreadTimers *m_timers; // only set if this call is sampled
+	Section m_section;
+	uint64_t m_start;
+};
+
+// 0 disables timing, 1 times every call
+void SetSamplingInterval(uint32_t interval);
+
+inline bool IsEnabled() { return gSamplingInterval.load(std::memory_order_relaxed) != 0; }
+
+Snapshot Aggregate();
+
+void Reset();
+
+// estimated time spent in each section between the 2 snapshots (summed over all threads), as
+// "<prefix> name: ..." lines
+// if wallTime is not 0, times are also shown as a percentage of it
+void PrintBreakdown(const Snapshot &before, const Snapshot &after, double wallTime, const std::string &prefix);
+
+}
+
+#endif // PROFILING_H
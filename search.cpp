@@ -17,6 +17,7 @@
 
 #include "search.h"
 
+#include <algorithm>
 #include <utility>
 #include <memory>
 #include <atomic>
@@ -25,26 +26,90 @@
 #include <cstdint>
 
 #include "ann/ann_evaluator.h"
+#include "counters.h"
+#include "profiling.h"
 #include "history.h"
 #include "types.h"
 #include "util.h"
 #include "eval/eval.h"
 #include "see.h"
 #include "gtb.h"
+#include "time_manager.h"
 
 namespace
 {
-	// estimated minimum branching factor for time allocation
-	// if more than 1/x of the allocated time has been used at the end of an iteration,
-	// a new iteration won't be started
-	const static double ESTIMATED_MIN_BRANCHING_FACTOR = 1.0;
-
 	// how much to increase node budget by in each iteration of ID
 	const static float NodeBudgetMultiplier = 4.0f;
 
 	// with node count based search we can potentially go very deep, so we
 	// have to call it a day at some point to avoid stack overflow
 	const static Search::Depth MaxRecursionDepth = 64;
+
+	// how many moves deep a search can go below the root (including quiescence search and SEE), used to reserve
+	// undo stack space so the board never reallocates during a search
+	const static size_t MaxSearchMoves = 8 * MaxRecursionDepth;
+
+	// how often (in nodes) to check the deadline in synchronous searches
+	const static uint64_t DeadlineCheckInterval = 1024;
+
+	inline void CheckDeadline(Search::RootSearchContext &context, uint64_t nodeCount)
+	{
+		if (context.deadline != 0.0 && (nodeCount % DeadlineCheckInterval) == 0 && CurrentTime() > context.deadline)
+		{
+			context.stopRequest = true;
+		}
+	}
+
+	inline TTEntry *ProbeTT(Search::RootSearchContext &context, const Board &board)
+	{
+		if (!Search::ENABLE_TT)
+		{
+			return nullptr;
+		}
+
+		Counters::Inc(Counters::TT_PROBES);
+
+		TTEntry *tEntry = context.transpositionTable->Probe(board.GetHash());
+
+		if (tEntry)
+		{
+			Counters::Inc(Counters::TT_HITS);
+		}
+
+		return tEntry;
+	}
+
+	// prefetch the TT and eval hash entries the position after mv will probe, so they are (hopefully) in cache
+	// by the time we get to that move
+	inline void PrefetchChild(Search::RootSearchContext &context, const Board &board, Move mv)
+	{
+		uint64_t hash = board.SpeculateHashAfterMove(mv);
+
+		if (Search::ENABLE_TT)
+		{
+			context.transpositionTable->Prefetch(hash);
+		}
+
+		context.evaluator->Prefetch(hash);
+	}
+
+	inline Score TTCutoff(const TTEntry *tEntry)
+	{
+		switch (tEntry->entryType)
+		{
+		case EXACT:
+			Counters::Inc(Counters::TT_CUTOFFS_EXACT);
+			break;
+		case LOWERBOUND:
+			Counters::Inc(Counters::TT_CUTOFFS_LOWER);
+			break;
+		default:
+			Counters::Inc(Counters::TT_CUTOFFS_UPPER);
+			break;
+		}
+
+		return tEntry->score;
+	}
 }
 
 namespace Search
@@ -53,39 +118,104 @@ namespace Search
 // it needs to be very high because node budget != node count (it also includes node counts for prunned nodes)
 static const NodeBudget ID_MAX_NODE_BUDGET = std::numeric_limits<NodeBudget>::max() / 1000.0f;
 
-AsyncSearch::AsyncSearch(RootSearchContext &context)
-	: m_context(context)
+AsyncSearch::AsyncSearch(RootSearchContext &context, ThreadPool &threadPool, DeadlineTimer &timer)
+	: m_context(context), m_threadPool(threadPool), m_timer(timer), m_done(true),
+	  m_startTime(0.0), m_endTime(0.0), m_timerId(0), m_finishing(false)
 {
 }
 
 void AsyncSearch::Start()
 {
-	std::thread searchThread(&AsyncSearch::RootSearch_, this);
+	m_done = false;
+
+	m_threadPool.Push([this]()
+	{
+		RootSearch_();
 
-	m_thread = std::move(searchThread);
+		std::lock_guard<std::mutex> lock(m_doneMutex);
+		m_done = true;
+		m_cvDone.notify_all();
+	});
+}
+
+void AsyncSearch::Join()
+{
+	std::unique_lock<std::mutex> lock(m_doneMutex);
+
+	while (!m_done)
+	{
+		m_cvDone.wait(lock);
+	}
+}
+
+bool AsyncSearch::PonderHit(const TimeAllocation &timeAlloc)
+{
+	std::lock_guard<std::mutex> lock(m_timingMutex);
+
+	if (m_finishing || m_context.searchType != SearchType_infinite)
+	{
+		return false;
+	}
+
+	m_context.timeAlloc = timeAlloc;
+
+	if (m_startTime == 0.0)
+	{
+		// the search hasn't started running yet, so it will simply start as a timed search
+		m_context.searchType = SearchType_makeMove;
+		return true;
+	}
+
+	// we have been thinking since m_startTime, so that's where the allocation starts
+	// if we have already used it all, the deadline fires right away, and we move with what we have
+	// otherwise the time manager decides when to stop at the end of the next iteration
+	m_endTime = m_startTime + timeAlloc.maxTime;
+
+	m_timerId = m_timer.Schedule(m_endTime, [this]() { m_context.stopRequest = true; });
+
+	m_context.searchType = SearchType_makeMove;
+
+	return true;
 }
 
 void AsyncSearch::RootSearch_()
 {
-	double startTime = CurrentTime();
+	double startTime;
 
-	// this is the time we want to stop searching
-	double normaleEndTime = startTime + m_context.timeAlloc.normalTime;
+	{
+		std::lock_guard<std::mutex> lock(m_timingMutex);
 
-	// this is the time we HAVE to stop searching
-	// only the ID controller can make the decision to switch to this end time
-	//double absoluteEndTime = startTime + m_context.timeAlloc.maxTime;
+		startTime = CurrentTime();
+		m_startTime = startTime;
 
-	double endTime = normaleEndTime;
+		// this is the time we HAVE to stop searching, even in the middle of an iteration
+		// the time manager decides whether to start each iteration, and will usually stop us well before this
+		m_endTime = startTime + m_context.timeAlloc.maxTime;
 
-	SearchResult latestResult;
+		if (m_context.searchType != SearchType_infinite)
+		{
+			m_timerId = m_timer.Schedule(m_endTime, [this]() { m_context.stopRequest = true; });
+		}
+
+		if (m_context.thinkingOutputFunc)
+		{
+			TimeManager::LogSearchStart(m_context.timeAlloc);
+		}
+	}
+
+	TimeManager timeManager;
+
+	// for the time breakdown at the end (this includes other threads, if there are other searches running)
+	bool profiling = Profiling::IsEnabled();
+	Profiling::Snapshot profileStart;
 
-	if (m_context.searchType != SearchType_infinite)
+	if (profiling)
 	{
-		std::thread searchTimerThread(&AsyncSearch::SearchTimer_, this, endTime - CurrentTime());
-		m_searchTimerThread = std::move(searchTimerThread);
+		profileStart = Profiling::Aggregate();
 	}
 
+	SearchResult latestResult;
+
 	if (m_context.nodeBudget == 0 || m_context.nodeBudget > ID_MAX_NODE_BUDGET)
 	{
 		m_context.nodeBudget = ID_MAX_NODE_BUDGET;
@@ -97,13 +227,27 @@ void AsyncSearch::RootSearch_()
 
 	int32_t iteration = 0;
 
+	m_context.startBoard.ReserveUndo(MaxSearchMoves);
+
 	MoveList ml;
 	m_context.startBoard.GenerateAllLegalMoves<Board::ALL>(ml);
 
+	// this is only used in multi-PV mode, and is kept sorted by score from the last iteration
+	std::vector<RootMove> rootMoves;
+
+	for (size_t i = 0; i < ml.GetSize(); ++i)
+	{
+		RootMove rm;
+		rm.move = ml[i];
+		rm.score = 0;
+		rm.exact = false;
+		rootMoves.push_back(rm);
+	}
+
+	bool multiPV = m_context.multiPV > 1 && !rootMoves.empty();
+
 	for (NodeBudget nodeBudget = 1;
-			(nodeBudget <= m_context.nodeBudget) &&
-			((CurrentTime() < endTime) || (m_context.searchType == SearchType_infinite) || !m_context.onePlyDone) &&
-			(!m_context.Stopping());
+			(nodeBudget <= m_context.nodeBudget) && (!m_context.Stopping());
 		 nodeBudget *= NodeBudgetMultiplier)
 	{
 		++iteration;
@@ -119,7 +263,13 @@ void AsyncSearch::RootSearch_()
 		bool highBoundOpen = false;
 		bool lowBoundOpen = false;
 
-		while (!m_context.Stopping())
+		if (multiPV && MultiPVIteration_(nodeBudget, rootMoves))
+		{
+			latestResult.score = rootMoves[0].score;
+			latestResult.pv = rootMoves[0].pv;
+		}
+
+		while (!multiPV && !m_context.Stopping())
 		{
 			latestResult.score = Search(
 				m_context,
@@ -160,80 +310,247 @@ void AsyncSearch::RootSearch_()
 		if (!m_context.Stopping())
 		{
 			m_rootResult = latestResult;
+			m_rootResult.nodeCount = m_context.nodeCount;
+
+			TimeManager::Iteration timeManagerIteration;
+			timeManagerIteration.nodeBudget = nodeBudget;
+			timeManagerIteration.nodeCount = m_context.nodeCount;
+			timeManagerIteration.time = CurrentTime() - startTime;
+			timeManagerIteration.bestMove = latestResult.pv.empty() ? 0 : latestResult.pv[0];
+			timeManagerIteration.score = latestResult.score;
+
+			timeManager.IterationDone(timeManagerIteration);
 
 			ThinkingOutput thinkingOutput;
 			thinkingOutput.nodeCount = m_context.nodeCount;
 			thinkingOutput.ply = iteration;
+			thinkingOutput.time = CurrentTime() - startTime;
 
-			// build the text pv
-			Board b = m_context.startBoard;
-			for (auto const &mv : latestResult.pv)
+			auto outputLine = [&](Score score, const std::vector<Move> &pv)
 			{
-				thinkingOutput.pv += b.MoveToAlg(mv, Board::SAN) + ' ';
-				b.ApplyMove(mv);
-			}
+				// build the text pv
+				thinkingOutput.pv.clear();
 
-			thinkingOutput.score = latestResult.score;
-			thinkingOutput.time = CurrentTime() - startTime;
+				Board b = m_context.startBoard;
+				for (auto const &mv : pv)
+				{
+					thinkingOutput.pv += b.MoveToAlg(mv, Board::SAN) + ' ';
+					b.ApplyMove(mv);
+				}
+
+				thinkingOutput.score = score;
+
+				m_context.thinkingOutputFunc(thinkingOutput);
+			};
 
 			if (m_context.thinkingOutputFunc)
 			{
-				m_context.thinkingOutputFunc(thinkingOutput);
+				if (multiPV)
+				{
+					// best line first
+					size_t numPVs = std::min(m_context.multiPV, rootMoves.size());
+
+					for (size_t i = 0; i < numPVs; ++i)
+					{
+						outputLine(rootMoves[i].score, rootMoves[i].pv);
+					}
+				}
+				else
+				{
+					outputLine(latestResult.score, latestResult.pv);
+				}
 
 				std::cout << "# d: " << iteration <<
 							 " node budget: " << nodeBudget <<
 							 " NPS: " << (static_cast<float>(m_context.nodeCount) / thinkingOutput.time) << std::endl;
+
+				TimeManager::LogIteration(timeManagerIteration);
 			}
 		}
 
 		m_context.onePlyDone = true;
 
-		double elapsedTime = CurrentTime() - startTime;
-		double totalAllocatedTime = endTime - startTime;
-		double estimatedNextIterationTime = elapsedTime * ESTIMATED_MIN_BRANCHING_FACTOR;
-
-		if (estimatedNextIterationTime > (totalAllocatedTime - elapsedTime) && m_context.searchType != SearchType_infinite)
+		if (m_context.searchType != SearchType_infinite)
 		{
-			break;
+			TimeAllocation timeAlloc;
+
+			{
+				// PonderHit can change this
+				std::lock_guard<std::mutex> lock(m_timingMutex);
+				timeAlloc = m_context.timeAlloc;
+			}
+
+			if (!timeManager.ShouldStartIteration(timeAlloc, CurrentTime() - startTime, nodeBudget * NodeBudgetMultiplier))
+			{
+				break;
+			}
 		}
 	}
 
-	Abort(); // interrupt timing thread
+	SearchType finalSearchType;
+	DeadlineTimer::TimerId timerId;
+
+	{
+		// after this, PonderHit can't change anything
+		std::lock_guard<std::mutex> lock(m_timingMutex);
+		m_finishing = true;
+		finalSearchType = m_context.searchType;
+		timerId = m_timerId;
+	}
 
-	if (m_searchTimerThread.joinable())
+	if (timerId != 0)
 	{
-		// this thread is only started if we are in time limited search
-		m_searchTimerThread.join();
+		// the deadline references m_context, so it must not fire after we are done
+		m_timer.Cancel(timerId);
 	}
 
-	if (m_context.searchType == SearchType_makeMove && m_context.finalMoveFunc)
+	if (profiling && Profiling::IsEnabled() && m_context.thinkingOutputFunc)
+	{
+		double searchTime = CurrentTime() - startTime;
+		std::cout << "# profile: search took " << (searchTime * 1000.0) << "ms" << std::endl;
+		Profiling::PrintBreakdown(profileStart, Profiling::Aggregate(), searchTime, "# profile:");
+	}
+
+	if (finalSearchType == SearchType_makeMove && m_context.finalMoveFunc)
 	{
 		std::string bestMove = m_context.startBoard.MoveToAlg(m_rootResult.pv[0]);
 		m_context.finalMoveFunc(bestMove);
 	}
 }
 
-void AsyncSearch::SearchTimer_(double time)
+bool AsyncSearch::MultiPVIteration_(NodeBudget nodeBudget, std::vector<RootMove> &rootMoves)
 {
-	// we have to do all this math because of GCC (libstdc++) bug #58038: http://gcc.gnu.org/bugzilla/show_bug.cgi?id=58038
-	double endTime = CurrentTime() + time;
+	Board &board = m_context.startBoard;
+
+	// we still let the move evaluator decide how many nodes each move gets, like in a normal search
+	MoveEvaluatorIface::MoveInfoList miList;
+	MoveEvaluatorIface::SearchInfo si;
+
+	si.hashMove = rootMoves[0].move;
+	si.killer = m_context.killer;
+	si.history = m_context.history;
+	si.isQS = false;
+	si.ply = 0;
+	si.tt = m_context.transpositionTable;
+	si.totalNodeBudget = nodeBudget;
+	si.lowerBound = SCORE_MIN;
+	si.upperBound = SCORE_MAX;
+
+	m_context.moveEvaluator->GenerateAndEvaluateMoves(board, si, miList);
+
+	float maxNodeAllocation = 0.0f;
+
+	for (size_t i = 0; i < miList.GetSize(); ++i)
+	{
+		maxNodeAllocation = std::max(maxNodeAllocation, miList[i].nodeAllocation);
+	}
+
+	auto getNodeAllocation = [&](Move mv) -> float
+	{
+		for (size_t i = 0; i < miList.GetSize(); ++i)
+		{
+			if (miList[i].move == mv)
+			{
+				return miList[i].nodeAllocation;
+			}
+		}
+
+		return 0.0f;
+	};
+
+	auto getChildNodeBudget = [&](float nodeAllocation) -> NodeBudget
+	{
+		NodeBudget childNodeBudget = nodeBudget * nodeAllocation;
+
+		// don't go into QS directly if in check (meaning the move we are searching is a checking move)
+		if (board.InCheck())
+		{
+			childNodeBudget = std::max<NodeBudget>(childNodeBudget, 1);
+		}
+
+		return childNodeBudget;
+	};
+
+	size_t numPVs = std::min(m_context.multiPV, rootMoves.size());
 
-	std::unique_lock<std::mutex> lock(m_abortingMutex);
+	// exact scores of the best numPVs moves found so far, in ascending order
+	std::vector<Score> bestScores;
 
-	while (!m_context.stopRequest && CurrentTime() < endTime)
+	std::vector<Move> subPv;
+
+	for (size_t i = 0; i < rootMoves.size(); ++i)
 	{
-		// all this work for an interruptible sleep...
-		// don't use wait_until here, because of the libstdc++ bug
-		// we have to make sure wait time is positive
-		double timeTillEnd = endTime - CurrentTime();
+		RootMove &rm = rootMoves[i];
+
+		board.ApplyMove(rm.move);
+
+		Score score = 0;
+
+		// lines we report are all searched as if they were the best move, so they have comparable depth
+		if (i < numPVs)
+		{
+			score = -Search(m_context, subPv, board, SCORE_MIN, SCORE_MAX, getChildNodeBudget(maxNodeAllocation), 1);
+			rm.exact = true;
+		}
+		else
+		{
+			// we only need to know whether this move is better than the worst line we have
+			Score worstBestScore = bestScores[0];
+
+			score = -Search(m_context, subPv, board, -worstBestScore - 1, -worstBestScore, getChildNodeBudget(getNodeAllocation(rm.move)), 1);
+
+			rm.exact = false;
+
+			if (score > worstBestScore && !m_context.Stopping())
+			{
+				score = -Search(m_context, subPv, board, SCORE_MIN, SCORE_MAX, getChildNodeBudget(maxNodeAllocation), 1);
+				rm.exact = true;
+			}
+		}
+
+		board.UndoMove();
+
+		if (m_context.Stopping())
+		{
+			return false;
+		}
+
+		AdjustIfMateScore(score);
 
-		if (timeTillEnd > 0.0)
+		rm.score = score;
+		rm.pv.clear();
+		rm.pv.push_back(rm.move);
+		rm.pv.insert(rm.pv.end(), subPv.begin(), subPv.end());
+
+		if (rm.exact)
+		{
+			bestScores.insert(std::upper_bound(bestScores.begin(), bestScores.end(), score), score);
+
+			if (bestScores.size() > numPVs)
+			{
+				bestScores.erase(bestScores.begin());
+			}
+		}
+	}
+
+	// moves with exact scores first, since the others only have upper bounds
+	// among the others, we keep the order from the last iteration
+	std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove &a, const RootMove &b)
+	{
+		if (a.exact != b.exact)
 		{
-			m_cvAborting.wait_for(lock, std::chrono::microseconds(static_cast<uint64_t>(timeTillEnd * 1000000)));
+			return a.exact;
 		}
+
+		return a.exact && a.score > b.score;
+	});
+
+	if (ENABLE_TT)
+	{
+		m_context.transpositionTable->Store(board, rootMoves[0].move, rootMoves[0].score, nodeBudget, EXACT);
 	}
 
-	m_context.stopRequest = true;
+	return true;
 }
 
 Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Score alpha, Score beta, NodeBudget nodeBudget, int32_t ply, bool nullMoveAllowed)
@@ -246,7 +563,7 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 	// using < 1 guarantees that a root search with nodeBudget 1 will always do a full ply
 	if (nodeBudget < 1 || ply > MaxRecursionDepth)
 	{
-		TTEntry *tEntry = ENABLE_TT ? context.transpositionTable->Probe(board.GetHash()) : 0;
+		TTEntry *tEntry = ProbeTT(context, board);
 
 		if (tEntry)
 		{
@@ -257,15 +574,15 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 				if (tEntry->entryType == EXACT)
 				{
 					// if we have an exact score, we can always return it
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 				else if (tEntry->entryType == UPPERBOUND && tEntry->score <= alpha)
 				{
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 				else if (tEntry->entryType == LOWERBOUND &&tEntry->score >= beta)
 				{
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 			}
 		}
@@ -292,7 +609,8 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 		return ret;
 	}
 
-	++context.nodeCount;
+	CheckDeadline(context, ++context.nodeCount);
+	Counters::Inc(Counters::NODES);
 
 	if (context.Stopping())
 	{
@@ -311,11 +629,22 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 	}
 
 	// now we check for soft draws (only if ply > 0)
-	if (ply > 0 && (board.Is2Fold(NUM_MOVES_TO_LOOK_FOR_DRAW) || board.Is50Moves()))
+	if (ply > 0 && (board.Is2Fold() || board.Is50Moves()))
 	{
 		return DRAW_SCORE;
 	}
 
+	// if we can repeat a position, we can get at least a draw
+	if (ply > 0 && alpha < DRAW_SCORE && board.HasUpcomingRepetition())
+	{
+		alpha = DRAW_SCORE;
+
+		if (alpha >= beta)
+		{
+			return alpha;
+		}
+	}
+
 	NodeBudget originalNodeBudget = nodeBudget;
 
 	nodeBudget *= 0.9999f;
@@ -333,7 +662,7 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 		}
 	}
 
-	TTEntry *tEntry = ENABLE_TT ? context.transpositionTable->Probe(board.GetHash()) : 0;
+	TTEntry *tEntry = ProbeTT(context, board);
 
 	if (tEntry)
 	{
@@ -343,14 +672,14 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 			if (tEntry->entryType == EXACT)
 			{
 				// if we have an exact score, we can always return it
-				return tEntry->score;
+				return TTCutoff(tEntry);
 			}
 			else if (tEntry->entryType == UPPERBOUND)
 			{
 				// if we have an upper bound, we can only return if this score fails low (no best move)
 				if (tEntry->score <= alpha)
 				{
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 			}
 			else if (tEntry->entryType == LOWERBOUND)
@@ -358,7 +687,7 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 				// if we have an upper bound, we can only return if this score fails high
 				if (tEntry->score >= beta)
 				{
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 			}
 		}
@@ -373,6 +702,8 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 		nullMoveAllowed &&
 		context.evaluator->EvaluateForSTM(board, alpha, beta) >= beta /* This is expensive, so test it last!*/)
 	{
+		Counters::Inc(Counters::NULL_MOVE_TRIES);
+
 		board.MakeNullMove();
 
 		std::vector<Move> pvNN;
@@ -385,6 +716,8 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 
 		if (nmScore >= beta)
 		{
+			Counters::Inc(Counters::NULL_MOVE_CUTOFFS);
+
 			if (ENABLE_TT)
 			{
 				context.transpositionTable->Store(board, 0, nmScore, originalNodeBudget, LOWERBOUND);
@@ -443,6 +776,11 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 	// we keep track of bestScore separately to fail soft on alpha
 	Score bestScore = std::numeric_limits<Score>::min();
 
+	for (size_t moveNum = 0; moveNum < std::min(miList.GetSize(), ChildPrefetchDistance); ++moveNum)
+	{
+		PrefetchChild(context, board, miList[moveNum].move);
+	}
+
 	for (size_t moveNum = 0; moveNum < miList.GetSize(); ++moveNum)
 	{
 		auto &mi = miList[moveNum];
@@ -454,6 +792,12 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 			continue;
 		}
 
+		// prefetch for a later move while this one is being searched
+		if ((moveNum + ChildPrefetchDistance) < miList.GetSize())
+		{
+			PrefetchChild(context, board, miList[moveNum + ChildPrefetchDistance].move);
+		}
+
 		board.ApplyMove(mv);
 
 		NodeBudget childNodeBudget = nodeBudget * mi.nodeAllocation;
@@ -476,6 +820,7 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 			{
 				// if the move didn't actually fail low, this is now the PV, and we have to search with
 				// full window
+				Counters::Inc(Counters::PVS_RESEARCHES);
 				score = -Search(context, subPv, board, -beta, -alpha, childNodeBudget, ply + 1);
 			}
 		}
@@ -508,6 +853,8 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 
 		if (score >= beta)
 		{
+			Counters::IncFailHigh(moveNum);
+
 			if (ENABLE_TT)
 			{
 				context.transpositionTable->Store(board, mv, score, originalNodeBudget, LOWERBOUND);
@@ -567,7 +914,8 @@ Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Sc
 
 Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, Score alpha, Score beta, int32_t ply, int32_t qsPly)
 {
-	++context.nodeCount;
+	CheckDeadline(context, ++context.nodeCount);
+	Counters::Inc(Counters::QS_NODES);
 
 	pv.clear();
 
@@ -608,7 +956,7 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 
 	bool isPV = (beta - alpha) != 1;
 
-	TTEntry *tEntry = ENABLE_TT ? context.transpositionTable->Probe(board.GetHash()) : 0;
+	TTEntry *tEntry = ProbeTT(context, board);
 
 	if (tEntry)
 	{
@@ -619,14 +967,14 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 			if (tEntry->entryType == EXACT)
 			{
 				// if we have an exact score, we can always return it
-				return tEntry->score;
+				return TTCutoff(tEntry);
 			}
 			else if (tEntry->entryType == UPPERBOUND)
 			{
 				// if we have an upper bound, we can only return if this score fails low (no best move)
 				if (tEntry->score <= alpha)
 				{
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 			}
 			else if (tEntry->entryType == LOWERBOUND)
@@ -634,7 +982,7 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 				// if we have an upper bound, we can only return if this score fails high
 				if (tEntry->score >= beta)
 				{
-					return tEntry->score;
+					return TTCutoff(tEntry);
 				}
 			}
 		}
@@ -672,8 +1020,15 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 
 	std::vector<Move> subPv;
 
-	for (auto &mi : miList)
+	for (size_t moveNum = 0; moveNum < std::min(miList.GetSize(), ChildPrefetchDistance); ++moveNum)
 	{
+		PrefetchChild(context, board, miList[moveNum].move);
+	}
+
+	for (size_t moveNum = 0; moveNum < miList.GetSize(); ++moveNum)
+	{
+		auto &mi = miList[moveNum];
+
 		if (mi.nodeAllocation == 0.0f)
 		{
 			continue;
@@ -681,6 +1036,11 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 
 		Move mv = mi.move;
 
+		if ((moveNum + ChildPrefetchDistance) < miList.GetSize())
+		{
+			PrefetchChild(context, board, miList[moveNum + ChildPrefetchDistance].move);
+		}
+
 		board.ApplyMove(mv);
 
 		Score score = 0;
@@ -712,11 +1072,17 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 }
 
 SearchResult SyncSearchNodeLimited(const Board &b, NodeBudget nodeBudget, EvaluatorIface *evaluator, MoveEvaluatorIface *moveEvaluator, Killer *killer, TTable *ttable, History *history)
+{
+	return SyncSearchTimeLimited(b, 0.0, nodeBudget, evaluator, moveEvaluator, killer, ttable, history);
+}
+
+SearchResult SyncSearchTimeLimited(const Board &b, double maxTime, NodeBudget nodeBudget, EvaluatorIface *evaluator, MoveEvaluatorIface *moveEvaluator, Killer *killer, TTable *ttable, History *history)
 {
 	SearchResult ret;
 	RootSearchContext context;
 
 	context.startBoard = b;
+	context.startBoard.ReserveUndo(MaxSearchMoves);
 
 	std::unique_ptr<Killer> killer_u;
 	std::unique_ptr<TTable> ttable_u;
@@ -734,7 +1100,7 @@ SearchResult SyncSearchNodeLimited(const Board &b, NodeBudget nodeBudget, Evalua
 
 	if (ttable == nullptr)
 	{
-		ttable_u.reset(new TTable(4*KB));
+		ttable_u.reset(new TTable(4*KB, false));
 		context.transpositionTable = ttable_u.get();
 	}
 	else
@@ -760,14 +1126,42 @@ SearchResult SyncSearchNodeLimited(const Board &b, NodeBudget nodeBudget, Evalua
 
 	context.stopRequest = false;
 	context.onePlyDone = false;
+	context.nodeCount = 0;
+
+	double startTime = CurrentTime();
+
+	if (maxTime > 0.0)
+	{
+		context.deadline = startTime + maxTime;
+	}
 
 	NodeBudget currentNodeBudget = 1;
 
+	SearchResult iterationResult;
+
 	while (currentNodeBudget <= nodeBudget)
 	{
-		ret.score = Search(context, ret.pv, context.startBoard, SCORE_MIN, SCORE_MAX, currentNodeBudget, 0);
+		iterationResult.score = Search(context, iterationResult.pv, context.startBoard, SCORE_MIN, SCORE_MAX, currentNodeBudget, 0);
 
-		if (currentNodeBudget == nodeBudget)
+		if (context.Stopping())
+		{
+			// out of time in the middle of an iteration - keep the last completed result
+			break;
+		}
+
+		ret.score = iterationResult.score;
+		ret.pv = iterationResult.pv;
+
+		SearchResult::Iteration iteration;
+		iteration.nodeBudget = currentNodeBudget;
+		iteration.bestMove = ret.pv.empty() ? 0 : ret.pv[0];
+		iteration.nodeCount = context.nodeCount;
+		iteration.time = CurrentTime() - startTime;
+		ret.iterations.push_back(iteration);
+
+		context.onePlyDone = true;
+
+		if (currentNodeBudget == nodeBudget || context.stopRequest)
 		{
 			break;
 		}
@@ -775,6 +1169,8 @@ SearchResult SyncSearchNodeLimited(const Board &b, NodeBudget nodeBudget, Evalua
 		currentNodeBudget = std::min<NodeBudget>(currentNodeBudget * NodeBudgetMultiplier, nodeBudget);
 	}
 
+	ret.nodeCount = context.nodeCount;
+
 	return ret;
 }
 
@@ -18,11 +18,9 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
-#include "thread_wrapper.h"
 #include "mutex_wrapper.h"
 #include <atomic>
 #include <memory>
-#include <future>
 #include <functional>
 #include "condition_variable_wrapper.h"
 
@@ -36,6 +34,8 @@
 #include "killer.h"
 #include "evaluator.h"
 #include "move_evaluator.h"
+#include "thread_pool.h"
+#include "deadline_timer.h"
 
 namespace Search
 {
@@ -55,6 +55,9 @@ static const float NullMoveNodeBudgetMultiplier = 0.0003f;
 
 static const bool ENABLE_TT = true;
 
+// how many moves ahead to prefetch TT and eval hash entries of children (0 disables prefetching)
+static const size_t ChildPrefetchDistance = 2;
+
 static const bool ENABLE_PVS = true;
 static const NodeBudget MinNodeBudgetForPVS = 16;
 
@@ -72,7 +75,6 @@ static const Score ASPIRATION_WINDOW_HALF_SIZE_THRESHOLD = 1600;
 static const Score ASPIRATION_WINDOW_WIDEN_MULTIPLIER = 4; // how much to widen the window every time we fail high/low
 
 static const Score DRAW_SCORE = 0;
-static const size_t NUM_MOVES_TO_LOOK_FOR_DRAW = 16; // how many moves past to look for draws (we are only looking for 2-fold)
 
 struct ThinkingOutput
 {
@@ -85,8 +87,8 @@ struct ThinkingOutput
 
 struct TimeAllocation
 {
-	double normalTime; // time allocated for this move if nothing special happens
-	double maxTime; // absolute maximum time for this move
+	double normalTime = 0.0; // time allocated for this move if nothing special happens
+	double maxTime = 0.0; // absolute maximum time for this move
 };
 
 struct SearchResult
@@ -94,6 +96,19 @@ struct SearchResult
 	Score score;
 
 	std::vector<Move> pv;
+
+	uint64_t nodeCount;
+
+	struct Iteration
+	{
+		NodeBudget nodeBudget;
+		Move bestMove;
+		uint64_t nodeCount; // since search start
+		double time; // since search start
+	};
+
+	// completed iterations (only filled in by synchronous searches)
+	std::vector<Iteration> iterations;
 };
 
 enum SearchType
@@ -116,7 +131,8 @@ struct RootSearchContext
 
 	std::atomic<uint64_t> nodeCount;
 
-	SearchType searchType;
+	// this can change from infinite to makeMove while the search is running (ponder hit)
+	std::atomic<SearchType> searchType;
 
 	NodeBudget nodeBudget;
 
@@ -130,40 +146,78 @@ struct RootSearchContext
 	std::function<void (std::string &mv)> finalMoveFunc;
 	std::function<void (ThinkingOutput &to)> thinkingOutputFunc;
 
+	// if non-zero, the search polls the clock and sets stopRequest once this time has passed
+	// (used by synchronous searches, which don't have a timer thread)
+	double deadline = 0.0;
+
+	// number of best moves to find scores and PVs for (each is reported in thinking output)
+	// only supported by AsyncSearch
+	size_t multiPV = 1;
+
 	bool Stopping() { return onePlyDone && stopRequest; }
 };
 
+// a root search that runs on a (long-lived) worker thread from a pool
+// time limits are enforced by scheduling a deadline on a shared timer
 class AsyncSearch
 {
 public:
-	AsyncSearch(RootSearchContext &context);
+	AsyncSearch(RootSearchContext &context, ThreadPool &threadPool, DeadlineTimer &timer);
 
 	void Start();
 
 	// request an abort (must wait for search to be done)
-	void Abort()
-	{ std::lock_guard<std::mutex> lock(m_abortingMutex); m_context.stopRequest = true; m_cvAborting.notify_all(); }
+	void Abort() { m_context.stopRequest = true; }
 
-	void Join() { if (m_thread.joinable()) { m_thread.join(); } }
+	// wait for the search to finish (returns immediately if it was never started)
+	void Join();
+
+	// convert a running infinite (ponder) search into a timed search that makes a move at the end
+	// time already spent searching counts towards the allocation
+	// returns false if the search has already finished, in which case nothing is changed
+	bool PonderHit(const TimeAllocation &timeAlloc);
 
 	// result is only defined once search is done
 	SearchResult GetResult() { return m_rootResult; }
 
 private:
+	struct RootMove
+	{
+		Move move;
+
+		// this is only an upper bound if !exact
+		Score score;
+		bool exact;
+
+		std::vector<Move> pv;
+	};
+
 	void RootSearch_();
 
-	// entry point for a thread that automatically interrupts the search after the specified time
-	void SearchTimer_(double time);
+	// one iteration of multi-PV search
+	// the best m_context.multiPV moves are searched with full window, and all other moves with
+	// null window against the worst of them, so we only get exact scores for moves that make it in
+	// on return, rootMoves is sorted with the best lines first
+	// returns false if the search is stopped (in which case rootMoves should not be used)
+	bool MultiPVIteration_(NodeBudget nodeBudget, std::vector<RootMove> &rootMoves);
 
 	RootSearchContext &m_context;
-	std::thread m_thread;
+
+	ThreadPool &m_threadPool;
+	DeadlineTimer &m_timer;
 
 	SearchResult m_rootResult;
 
-	std::mutex m_abortingMutex;
-	std::condition_variable m_cvAborting;
+	std::mutex m_doneMutex;
+	std::condition_variable m_cvDone;
+	bool m_done;
 
-	std::thread m_searchTimerThread;
+	// protects the timing state below, which PonderHit can change while the search is running
+	std::mutex m_timingMutex;
+	double m_startTime;
+	std::atomic<double> m_endTime;
+	DeadlineTimer::TimerId m_timerId;
+	bool m_finishing;
 };
 
 Score Search(RootSearchContext &context, std::vector<Move> &pv, Board &board, Score alpha, Score beta, NodeBudget nodeBudget, int32_t ply, bool nullMoveAllowed = true);
@@ -174,6 +228,10 @@ Score QSearch(RootSearchContext &context, std::vector<Move> &pv, Board &board, S
 // this is used in training only, where we don't want to do a typical root search, and don't want all the overhead
 SearchResult SyncSearchNodeLimited(const Board &b, NodeBudget nodeBudget, EvaluatorIface *evaluator, MoveEvaluatorIface *moveEvaluator, Killer *killer = nullptr, TTable *ttable = nullptr, History *history = nullptr);
 
+// same as above, but also stops after maxTime seconds (if maxTime > 0)
+// the first iteration is always completed, and the result is from the last completed iteration
+SearchResult SyncSearchTimeLimited(const Board &b, double maxTime, NodeBudget nodeBudget, EvaluatorIface *evaluator, MoveEvaluatorIface *moveEvaluator, Killer *killer = nullptr, TTable *ttable = nullptr, History *history = nullptr);
+
 // print search trees for debugging
 extern bool trace;
 
@@ -17,6 +17,8 @@
 
 #include "see.h"
 #include "eval/eval_params.h"
+#include "profiling.h"
+#include "slider_attacks.h"
 
 #include <algorithm>
 #include <iostream>
@@ -31,6 +33,8 @@ namespace SEE
 // best tactical result for the moving side
 Score StaticExchangeEvaluation(Board &board, Move mv)
 {
+	Profiling::ScopedTimer timer(Profiling::SEE);
+
 	board.ResetSee();
 
 	// convert the move to SEE format
@@ -125,6 +129,150 @@ Score NMStaticExchangeEvaluation(Board &board, Move mv)
 	return ret;
 }
 
+BatchEvaluator::BatchEvaluator(const Board &board)
+	: m_state(board.GetState()), m_inCheck(board.InCheck()), m_attackersValid(0), m_nmSeeValid(0)
+{
+	const uint64_t *bb = m_state.boardDescBB;
+
+	m_occupancy = bb[WHITE_OCCUPIED] | bb[BLACK_OCCUPIED];
+	m_bishopsAndQueens = bb[WB] | bb[BB] | bb[WQ] | bb[BQ];
+	m_rooksAndQueens = bb[WR] | bb[BR] | bb[WQ] | bb[BQ];
+}
+
+Score BatchEvaluator::StaticExchangeEvaluation(Move mv)
+{
+	Profiling::ScopedTimer timer(Profiling::SEE);
+
+	PieceType pt = GetPieceType(mv);
+	Square from = GetFromSquare(mv);
+	Square to = GetToSquare(mv);
+
+	// the first move is forced, and then the opponent starts the exchange on the moved piece
+	uint64_t occupancy = m_occupancy & InvBit(from);
+	uint64_t attackers = (GetAttackers_(to) | GetXRayAttackers_(to, from, occupancy)) & occupancy;
+
+	PieceType capturedPT = m_state.boardDescU8[to];
+	Score captured = (capturedPT != EMPTY) ? SEE_MAT[capturedPT] : 0;
+
+	return captured - Exchange_(to, attackers, occupancy, m_state.boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK, SEE_MAT[pt]);
+}
+
+Score BatchEvaluator::NMStaticExchangeEvaluation(Move mv)
+{
+	if (m_inCheck)
+	{
+		return 0;
+	}
+
+	Square from = GetFromSquare(mv);
+
+	if (!(m_nmSeeValid & Bit(from)))
+	{
+		m_nmSee[from] = Exchange_(from, GetAttackers_(from), m_occupancy, m_state.boardDescU8[SIDE_TO_MOVE] ^ COLOR_MASK,
+			SEE_MAT[m_state.boardDescU8[from]]);
+
+		m_nmSeeValid |= Bit(from);
+	}
+
+	return m_nmSee[from];
+}
+
+void BatchEvaluator::EvaluateMoves(MoveList &ml, Score *see, Score *nmSee)
+{
+	for (size_t i = 0; i < ml.GetSize(); ++i)
+	{
+		see[i] = StaticExchangeEvaluation(ml[i]);
+		nmSee[i] = NMStaticExchangeEvaluation(ml[i]);
+	}
+}
+
+uint64_t BatchEvaluator::GetAttackers_(Square sq)
+{
+	if (!(m_attackersValid & Bit(sq)))
+	{
+		const uint64_t *bb = m_state.boardDescBB;
+
+		m_attackers[sq] =
+			(PAWN_ATK[sq][1] & bb[WP]) |
+			(PAWN_ATK[sq][0] & bb[BP]) |
+			(KNIGHT_ATK[sq] & (bb[WN] | bb[BN])) |
+			(KING_ATK[sq] & (bb[WK] | bb[BK])) |
+			(SliderAttacks::Bishop(sq, m_occupancy) & m_bishopsAndQueens) |
+			(SliderAttacks::Rook(sq, m_occupancy) & m_rooksAndQueens);
+
+		m_attackersValid |= Bit(sq);
+	}
+
+	return m_attackers[sq];
+}
+
+uint64_t BatchEvaluator::GetXRayAttackers_(Square sq, Square removed, uint64_t occupancy) const
+{
+	if (!LINE[sq][removed])
+	{
+		return 0;
+	}
+
+	if (GetX(sq) == GetX(removed) || GetY(sq) == GetY(removed))
+	{
+		return SliderAttacks::Rook(sq, occupancy) & m_rooksAndQueens;
+	}
+	else
+	{
+		return SliderAttacks::Bishop(sq, occupancy) & m_bishopsAndQueens;
+	}
+}
+
+Score BatchEvaluator::Exchange_(Square sq, uint64_t attackers, uint64_t occupancy, Color side, Score targetValue) const
+{
+	// each side looks for the next attacker starting from the last piece type it used (like GenerateSmallestCaptureSee)
+	const static PieceType AttackerOrder[] = { WP, WN, WB, WR, WQ, WK };
+	const static size_t NumAttackerTypes = sizeof(AttackerOrder) / sizeof(AttackerOrder[0]);
+
+	size_t nextType[2] = { 0, 0 };
+
+	// gains[i] is the value of the piece taken by the i-th capture (at most one capture per piece on the board)
+	Score gains[32];
+	size_t numCaptures = 0;
+
+	while (true)
+	{
+		size_t &typeIdx = nextType[side == WHITE ? 0 : 1];
+		uint64_t candidates = 0;
+
+		while (typeIdx < NumAttackerTypes && !(candidates = attackers & m_state.boardDescBB[AttackerOrder[typeIdx] | side]))
+		{
+			++typeIdx;
+		}
+
+		if (!candidates)
+		{
+			break;
+		}
+
+		Square from = BitScanForward(candidates);
+
+		gains[numCaptures++] = targetValue;
+		targetValue = SEE_MAT[AttackerOrder[typeIdx]];
+
+		occupancy &= InvBit(from);
+		attackers = (attackers | GetXRayAttackers_(sq, from, occupancy)) & occupancy;
+
+		side ^= COLOR_MASK;
+	}
+
+	// each side can stop capturing at any point
+	Score ret = 0;
+
+	while (numCaptures > 0)
+	{
+		--numCaptures;
+		ret = std::max(0, gains[numCaptures] - ret);
+	}
+
+	return ret;
+}
+
 Score GlobalExchangeEvaluation(Board &board, std::vector<Move> &pv, Score currentEval, Score lowerBound, Score upperBound)
 {
 	assert(pv.empty());
@@ -213,6 +361,15 @@ bool RunSeeTest(std::string fen, std::string move, Score expectedScore)
 
 	Score see = StaticExchangeEvaluation(b, mv);
 
+	// the batch evaluator must always agree with the board-based SEE
+	BatchEvaluator batchEvaluator(b);
+
+	if (batchEvaluator.StaticExchangeEvaluation(mv) != see || batchEvaluator.NMStaticExchangeEvaluation(mv) != NMStaticExchangeEvaluation(b, mv))
+	{
+		std::cerr << "Batch SEE mismatch" << std::endl;
+		return false;
+	}
+
 	if (see != expectedScore)
 	{
 		std::cerr << "Expected: " << expectedScore << " Got: " << see << std::endl;
@@ -226,25 +383,90 @@ bool RunSeeTest(std::string fen, std::string move, Score expectedScore)
 	return true;
 }
 
+uint64_t CheckBatchEvaluator(Board &b, uint32_t depth)
+{
+	MoveList ml;
+	b.GenerateAllLegalMoves<Board::ALL>(ml);
+
+	BatchEvaluator batchEvaluator(b);
+
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < ml.GetSize(); ++i)
+	{
+		if (batchEvaluator.StaticExchangeEvaluation(ml[i]) != StaticExchangeEvaluation(b, ml[i]) ||
+			batchEvaluator.NMStaticExchangeEvaluation(ml[i]) != NMStaticExchangeEvaluation(b, ml[i]))
+		{
+			std::cerr << "Batch SEE mismatch for " << b.MoveToAlg(ml[i]) << " in " << b.GetFen() << std::endl;
+			abort();
+		}
+
+		++sum;
+
+		if (depth > 1)
+		{
+			b.ApplyMove(ml[i]);
+			sum += CheckBatchEvaluator(b, depth - 1);
+			b.UndoMove();
+		}
+	}
+
+	return sum;
+}
+
+void RunBatchSeeTests()
+{
+	std::vector<std::pair<std::string, uint32_t>> positions =
+	{
+		{ "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -", 3 },
+		{ "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -", 5 },
+		{ "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4 },
+		{ "rnbqkb1r/pp1p1ppp/2p5/4P3/2B5/8/PPP1NnPP/RNBQK2R w KQkq - 0 6", 3 },
+		{ "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3 }
+	};
+
+	SliderAttacks::Backend originalBackend = SliderAttacks::GetBackend();
+
+	// the batch evaluator does its own attack generation, so we check it with every backend
+	for (int backend = 0; backend < SliderAttacks::NUM_BACKENDS; ++backend)
+	{
+		if (!SliderAttacks::SetBackend(static_cast<SliderAttacks::Backend>(backend)))
+		{
+			continue;
+		}
+
+		for (const auto &position : positions)
+		{
+			std::cout << "Checking batch SEE for " << position.first << ", Depth: " << position.second <<
+						 " (" << SliderAttacks::GetBackendName(SliderAttacks::GetBackend()) << ")" << std::endl;
+
+			Board b(position.first);
+			std::cout << CheckBatchEvaluator(b, position.second) << " moves passed" << std::endl;
+		}
+	}
+
+	SliderAttacks::SetBackend(originalBackend);
+}
+
 void DebugRunSeeTests()
 {
 	// basic white capture, Rxd5
 	if (!RunSeeTest("7k/8/8/3p4/8/3R4/8/K7 w - - 0 1", "d3d5", 100)) { abort(); }
 
 	// basic black capture, exf5
-	if (!RunSeeTest("7k/8/8/4p3/5R2/8/8/K7 b - - 0 1", "e5f4", 600)) { abort(); }
+	if (!RunSeeTest("7k/8/8/4p3/5R2/8/8/K7 b - - 0 1", "e5f4", 500)) { abort(); }
 
 	// simple exchange, exf4 Rxf4
-	if (!RunSeeTest("6k1/8/8/4p3/5R1R/8/8/K7 b - - 0 1", "e5f4", 500)) { abort(); }
+	if (!RunSeeTest("6k1/8/8/4p3/5R1R/8/8/K7 b - - 0 1", "e5f4", 400)) { abort(); }
 
 	// decide to not capture, exf4
-	if (!RunSeeTest("7k/8/8/4p3/5R2/8/8/K7 b - - 0 1", "e5f4", 600)) { abort(); }
+	if (!RunSeeTest("7k/8/8/4p3/5R2/8/8/K7 b - - 0 1", "e5f4", 500)) { abort(); }
 
 	// decide to not recapture due to discovered attacker, Rxe6
-	if (!RunSeeTest("7k/4q3/4q3/8/4R3/4R3/8/K7 w - - 0 1", "e4e6", 1200)) { abort(); }
+	if (!RunSeeTest("7k/4q3/4q3/8/4R3/4R3/8/K7 w - - 0 1", "e4e6", 975)) { abort(); }
 
 	// recapture without the discovered attacker, Rxe6 Qxe6
-	if (!RunSeeTest("7k/4q3/4q3/8/4R3/8/8/K7 w - - 0 1", "e4e6", 600)) { abort(); }
+	if (!RunSeeTest("7k/4q3/4q3/8/4R3/8/8/K7 w - - 0 1", "e4e6", 475)) { abort(); }
 
 	// complex capture sequence, cxd4 exd4 Nxd4
 	if (!RunSeeTest("4q2k/3q2b1/8/2p5/3P4/4P3/3Rn3/K2R4 b - - 0 1", "c5d4", 100)) { abort(); }
@@ -256,16 +478,18 @@ void DebugRunSeeTests()
 	if (!RunSeeTest("7k/q7/8/2p5/3P4/8/3R4/6K1 b - - 0 1", "c5d4", 100)) { abort(); }
 
 	// bad capture by black, Nxd4 Rxd4
-	if (!RunSeeTest("7k/q7/2n5/8/3P4/8/3R4/3R2K1 b - - 0 1", "c6d4", -300)) { abort(); }
+	if (!RunSeeTest("7k/q7/2n5/8/3P4/8/3R4/3R2K1 b - - 0 1", "c6d4", -225)) { abort(); }
 
 	// bad capture by white, Rxd4 Nxd4
-	if (!RunSeeTest("7k/q7/2n5/8/3p4/8/3R4/3R2K1 w - - 0 1", "d2d4", -500)) { abort(); }
+	if (!RunSeeTest("7k/q7/2n5/8/3p4/8/3R4/3R2K1 w - - 0 1", "d2d4", -400)) { abort(); }
 
 	// white non-capture, losing
-	if (!RunSeeTest("2r4k/1P6/8/4q1nr/7p/5N2/K7/8 w - - 0 1", "f3e1", -400)) { abort(); }
+	if (!RunSeeTest("2r4k/1P6/8/4q1nr/7p/5N2/K7/8 w - - 0 1", "f3e1", -325)) { abort(); }
 
 	// white non-capture, non-losing
 	if (!RunSeeTest("2r4k/1P6/8/4q1nr/7p/5N2/K7/8 w - - 0 1", "f3d2", 0)) { abort(); }
+
+	RunBatchSeeTests();
 }
 
 }
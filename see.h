@@ -57,6 +57,48 @@ Score StaticExchangeEvaluationSq(Board &board, Square sq, bool forced = false);
 // returns whether this move is an escape, and the value of the escape (how much the opponent can gain through SEE if we didn't move)
 Score NMStaticExchangeEvaluation(Board &board, Move mv);
 
+// SEE for many moves of the same position, without putting the board in SEE mode
+// attackers of each target square are found once (with the initial occupancy), and then kept up to date by adding
+// x-ray attackers as pieces are removed, so each move is a swap list over bitboards
+// non-move SEE only depends on the source square, so it is computed once per square
+// results are the same as StaticExchangeEvaluation and NMStaticExchangeEvaluation (including their quirks, eg. each
+// side goes through piece types in order, and doesn't go back to a cheaper piece type revealed later)
+// the board must not be changed while this is in use
+class BatchEvaluator
+{
+public:
+	explicit BatchEvaluator(const Board &board);
+
+	Score StaticExchangeEvaluation(Move mv);
+
+	Score NMStaticExchangeEvaluation(Move mv);
+
+	// see and nmSee must have space for ml.GetSize() scores
+	void EvaluateMoves(MoveList &ml, Score *see, Score *nmSee);
+
+private:
+	// attackers of sq (of both sides) with the initial occupancy
+	uint64_t GetAttackers_(Square sq);
+
+	// sliders that attack sq through removed (if removed is on a line with sq)
+	uint64_t GetXRayAttackers_(Square sq, Square removed, uint64_t occupancy) const;
+
+	// value of the exchange on sq for side (who can choose not to start it), if the piece on sq is worth targetValue
+	Score Exchange_(Square sq, uint64_t attackers, uint64_t occupancy, Color side, Score targetValue) const;
+
+	const Board::State &m_state;
+	uint64_t m_occupancy;
+	uint64_t m_bishopsAndQueens;
+	uint64_t m_rooksAndQueens;
+	bool m_inCheck;
+
+	uint64_t m_attackers[64];
+	uint64_t m_attackersValid;
+
+	Score m_nmSee[64];
+	uint64_t m_nmSeeValid;
+};
+
 // this is essentially QSearch, but using SEE evaluation instead of the actual eval function
 // the goal is to discover a reasonable PV quickly
 // scores are biased to 0 at the start position of the search
@@ -67,6 +109,13 @@ void GEERunFunc(Board &board, std::function<void(Board &b)> func);
 
 bool RunSeeTest(std::string fen, std::string move, Score expectedScore);
 
+// checks that BatchEvaluator agrees with the board-based SEE and NM-SEE for every move in the legal move tree
+// (aborts on mismatch), and returns the number of moves checked
+uint64_t CheckBatchEvaluator(Board &b, uint32_t depth);
+
+// runs CheckBatchEvaluator() on a few perft positions with all supported slider attack backends
+void RunBatchSeeTests();
+
 void DebugRunSeeTests();
 
 }
@@ -0,0 +1,232 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "slider_attacks.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+#include <cassert>
+
+#include "bit_ops.h"
+
+namespace
+{
+
+#ifdef GIRAFFE_TABLE_GENERATOR
+// portable PEXT, for building the tables (so they can be generated on any CPU)
+uint64_t SoftwarePext(uint64_t src, uint64_t mask)
+{
+	uint64_t ret = 0;
+	uint64_t outBit = 1;
+
+	while (mask)
+	{
+		uint64_t lowestBit = mask & (~mask + 1);
+
+		if (src & lowestBit)
+		{
+			ret |= outBit;
+		}
+
+		outBit <<= 1;
+		mask &= mask - 1;
+	}
+
+	return ret;
+}
+#endif // GIRAFFE_TABLE_GENERATOR
+
+bool CpuHasBmi2()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+	unsigned int eax, ebx, ecx, edx;
+
+	if (__get_cpuid_max(0, nullptr) < 7)
+	{
+		return false;
+	}
+
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+	// CPUID.(EAX=07H, ECX=0H):EBX.BMI2[bit 8]
+	return (ebx >> 8) & 0x1;
+#else
+	return false;
+#endif
+}
+
+// PEXT is microcoded on AMD CPUs before Zen 3 (family 19h), and much slower than magics there
+bool CpuHasFastPext()
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+	unsigned int eax, ebx, ecx, edx;
+
+	__cpuid(0, eax, ebx, ecx, edx);
+
+	// "AuthenticAMD" is returned in EBX, EDX, ECX
+	bool isAmd = (ebx == 0x68747541) && (edx == 0x69746e65) && (ecx == 0x444d4163);
+
+	if (!isAmd)
+	{
+		return true;
+	}
+
+	__cpuid(1, eax, ebx, ecx, edx);
+
+	// the extended family is only added if the base family is 0xf
+	unsigned int family = (eax >> 8) & 0xf;
+
+	if (family == 0xf)
+	{
+		family += (eax >> 20) & 0xff;
+	}
+
+	return family >= 0x19;
+#else
+	return true;
+#endif
+}
+
+bool gPextSupported = false;
+
+}
+
+namespace SliderAttacks
+{
+
+Backend gBackend = MAGIC;
+
+#ifdef GIRAFFE_TABLE_GENERATOR
+uint64_t PEXT_TABLE[PEXT_TABLE_SIZE];
+const uint64_t *BISHOP_PEXT_TABLE[64];
+const uint64_t *ROOK_PEXT_TABLE[64];
+
+void InitPextTables()
+{
+	// the tables are filled from the magic tables, so the 2 backends always agree
+	size_t rookOffsets[64];
+	size_t bishopOffsets[64];
+	size_t size = 0;
+
+	for (Square sq = 0; sq < 64; ++sq)
+	{
+		rookOffsets[sq] = size;
+		size += 1ULL << PopCount(magicmoves_r_mask[sq]);
+	}
+
+	for (Square sq = 0; sq < 64; ++sq)
+	{
+		bishopOffsets[sq] = size;
+		size += 1ULL << PopCount(magicmoves_b_mask[sq]);
+	}
+
+	assert(size == PEXT_TABLE_SIZE);
+
+	for (Square sq = 0; sq < 64; ++sq)
+	{
+		ROOK_PEXT_TABLE[sq] = &PEXT_TABLE[rookOffsets[sq]];
+		BISHOP_PEXT_TABLE[sq] = &PEXT_TABLE[bishopOffsets[sq]];
+
+		// enumerate all subsets of the masks (Carry-Rippler)
+		uint64_t rookMask = magicmoves_r_mask[sq];
+		uint64_t occupancy = 0;
+
+		do
+		{
+			PEXT_TABLE[rookOffsets[sq] + SoftwarePext(occupancy, rookMask)] = Rmagic(sq, occupancy);
+			occupancy = (occupancy - rookMask) & rookMask;
+		} while (occupancy);
+
+		uint64_t bishopMask = magicmoves_b_mask[sq];
+		occupancy = 0;
+
+		do
+		{
+			PEXT_TABLE[bishopOffsets[sq] + SoftwarePext(occupancy, bishopMask)] = Bmagic(sq, occupancy);
+			occupancy = (occupancy - bishopMask) & bishopMask;
+		} while (occupancy);
+	}
+}
+#endif // GIRAFFE_TABLE_GENERATOR
+
+void Init()
+{
+	gPextSupported = CpuHasBmi2();
+
+	// PEXT can still be selected with SetBackend() where it's slow (eg. to benchmark it)
+	gBackend = (gPextSupported && CpuHasFastPext()) ? PEXT : MAGIC;
+}
+
+bool IsSupported(Backend backend)
+{
+	switch (backend)
+	{
+	case MAGIC:
+		return true;
+	case PEXT:
+		return gPextSupported;
+	default:
+		return false;
+	}
+}
+
+bool SetBackend(Backend backend)
+{
+	if (!IsSupported(backend))
+	{
+		return false;
+	}
+
+	gBackend = backend;
+
+	return true;
+}
+
+Backend GetBackend()
+{
+	return gBackend;
+}
+
+std::string GetBackendName(Backend backend)
+{
+	switch (backend)
+	{
+	case MAGIC:
+		return "magic";
+	case PEXT:
+		return "pext";
+	default:
+		return "unknown";
+	}
+}
+
+Backend ParseBackendName(const std::string &name)
+{
+	for (int i = 0; i < NUM_BACKENDS; ++i)
+	{
+		if (GetBackendName(static_cast<Backend>(i)) == name)
+		{
+			return static_cast<Backend>(i);
+		}
+	}
+
+	return NUM_BACKENDS;
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SLIDER_ATTACKS_H
+#define SLIDER_ATTACKS_H
+
+#include <string>
+
+#include <cstdint>
+
+#include "types.h"
+#include "magic_moves.h"
+#include "generated_tables.h"
+
+// all sliding piece attack lookups go through here, so the table indexing scheme can be selected at runtime
+// MAGIC uses the multiply-shift magic tables in magic_moves.h, and is always available
+// PEXT indexes a compact table with the BMI2 PEXT instruction (no multiply), and is only available on CPUs with BMI2
+// (PEXT is microcoded and slow on AMD CPUs before Zen 3, so it's not selected by default on those, but
+// it can still be forced)
+namespace SliderAttacks
+{
+
+enum Backend
+{
+	MAGIC,
+	PEXT,
+	NUM_BACKENDS
+};
+
+// selects PEXT if supported and fast (the tables themselves are generated at build time, see generated_tables.h)
+void Init();
+
+#ifdef GIRAFFE_TABLE_GENERATOR
+// fills the PEXT tables from the magic tables, must be called after initmagicmoves()
+void InitPextTables();
+#endif
+
+bool IsSupported(Backend backend);
+
+// returns false (and doesn't change anything) if the backend is not supported
+bool SetBackend(Backend backend);
+
+Backend GetBackend();
+
+std::string GetBackendName(Backend backend);
+
+// returns NUM_BACKENDS if the name is unknown
+Backend ParseBackendName(const std::string &name);
+
+// internal state for the inline lookups below
+extern Backend gBackend;
+
+// rook tables followed by bishop tables, 2^(number of bits in the mask) entries per square
+// (same total sizes as MINIMIZE_MAGIC in magic_moves.cpp)
+const size_t PEXT_TABLE_SIZE = 102400 + 5248;
+
+extern GENERATED_TABLE uint64_t PEXT_TABLE[PEXT_TABLE_SIZE];
+extern const uint64_t *GENERATED_TABLE BISHOP_PEXT_TABLE[64];
+extern const uint64_t *GENERATED_TABLE ROOK_PEXT_TABLE[64];
+
+inline uint64_t Pext(uint64_t src, uint64_t mask)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+	// we use inline assembly instead of _pext_u64, so the rest of the program doesn't have to be compiled with BMI2
+	// enabled (this is only executed if the CPU supports it)
+	uint64_t ret;
+	__asm__("pextq %2, %1, %0" : "=r" (ret) : "r" (src), "r" (mask));
+	return ret;
+#else
+	(void) src;
+	(void) mask;
+	return 0;
+#endif
+}
+
+inline uint64_t Bishop(Square sq, uint64_t occupancy)
+{
+	if (gBackend == PEXT)
+	{
+		return BISHOP_PEXT_TABLE[sq][Pext(occupancy, magicmoves_b_mask[sq])];
+	}
+
+	return Bmagic(sq, occupancy);
+}
+
+inline uint64_t Rook(Square sq, uint64_t occupancy)
+{
+	if (gBackend == PEXT)
+	{
+		return ROOK_PEXT_TABLE[sq][Pext(occupancy, magicmoves_r_mask[sq])];
+	}
+
+	return Rmagic(sq, occupancy);
+}
+
+inline uint64_t Queen(Square sq, uint64_t occupancy)
+{
+	return Bishop(sq, occupancy) | Rook(sq, occupancy);
+}
+
+}
+
+#endif // SLIDER_ATTACKS_H
@@ -58,10 +58,15 @@ public:
 			si.killer->GetKillers(killerMoves, si.ply);
 		}
 
+		Board::GivesCheckInfo gci = board.ComputeGivesCheckInfo();
+		SEE::BatchEvaluator see(board);
+
 		for (auto &mi : list)
 		{
 			Move mv = mi.move;
 
+			mi.givesCheck = board.GivesCheck(mv, gci);
+
 			PieceType promoType = GetPromoType(mv);
 
 			bool isViolent = board.IsViolent(mv);
@@ -70,8 +75,8 @@ public:
 			bool isQueenPromo = (promoType == WQ || promoType == BQ);
 			bool isUnderPromo = (isPromo && !isQueenPromo);
 
-			mi.seeScore = SEE::StaticExchangeEvaluation(board, mv);
-			mi.nmSeeScore = SEE::NMStaticExchangeEvaluation(board, mv);
+			mi.seeScore = see.StaticExchangeEvaluation(mv);
+			mi.nmSeeScore = see.NMStaticExchangeEvaluation(mv);
 
 			if (mv == si.hashMove)
 			{
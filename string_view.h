@@ -0,0 +1,133 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRING_VIEW_H
+#define STRING_VIEW_H
+
+#include <string>
+
+#include <cstddef>
+#include <cstring>
+
+// a non-owning reference to a range of characters, for parsing without making temporary strings
+// (std::string_view is C++17)
+// the referenced characters must outlive the view
+class StringView
+{
+public:
+	const static size_t npos = static_cast<size_t>(-1);
+
+	StringView() : m_data(nullptr), m_size(0) {}
+	StringView(const char *data, size_t size) : m_data(data), m_size(size) {}
+	StringView(const char *str) : m_data(str), m_size(strlen(str)) {}
+	StringView(const std::string &str) : m_data(str.data()), m_size(str.size()) {}
+
+	const char *Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+	bool Empty() const { return m_size == 0; }
+
+	char operator[](size_t i) const { return m_data[i]; }
+
+	const char *begin() const { return m_data; }
+	const char *end() const { return m_data + m_size; }
+
+	// len is clamped to the end of the view
+	StringView Substr(size_t pos, size_t len = npos) const
+	{
+		if (pos > m_size)
+		{
+			pos = m_size;
+		}
+
+		return StringView(m_data + pos, (len > (m_size - pos)) ? (m_size - pos) : len);
+	}
+
+	size_t Find(char c, size_t pos = 0) const
+	{
+		for (size_t i = pos; i < m_size; ++i)
+		{
+			if (m_data[i] == c)
+			{
+				return i;
+			}
+		}
+
+		return npos;
+	}
+
+	// without leading and trailing whitespace (including line endings)
+	StringView Trim() const
+	{
+		size_t start = 0;
+		size_t end = m_size;
+
+		while (start < end && IsSpace(m_data[start]))
+		{
+			++start;
+		}
+
+		while (end > start && IsSpace(m_data[end - 1]))
+		{
+			--end;
+		}
+
+		return StringView(m_data + start, end - start);
+	}
+
+	// returns the next whitespace-separated token, and removes it (and whitespace before it) from the view
+	// returns an empty view if there are no more tokens
+	StringView NextToken()
+	{
+		size_t start = 0;
+
+		while (start < m_size && IsSpace(m_data[start]))
+		{
+			++start;
+		}
+
+		size_t end = start;
+
+		while (end < m_size && !IsSpace(m_data[end]))
+		{
+			++end;
+		}
+
+		StringView token(m_data + start, end - start);
+
+		m_data += end;
+		m_size -= end;
+
+		return token;
+	}
+
+	bool operator==(StringView other) const
+	{
+		return m_size == other.m_size && (m_size == 0 || memcmp(m_data, other.m_data, m_size) == 0);
+	}
+
+	bool operator!=(StringView other) const { return !(*this == other); }
+
+	std::string ToString() const { return std::string(m_data, m_size); }
+
+	static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+private:
+	const char *m_data;
+	size_t m_size;
+};
+
+#endif // STRING_VIEW_H
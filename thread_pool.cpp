@@ -0,0 +1,80 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t numThreads)
+	: m_quitting(false)
+{
+	for (size_t i = 0; i < numThreads; ++i)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::WorkerLoop_, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quitting = true;
+	}
+
+	m_cvQueue.notify_all();
+
+	for (auto &t : m_threads)
+	{
+		t.join();
+	}
+}
+
+void ThreadPool::Push(Job job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(job));
+	}
+
+	m_cvQueue.notify_one();
+}
+
+void ThreadPool::WorkerLoop_()
+{
+	while (true)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (m_queue.empty() && !m_quitting)
+			{
+				m_cvQueue.wait(lock);
+			}
+
+			if (m_queue.empty())
+			{
+				// quitting, and nothing left to do
+				return;
+			}
+
+			job = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		job();
+	}
+}
@@ -0,0 +1,59 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "thread_wrapper.h"
+#include "mutex_wrapper.h"
+#include "condition_variable_wrapper.h"
+
+// a fixed set of long-lived worker threads running queued jobs in FIFO order
+// this is so that we don't have to create a new thread for every search
+class ThreadPool
+{
+public:
+	typedef std::function<void ()> Job;
+
+	ThreadPool(size_t numThreads);
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool &operator=(const ThreadPool&) = delete;
+
+	// runs all jobs already queued, then joins the workers
+	~ThreadPool();
+
+	void Push(Job job);
+
+private:
+	void WorkerLoop_();
+
+	std::vector<std::thread> m_threads;
+
+	std::deque<Job> m_queue;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cvQueue;
+
+	bool m_quitting;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,72 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THREAD_REGISTRY_H
+#define THREAD_REGISTRY_H
+
+#include <vector>
+
+#include "mutex_wrapper.h"
+#include "util.h"
+
+// per-thread blocks of statistics (eg. counters and timers), that any thread can aggregate
+// each thread gets its own block the first time it asks for one, so updating it doesn't need any
+// synchronization beyond what T does itself
+// blocks are never freed, so totals still include threads that have exited
+template <typename T>
+class ThreadRegistry
+{
+public:
+	// the calling thread's block
+	static T *Get()
+	{
+		static thread_local T *block = nullptr;
+
+		if (!block)
+		{
+			block = Register_();
+		}
+
+		return block;
+	}
+
+	// calls func(T &) on all blocks, with new registrations blocked
+	template <typename F>
+	static void ForEach(F func)
+	{
+		std::lock_guard<std::mutex> lock(LeakedStatic<ThreadRegistry, std::mutex>());
+
+		for (auto block : LeakedStatic<ThreadRegistry, std::vector<T*>>())
+		{
+			func(*block);
+		}
+	}
+
+private:
+	// kept out of line, so Get() stays small enough to inline everywhere
+	__attribute__((noinline)) static T *Register_()
+	{
+		T *ret = new T;
+
+		std::lock_guard<std::mutex> lock(LeakedStatic<ThreadRegistry, std::mutex>());
+		LeakedStatic<ThreadRegistry, std::vector<T*>>().push_back(ret);
+
+		return ret;
+	}
+};
+
+#endif // THREAD_REGISTRY_H
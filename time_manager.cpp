@@ -0,0 +1,361 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "time_manager.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+
+const static std::string LogPrefix = "# tm";
+
+struct LoggedSearch
+{
+	Search::TimeAllocation timeAlloc;
+	std::vector<TimeManager::Iteration> iterations;
+};
+
+std::vector<LoggedSearch> ReadLog(const std::string &filename)
+{
+	std::vector<LoggedSearch> ret;
+
+	std::ifstream infile(filename);
+
+	if (!infile)
+	{
+		std::cerr << "Failed to open " << filename << std::endl;
+		return ret;
+	}
+
+	std::string lineStr;
+
+	while (std::getline(infile, lineStr))
+	{
+		if (lineStr.compare(0, LogPrefix.size(), LogPrefix) != 0)
+		{
+			continue;
+		}
+
+		std::stringstream line(lineStr.substr(LogPrefix.size()));
+
+		std::string type;
+		line >> type;
+
+		if (type == "start")
+		{
+			LoggedSearch search;
+			line >> search.timeAlloc.normalTime >> search.timeAlloc.maxTime;
+			ret.push_back(search);
+		}
+		else if (type == "iter" && !ret.empty())
+		{
+			TimeManager::Iteration iteration;
+			line >> iteration.nodeBudget >> iteration.nodeCount >> iteration.time >> iteration.bestMove >> iteration.score;
+			ret.back().iterations.push_back(iteration);
+		}
+	}
+
+	return ret;
+}
+
+}
+
+bool TimeManager::Params::Set(const std::string &name, double value)
+{
+	if (name == "instabilityExtension") { instabilityExtension = value; }
+	else if (name == "instabilityIterations") { instabilityIterations = value; }
+	else if (name == "failLowExtension") { failLowExtension = value; }
+	else if (name == "failLowMargin") { failLowMargin = value; }
+	else if (name == "easyMoveIterations") { easyMoveIterations = value; }
+	else if (name == "easyMoveScale") { easyMoveScale = value; }
+	else if (name == "predictionMargin") { predictionMargin = value; }
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+double TimeManager::GetTargetTime(const Search::TimeAllocation &timeAlloc) const
+{
+	double scale = 1.0;
+
+	size_t numIterations = m_iterations.size();
+
+	if (numIterations >= 2)
+	{
+		// count best move changes in the last few iterations
+		int32_t changes = 0;
+
+		for (size_t i = numIterations - 1; i > 0 && (numIterations - i) <= static_cast<size_t>(m_params.instabilityIterations); --i)
+		{
+			if (m_iterations[i].bestMove != m_iterations[i - 1].bestMove)
+			{
+				++changes;
+			}
+		}
+
+		scale += changes * m_params.instabilityExtension;
+
+		bool failingLow = m_iterations[numIterations - 1].score < (m_iterations[numIterations - 2].score - m_params.failLowMargin);
+
+		if (failingLow)
+		{
+			scale += m_params.failLowExtension;
+		}
+
+		// how many iterations the current best move has been the best move for
+		int32_t stableIterations = 1;
+
+		for (size_t i = numIterations - 1; i > 0 && m_iterations[i].bestMove == m_iterations[i - 1].bestMove; --i)
+		{
+			++stableIterations;
+		}
+
+		if (changes == 0 && !failingLow && stableIterations >= m_params.easyMoveIterations)
+		{
+			scale *= m_params.easyMoveScale;
+		}
+	}
+
+	return std::min(timeAlloc.normalTime * scale, timeAlloc.maxTime);
+}
+
+double TimeManager::PredictIterationTime(NodeBudget nodeBudget) const
+{
+	if (m_iterations.empty())
+	{
+		return 0.0;
+	}
+
+	size_t numIterations = m_iterations.size();
+
+	const Iteration &last = m_iterations.back();
+
+	// nodes and time of iteration i
+	auto iterationNodes = [&](size_t i) -> double
+	{
+		return m_iterations[i].nodeCount - ((i > 0) ? m_iterations[i - 1].nodeCount : 0);
+	};
+
+	double iterationTime = last.time - ((numIterations >= 2) ? m_iterations[numIterations - 2].time : 0.0);
+
+	// very short iterations don't give us reliable NPS, so we use the average over the whole search
+	const double MinIterationTimeForNPS = 0.01;
+
+	double nps = (iterationTime > MinIterationTimeForNPS) ? (iterationNodes(numIterations - 1) / iterationTime) : (last.nodeCount / std::max(last.time, 1e-6));
+
+	if (nps <= 0.0 || last.nodeBudget == 0)
+	{
+		return 0.0;
+	}
+
+	// nodes actually searched per unit of node budget
+	double nodesPerBudget = iterationNodes(numIterations - 1) / last.nodeBudget;
+
+	// this goes down as node budget goes up (because of the TT, and pruning), so we extrapolate
+	// using how node counts grew over the last 2 iterations (which oscillate, so we average over 2)
+	if (numIterations >= 3 && iterationNodes(numIterations - 3) > 0)
+	{
+		double budgetGrowth = static_cast<double>(last.nodeBudget) / m_iterations[numIterations - 2].nodeBudget;
+		double nodeGrowth = std::sqrt(iterationNodes(numIterations - 1) / iterationNodes(numIterations - 3));
+
+		if (budgetGrowth > 1.0 && nodeGrowth > 0.0)
+		{
+			// nodes per budget in the next iteration, assuming it changes the same way it did
+			double nodesPerBudgetScale = std::min(nodeGrowth / budgetGrowth, 1.0);
+
+			// for the budget we are asked about (which is usually last.nodeBudget * budgetGrowth)
+			nodesPerBudget *= std::pow(nodesPerBudgetScale, std::log(static_cast<double>(nodeBudget) / last.nodeBudget) / std::log(budgetGrowth));
+		}
+	}
+
+	return nodesPerBudget * nodeBudget / nps;
+}
+
+bool TimeManager::ShouldStartIteration(const Search::TimeAllocation &timeAlloc, double elapsed, NodeBudget nodeBudget) const
+{
+	double predictedEndTime = elapsed + PredictIterationTime(nodeBudget) * m_params.predictionMargin;
+
+	return predictedEndTime <= GetTargetTime(timeAlloc);
+}
+
+void TimeManager::LogSearchStart(const Search::TimeAllocation &timeAlloc)
+{
+	std::cout << LogPrefix << " start " << timeAlloc.normalTime << " " << timeAlloc.maxTime << std::endl;
+}
+
+void TimeManager::LogIteration(const Iteration &iteration)
+{
+	std::cout << LogPrefix << " iter " << iteration.nodeBudget << " " << iteration.nodeCount << " " << iteration.time << " "
+			  << iteration.bestMove << " " << iteration.score << std::endl;
+}
+
+void SimulateTimeManagement(const std::string &logFilename, const std::vector<std::string> &args)
+{
+	TimeManager::Params params;
+
+	double normalTimeOverride = 0.0;
+	double maxTimeOverride = 0.0;
+
+	for (const auto &arg : args)
+	{
+		size_t eq = arg.find('=');
+
+		if (eq == std::string::npos)
+		{
+			std::cerr << "Arguments must be name=value: " << arg << std::endl;
+			return;
+		}
+
+		std::string name = arg.substr(0, eq);
+		double value = std::atof(arg.substr(eq + 1).c_str());
+
+		if (name == "normal")
+		{
+			normalTimeOverride = value;
+		}
+		else if (name == "max")
+		{
+			maxTimeOverride = value;
+		}
+		else if (!params.Set(name, value))
+		{
+			std::cerr << "Unknown parameter: " << name << std::endl;
+			return;
+		}
+	}
+
+	std::vector<LoggedSearch> searches = ReadLog(logFilename);
+
+	size_t numSearches = 0;
+	size_t numSameMove = 0;
+	size_t numAborted = 0;
+	size_t numOutOfLog = 0;
+	double totalTime = 0.0;
+	double totalLoggedTime = 0.0;
+
+	// how far off the predictions are, in log ratio
+	double totalPredictionError = 0.0;
+	size_t numPredictions = 0;
+
+	for (auto &search : searches)
+	{
+		if (search.iterations.empty())
+		{
+			continue;
+		}
+
+		Search::TimeAllocation timeAlloc = search.timeAlloc;
+
+		if (normalTimeOverride > 0.0)
+		{
+			timeAlloc.normalTime = normalTimeOverride;
+		}
+
+		if (maxTimeOverride > 0.0)
+		{
+			timeAlloc.maxTime = maxTimeOverride;
+		}
+
+		TimeManager tm(params);
+
+		// the search always completes the first iteration
+		size_t lastDone = 0;
+		tm.IterationDone(search.iterations[0]);
+
+		double timeUsed = search.iterations[0].time;
+
+		for (size_t i = 1; i < search.iterations.size(); ++i)
+		{
+			const auto &next = search.iterations[i];
+			const auto &prev = search.iterations[i - 1];
+
+			double predicted = tm.PredictIterationTime(next.nodeBudget);
+
+			// very short iterations are too noisy to be interesting
+			const double MinIterationTimeForStats = 0.05;
+
+			if (predicted > 0.0 && (next.time - prev.time) > MinIterationTimeForStats)
+			{
+				totalPredictionError += std::fabs(std::log(predicted / (next.time - prev.time)));
+				++numPredictions;
+			}
+
+			if (!tm.ShouldStartIteration(timeAlloc, prev.time, next.nodeBudget))
+			{
+				break;
+			}
+
+			if (next.time > timeAlloc.maxTime)
+			{
+				// this iteration would have been aborted by the deadline
+				timeUsed = timeAlloc.maxTime;
+				++numAborted;
+				break;
+			}
+
+			tm.IterationDone(next);
+			lastDone = i;
+			timeUsed = next.time;
+		}
+
+		size_t numIterations = search.iterations.size();
+
+		if (lastDone == (numIterations - 1) && numIterations > 1 &&
+			tm.ShouldStartIteration(timeAlloc, timeUsed,
+				search.iterations.back().nodeBudget * (search.iterations.back().nodeBudget / search.iterations[numIterations - 2].nodeBudget)))
+		{
+			// we would have kept going, but don't know what would have happened
+			++numOutOfLog;
+		}
+
+		++numSearches;
+		totalTime += timeUsed;
+		totalLoggedTime += search.iterations.back().time;
+
+		if (search.iterations[lastDone].bestMove == search.iterations.back().bestMove)
+		{
+			++numSameMove;
+		}
+	}
+
+	if (numSearches == 0)
+	{
+		std::cout << "No searches found in " << logFilename << std::endl;
+		return;
+	}
+
+	std::cout << "Searches: " << numSearches << std::endl;
+	std::cout << "Time used: " << totalTime << "s (logged: " << totalLoggedTime << "s)" << std::endl;
+	std::cout << "Same move as deepest iteration: " << numSameMove << " (" << (100.0 * numSameMove / numSearches) << "%)" << std::endl;
+	std::cout << "Iterations aborted at max time: " << numAborted << std::endl;
+	std::cout << "Would have searched past end of log: " << numOutOfLog << std::endl;
+
+	if (numPredictions > 0)
+	{
+		std::cout << "Mean iteration time prediction error (factor): " << std::exp(totalPredictionError / numPredictions) << std::endl;
+	}
+}
@@ -0,0 +1,110 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include "types.h"
+#include "move.h"
+#include "search.h"
+
+// decides whether iterative deepening should start another iteration
+// the target time starts at normalTime, is extended towards maxTime when the best move changes or
+// the score drops, and is reduced when the best move has been stable for a while
+// the next iteration is only started if it's predicted to finish before the target time, and the
+// prediction is based on nodes per node budget and NPS measured in the last iteration
+// this doesn't look at the clock, so that logged searches can be replayed (see SimulateTimeManagement)
+class TimeManager
+{
+public:
+	struct Params
+	{
+		// target time is extended by this fraction of normalTime for each best move change in the last
+		// few iterations
+		double instabilityExtension = 0.5;
+		int32_t instabilityIterations = 3;
+
+		// and by this much if the score dropped by more than failLowMargin since the last iteration
+		double failLowExtension = 1.0;
+		Score failLowMargin = 150;
+
+		// if the best move hasn't changed for this many iterations, and the score is not dropping,
+		// target time is multiplied by easyMoveScale
+		int32_t easyMoveIterations = 4;
+		double easyMoveScale = 0.5;
+
+		// predicted iteration times are multiplied by this to be safe
+		double predictionMargin = 1.1;
+
+		// returns false if name is unknown
+		bool Set(const std::string &name, double value);
+	};
+
+	struct Iteration
+	{
+		NodeBudget nodeBudget;
+
+		// total for the search so far
+		uint64_t nodeCount;
+
+		// since search start
+		double time;
+
+		Move bestMove;
+		Score score;
+	};
+
+	TimeManager() {}
+	TimeManager(const Params &params) : m_params(params) {}
+
+	// only completed iterations should be recorded
+	void IterationDone(const Iteration &iteration) { m_iterations.push_back(iteration); }
+
+	// in seconds since search start, between 0 and maxTime
+	double GetTargetTime(const Search::TimeAllocation &timeAlloc) const;
+
+	// how long an iteration with this node budget would take, based on the last completed iteration
+	// returns 0 if we don't have enough information
+	double PredictIterationTime(NodeBudget nodeBudget) const;
+
+	bool ShouldStartIteration(const Search::TimeAllocation &timeAlloc, double elapsed, NodeBudget nodeBudget) const;
+
+	// machine-readable lines for SimulateTimeManagement
+	static void LogSearchStart(const Search::TimeAllocation &timeAlloc);
+	static void LogIteration(const Iteration &iteration);
+
+private:
+	Params m_params;
+
+	std::vector<Iteration> m_iterations;
+};
+
+// replay searches logged by TimeManager::LogSearchStart/LogIteration (engine output can be used directly)
+// and report how much time would have been used, and how often the final move would have been different
+// from the move of the deepest logged iteration
+// args are name=value pairs to override TimeManager::Params, or normal=/max= to override the time allocation
+// (eg. for logs from analysis mode, which doesn't have one)
+// since we only know about iterations that were actually searched, logs should come from searches that
+// were given more time than the time manager would normally use
+void SimulateTimeManagement(const std::string &logFilename, const std::vector<std::string> &args);
+
+#endif // TIME_MANAGER_H
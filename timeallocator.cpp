@@ -17,6 +17,7 @@
 
 #include "timeallocator.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <cstdint>
@@ -28,6 +29,10 @@ static const int32_t SUDDEN_DEATH_DIVISOR = 25;
 static const double DIVISOR_MAX_RATIO = 2.0;
 static const double MIN_TIME_PER_MOVE = 0.0;
 
+// the search can now actually use up to maxTime (when the best move is unstable), so we make sure
+// that's never more than this fraction of what's left on the clock
+static const double MAX_TIME_CLOCK_FRACTION = 0.5;
+
 // this number controls how much more time it uses in the beginning vs the end
 // higher number means more time in the beginning
 static const double DIVISOR_SCALE = 0.5f;
@@ -59,6 +64,7 @@ Search::TimeAllocation AllocateTime(const ChessClock &cc)
 
 		tAlloc.normalTime = (cc.GetInc() + cc.GetReading() / divisor);
 		tAlloc.maxTime = cc.GetInc() + cc.GetReading() / divisor * DIVISOR_MAX_RATIO;
+		tAlloc.maxTime = std::min(tAlloc.maxTime, std::max(tAlloc.normalTime, cc.GetReading() * MAX_TIME_CLOCK_FRACTION));
 
 		tAlloc.normalTime = std::max(tAlloc.normalTime, MIN_TIME_PER_MOVE);
 		tAlloc.maxTime = std::max(tAlloc.maxTime, MIN_TIME_PER_MOVE);
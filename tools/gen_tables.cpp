@@ -0,0 +1,187 @@
+/*
+	Copyright (C) 2015 Matthew Lai
+
+	Giraffe is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	
+	Giraffe is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+	
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// builds all the lookup tables using the engine's own initialization code, and writes them out as C++ source
+// this is built and run by the Makefile (see generated_tables.h), and should not need to be run manually
+// usage: gen_tables <output cpp>
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>
+
+#include "board_consts.h"
+#include "magic_moves.h"
+#include "slider_attacks.h"
+#include "zobrist.h"
+
+#ifndef GIRAFFE_TABLE_GENERATOR
+#error gen_tables must be built with GIRAFFE_TABLE_GENERATOR defined
+#endif
+
+namespace
+{
+
+const static size_t ValuesPerLine = 4;
+
+std::string Hex(uint64_t x)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "0x%016llxULL", static_cast<unsigned long long>(x));
+	return buf;
+}
+
+void WriteValues(std::ostream &os, const uint64_t *values, size_t num, const std::string &indent)
+{
+	for (size_t i = 0; i < num; ++i)
+	{
+		if (i % ValuesPerLine == 0)
+		{
+			os << indent;
+		}
+
+		os << Hex(values[i]) << ",";
+
+		os << (((i % ValuesPerLine) == (ValuesPerLine - 1) || i == (num - 1)) ? "\n" : " ");
+	}
+}
+
+// declaration is everything before the initializer, eg. "const uint64_t KING_ATK[64]"
+void WriteArray(std::ostream &os, const std::string &declaration, const uint64_t *values, size_t num)
+{
+	os << declaration << " =\n{\n";
+	WriteValues(os, values, num, "\t");
+	os << "};\n\n";
+}
+
+void WriteArray2D(std::ostream &os, const std::string &declaration, const uint64_t *values, size_t rows, size_t cols)
+{
+	os << declaration << " =\n{\n";
+
+	for (size_t row = 0; row < rows; ++row)
+	{
+		os << "\t{\n";
+		WriteValues(os, values + row * cols, cols, "\t\t");
+		os << "\t},\n";
+	}
+
+	os << "};\n\n";
+}
+
+void WriteScalar(std::ostream &os, const std::string &declaration, uint64_t value)
+{
+	os << declaration << " = " << Hex(value) << ";\n";
+}
+
+// pointers into PEXT_TABLE are written as offsets, so they are still constant initialized
+void WritePextPointers(std::ostream &os, const std::string &declaration, const uint64_t *const *pointers)
+{
+	os << declaration << " =\n{\n";
+
+	for (size_t sq = 0; sq < 64; ++sq)
+	{
+		os << "\tPEXT_TABLE + " << (pointers[sq] - SliderAttacks::PEXT_TABLE) << ",\n";
+	}
+
+	os << "};\n\n";
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <output cpp>" << std::endl;
+		return 1;
+	}
+
+	initmagicmoves();
+	SliderAttacks::InitPextTables();
+	BoardConstsInit();
+	InitializeZobrist();
+	InitializeCuckoo();
+
+	std::ofstream os(argv[1]);
+
+	if (!os)
+	{
+		std::cerr << "Failed to open " << argv[1] << " for writing" << std::endl;
+		return 1;
+	}
+
+	os << "// generated by tools/gen_tables.cpp, do not edit\n\n";
+
+	os << "#include \"board_consts.h\"\n";
+	os << "#include \"magic_moves.h\"\n";
+	os << "#include \"slider_attacks.h\"\n";
+	os << "#include \"zobrist.h\"\n\n";
+
+	// board_consts.h
+	WriteArray(os, "const uint64_t KING_ATK[64]", KING_ATK, 64);
+	WriteArray(os, "const uint64_t KNIGHT_ATK[64]", KNIGHT_ATK, 64);
+	WriteArray2D(os, "const uint64_t PAWN_ATK[64][2]", &PAWN_ATK[0][0], 64, 2);
+	WriteArray2D(os, "const uint64_t PAWN_MOVE_1[64][2]", &PAWN_MOVE_1[0][0], 64, 2);
+	WriteArray2D(os, "const uint64_t PAWN_MOVE_2[64][2]", &PAWN_MOVE_2[0][0], 64, 2);
+	WriteArray(os, "const uint64_t RANK_OF_SQ[64]", RANK_OF_SQ, 64);
+	WriteArray(os, "const uint64_t FILE_OF_SQ[64]", FILE_OF_SQ, 64);
+	WriteArray(os, "const uint64_t ADJACENT_FILES_OF_SQ[64]", ADJACENT_FILES_OF_SQ, 64);
+	WriteArray2D(os, "const uint64_t BETWEEN[64][64]", &BETWEEN[0][0], 64, 64);
+	WriteArray2D(os, "const uint64_t LINE[64][64]", &LINE[0][0], 64, 64);
+
+	// zobrist.h
+	WriteArray2D(os, "const uint64_t PIECES_ZOBRIST[64][PIECE_TYPE_LAST + 1]", &PIECES_ZOBRIST[0][0], 64, PIECE_TYPE_LAST + 1);
+	WriteArray(os, "const uint64_t EN_PASS_ZOBRIST[64]", EN_PASS_ZOBRIST, 64);
+	WriteArray(os, "const uint64_t MOVE_FROM_ZOBRIST[64]", MOVE_FROM_ZOBRIST, 64);
+	WriteArray(os, "const uint64_t MOVE_TO_ZOBRIST[64]", MOVE_TO_ZOBRIST, 64);
+	WriteArray(os, "const uint64_t PROMO_TYPE_ZOBRIST[PIECE_TYPE_LAST + 1]", PROMO_TYPE_ZOBRIST, PIECE_TYPE_LAST + 1);
+	WriteScalar(os, "const uint64_t SIDE_TO_MOVE_ZOBRIST", SIDE_TO_MOVE_ZOBRIST);
+	WriteScalar(os, "const uint64_t W_SHORT_CASTLE_ZOBRIST", W_SHORT_CASTLE_ZOBRIST);
+	WriteScalar(os, "const uint64_t W_LONG_CASTLE_ZOBRIST", W_LONG_CASTLE_ZOBRIST);
+	WriteScalar(os, "const uint64_t B_SHORT_CASTLE_ZOBRIST", B_SHORT_CASTLE_ZOBRIST);
+	WriteScalar(os, "const uint64_t B_LONG_CASTLE_ZOBRIST", B_LONG_CASTLE_ZOBRIST);
+	os << "\n";
+	WriteArray(os, "const uint64_t CUCKOO_KEYS[CUCKOO_TABLE_SIZE]", CUCKOO_KEYS, CUCKOO_TABLE_SIZE);
+
+	// constants are narrowed back to uint16_t by the initializer (they all fit)
+	std::vector<uint64_t> cuckooSquares(CUCKOO_SQUARES, CUCKOO_SQUARES + CUCKOO_TABLE_SIZE);
+	WriteArray(os, "const uint16_t CUCKOO_SQUARES[CUCKOO_TABLE_SIZE]", cuckooSquares.data(), CUCKOO_TABLE_SIZE);
+
+	// magic_moves.h (U64 is unsigned long long, which is the same size as uint64_t, but not the same type)
+	static_assert(sizeof(U64) == sizeof(uint64_t), "U64 must be 64-bit");
+	WriteArray2D(os, "const U64 magicmovesbdb[64][1<<9]", reinterpret_cast<const uint64_t *>(&magicmovesbdb[0][0]), 64, 1 << 9);
+	WriteArray2D(os, "const U64 magicmovesrdb[64][1<<12]", reinterpret_cast<const uint64_t *>(&magicmovesrdb[0][0]), 64, 1 << 12);
+
+	// slider_attacks.h
+	os << "namespace SliderAttacks\n{\n\n";
+	WriteArray(os, "const uint64_t PEXT_TABLE[PEXT_TABLE_SIZE]", SliderAttacks::PEXT_TABLE, SliderAttacks::PEXT_TABLE_SIZE);
+	WritePextPointers(os, "const uint64_t *const BISHOP_PEXT_TABLE[64]", SliderAttacks::BISHOP_PEXT_TABLE);
+	WritePextPointers(os, "const uint64_t *const ROOK_PEXT_TABLE[64]", SliderAttacks::ROOK_PEXT_TABLE);
+	os << "}\n";
+
+	if (!os)
+	{
+		std::cerr << "Failed to write " << argv[1] << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
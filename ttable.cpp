@@ -17,23 +17,58 @@
 
 #include "ttable.h"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
-TTable::TTable(size_t size)
-	: m_data(size), m_currentGeneration(0)
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "zobrist.h"
+
+TTable::TTable(size_t size, bool shared)
+	: m_data("Transposition table", size, shared), m_currentGeneration(0)
 {
 }
 
-void TTable::Resize(size_t newSize)
+size_t TTable::Resize(size_t newSize)
 {
-	m_data.resize(newSize);
+	if (newSize != m_data.GetSize())
+	{
+		// this needs memory for a copy of the used entries on top of the new table, but
+		// resizing only happens between games
+		std::vector<TTEntry> entries = CollectEntries_();
+
+		m_data.Resize(newSize);
+
+		MergeEntries_(entries.data(), entries.size());
+	}
+
+	size_t numEntries = 0;
+
+	for (size_t i = 0; i < m_data.GetSize(); ++i)
+	{
+		if (m_data[i].hash != 0)
+		{
+			++numEntries;
+		}
+	}
+
+	return numEntries;
 }
 
 void TTable::Store(const Board &board, Move bestMove, Score score, NodeBudget nodeBudget, TTEntryType entryType)
 {
 	uint64_t hash = board.GetHash();
 
-	TTEntry *slot = &m_data[hash % m_data.size()];
+	TTEntry *slot = &m_data[hash % m_data.GetSize()];
 
 	bool replace = false;
 
@@ -70,3 +105,168 @@ void TTable::ClearTable()
 	// we cheat by just incrementing currentGeneration by 1000, so that all entries will be replaced on first access
 	m_currentGeneration += 1000;
 }
+
+int64_t TTable::SaveSnapshot(const std::string &filename, uint64_t signature, size_t maxEntries)
+{
+	std::vector<TTEntry> entries = CollectEntries_();
+
+	if (maxEntries != 0 && entries.size() > maxEntries)
+	{
+		// keep the most expensive results
+		std::nth_element(entries.begin(), entries.begin() + maxEntries, entries.end(),
+			[](const TTEntry &a, const TTEntry &b) { return a.nodeBudget > b.nodeBudget; });
+
+		entries.resize(maxEntries);
+	}
+
+	SnapshotHeader header;
+	header.magic = SnapshotMagic;
+	header.version = SnapshotVersion;
+	header.zobristSignature = ZobristSignature_();
+	header.signature = signature;
+	header.numEntries = entries.size();
+	header.entrySize = sizeof(TTEntry);
+
+	std::ofstream outfile(filename, std::ios::binary);
+
+	outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	outfile.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(TTEntry));
+
+	outfile.close();
+
+	if (!outfile)
+	{
+		std::cout << "Error: failed to write " << filename << std::endl;
+		return -1;
+	}
+
+	return static_cast<int64_t>(entries.size());
+}
+
+int64_t TTable::LoadSnapshot(const std::string &filename, uint64_t signature)
+{
+	std::vector<char> buf;
+	const char *data = nullptr;
+	size_t fileSize = 0;
+
+#ifndef _WIN32
+	int fd = open(filename.c_str(), O_RDONLY);
+
+	if (fd < 0)
+	{
+		std::cout << "Error: failed to open " << filename << std::endl;
+		return -1;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		std::cout << "Error: failed to read " << filename << std::endl;
+		close(fd);
+		return -1;
+	}
+
+	fileSize = st.st_size;
+
+	void *mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+
+	if (mapped == MAP_FAILED)
+	{
+		std::cout << "Error: failed to map " << filename << std::endl;
+		return -1;
+	}
+
+	// we read the file sequentially once
+	madvise(mapped, fileSize, MADV_SEQUENTIAL);
+
+	data = static_cast<const char*>(mapped);
+#else
+	std::ifstream infile(filename, std::ios::binary);
+
+	if (!infile)
+	{
+		std::cout << "Error: failed to open " << filename << std::endl;
+		return -1;
+	}
+
+	buf.assign(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
+
+	data = buf.data();
+	fileSize = buf.size();
+#endif
+
+	int64_t ret = -1;
+
+	SnapshotHeader header;
+
+	if (fileSize < sizeof(header))
+	{
+		std::cout << "Error: " << filename << " is not a ttable snapshot" << std::endl;
+	}
+	else
+	{
+		memcpy(&header, data, sizeof(header));
+
+		if (header.magic != SnapshotMagic || header.entrySize != sizeof(TTEntry) ||
+			fileSize != (sizeof(header) + header.numEntries * sizeof(TTEntry)))
+		{
+			std::cout << "Error: " << filename << " is not a ttable snapshot" << std::endl;
+		}
+		else if (header.version != SnapshotVersion || header.zobristSignature != ZobristSignature_())
+		{
+			std::cout << "Error: " << filename << " is from an incompatible version" << std::endl;
+		}
+		else if (header.signature != signature)
+		{
+			std::cout << "Error: " << filename << " was saved with a different evaluator" << std::endl;
+		}
+		else
+		{
+			MergeEntries_(reinterpret_cast<const TTEntry*>(data + sizeof(header)), header.numEntries);
+			ret = static_cast<int64_t>(header.numEntries);
+		}
+	}
+
+#ifndef _WIN32
+	munmap(const_cast<char*>(data), fileSize);
+#endif
+
+	return ret;
+}
+
+uint64_t TTable::ZobristSignature_()
+{
+	return PIECES_ZOBRIST[0][WK] ^ PIECES_ZOBRIST[63][BP] ^ SIDE_TO_MOVE_ZOBRIST ^ B_LONG_CASTLE_ZOBRIST;
+}
+
+std::vector<TTEntry> TTable::CollectEntries_() const
+{
+	std::vector<TTEntry> entries;
+
+	for (size_t i = 0; i < m_data.GetSize(); ++i)
+	{
+		if (m_data[i].hash != 0)
+		{
+			entries.push_back(m_data[i]);
+		}
+	}
+
+	return entries;
+}
+
+void TTable::MergeEntries_(const TTEntry *entries, size_t numEntries)
+{
+	for (size_t i = 0; i < numEntries; ++i)
+	{
+		TTEntry *slot = &m_data[entries[i].hash % m_data.GetSize()];
+
+		if (slot->hash == 0 || entries[i].nodeBudget > slot->nodeBudget)
+		{
+			*slot = entries[i];
+			slot->birthday = m_currentGeneration;
+		}
+	}
+}
@@ -20,6 +20,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <cstdint>
@@ -28,6 +29,7 @@
 #include "types.h"
 #include "move.h"
 #include "board.h"
+#include "large_pages.h"
 
 enum TTEntryType
 {
@@ -56,16 +58,22 @@ using TTEntryCallback = std::function<void(const Board &b, const TTEntry &)>;
 class TTable
 {
 public:
-	TTable(size_t size);
+	// shared should be true if the table is used by more than one thread (see LargePages::Allocate())
+	TTable(size_t size, bool shared);
 
 	TTable(const TTable&) = delete;
 	TTable &operator=(const TTable&) = delete;
 
-	void Resize(size_t newSize);
+	// does nothing if the size is unchanged, otherwise existing entries (eg. from a loaded snapshot)
+	// are rehashed into the new table, as far as they fit
+	// returns the number of entries in the table after resizing
+	size_t Resize(size_t newSize);
+
+	size_t GetSize() const { return m_data.GetSize(); }
 
 	TTEntry *Probe(uint64_t hash)
 	{
-		size_t idx = hash % m_data.size();
+		size_t idx = hash % m_data.GetSize();
 		TTEntry *entry = &m_data[idx];
 		if (entry->hash == hash)
 		{
@@ -79,7 +87,7 @@ public:
 
 	void Prefetch(uint64_t hash)
 	{
-		__builtin_prefetch(&m_data[hash % m_data.size()]);
+		__builtin_prefetch(&m_data[hash % m_data.GetSize()]);
 	}
 
 	void Store(const Board &b, Move bestMove, Score score, NodeBudget nodeBudget, TTEntryType entryType);
@@ -91,10 +99,7 @@ public:
 
 	void InvalidateAllEntries()
 	{
-		for (size_t i = 0; i < m_data.size(); ++i)
-		{
-			m_data[i].hash = 0;
-		}
+		m_data.Fill(TTEntry());
 	}
 
 	void SetStoreCallback(TTEntryCallback callback)
@@ -102,8 +107,40 @@ public:
 		m_storeCallback = callback;
 	}
 
+	// snapshots are for reusing results across sessions (eg. when analyzing the same openings)
+	// signature must identify everything scores depend on (eg. the evaluator), and snapshots with
+	// a different signature (or from a build with different hash keys) are rejected
+	// if maxEntries is not 0, only that many entries with the highest node budgets are saved
+	// these return the number of entries saved/loaded, or -1 on error
+	int64_t SaveSnapshot(const std::string &filename, uint64_t signature, size_t maxEntries = 0);
+
+	// the file is mmap-ed, and entries are merged into the table (an entry already in the table is
+	// only replaced by an entry with a higher node budget)
+	int64_t LoadSnapshot(const std::string &filename, uint64_t signature);
+
 private:
-	std::vector<TTEntry> m_data;
+	struct SnapshotHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t zobristSignature;
+		uint64_t signature;
+		uint64_t numEntries;
+		uint64_t entrySize;
+	};
+
+	const static uint32_t SnapshotMagic = 0x54544150; // "PATT"
+	const static uint32_t SnapshotVersion = 1;
+
+	// this changes if the hash keys change, which would make all stored hashes meaningless
+	static uint64_t ZobristSignature_();
+
+	// all used entries
+	std::vector<TTEntry> CollectEntries_() const;
+
+	void MergeEntries_(const TTEntry *entries, size_t numEntries);
+
+	LargePageArray<TTEntry> m_data;
 
 	int32_t m_currentGeneration;
 
@@ -37,6 +37,16 @@
 
 #define UNUSED(x) (void)(x)
 
+// a T that is created on first use, and intentionally never destroyed, so it can still be used while static
+// objects are being destroyed (eg. by threads that are still running, or by destructors of static tables)
+// Owner only makes different users of the same T get different objects
+template <typename Owner, typename T>
+T &LeakedStatic()
+{
+	static T *obj = new T;
+	return *obj;
+}
+
 inline double CurrentTime() { //returns current time
 	return static_cast<double>(
 				std::chrono::duration_cast<std::chrono::microseconds>(
@@ -66,6 +76,19 @@ inline T ParseStr(const std::string &str)
 	return ret;
 }
 
+// largest power of 2 <= x (x must be > 0), so hash tables can be indexed with a mask
+inline size_t FloorPowerOf2(size_t x)
+{
+	size_t ret = 1;
+
+	while ((ret * 2) <= x && (ret * 2) != 0)
+	{
+		ret *= 2;
+	}
+
+	return ret;
+}
+
 inline bool FileReadable(const std::string &filename)
 {
 	std::ifstream infile(filename);
@@ -17,7 +17,15 @@
 
 #include "zobrist.h"
 
+#ifdef GIRAFFE_TABLE_GENERATOR
+
 #include <random>
+#include <utility>
+
+#include <cassert>
+
+#include "board_consts.h"
+#include "magic_moves.h"
 
 uint64_t PIECES_ZOBRIST[64][PIECE_TYPE_LAST + 1];
 
@@ -34,6 +42,9 @@ uint64_t MOVE_FROM_ZOBRIST[64];
 uint64_t MOVE_TO_ZOBRIST[64];
 uint64_t PROMO_TYPE_ZOBRIST[PIECE_TYPE_LAST + 1];
 
+uint64_t CUCKOO_KEYS[CUCKOO_TABLE_SIZE];
+uint16_t CUCKOO_SQUARES[CUCKOO_TABLE_SIZE];
+
 void InitializeZobrist()
 {
 	std::mt19937_64 gen(53820873); // using the default seed
@@ -62,3 +73,61 @@ void InitializeZobrist()
 	B_SHORT_CASTLE_ZOBRIST = gen();
 	B_LONG_CASTLE_ZOBRIST = gen();
 }
+
+void InitializeCuckoo()
+{
+	const static PieceType PIECE_TYPES[] = { WK, WQ, WR, WN, WB, BK, BQ, BR, BN, BB };
+
+	size_t count = 0;
+
+	for (PieceType pt : PIECE_TYPES)
+	{
+		for (Square sq1 = 0; sq1 < 64; ++sq1)
+		{
+			uint64_t attacks = 0;
+
+			switch (StripColor(pt))
+			{
+			case K: attacks = KING_ATK[sq1]; break;
+			case Q: attacks = Bmagic(sq1, 0) | Rmagic(sq1, 0); break;
+			case R: attacks = Rmagic(sq1, 0); break;
+			case N: attacks = KNIGHT_ATK[sq1]; break;
+			default: attacks = Bmagic(sq1, 0); break;
+			}
+
+			for (Square sq2 = sq1 + 1; sq2 < 64; ++sq2)
+			{
+				if (!(attacks & (1ULL << sq2)))
+				{
+					continue;
+				}
+
+				uint64_t key = PIECES_ZOBRIST[sq1][pt] ^ PIECES_ZOBRIST[sq2][pt] ^ SIDE_TO_MOVE_ZOBRIST;
+				uint16_t squares = sq1 | (sq2 << 8);
+
+				// insert, and keep kicking out the existing entry to its other slot until we find an empty slot
+				size_t slot = CuckooH1(key);
+
+				while (true)
+				{
+					std::swap(CUCKOO_KEYS[slot], key);
+					std::swap(CUCKOO_SQUARES[slot], squares);
+
+					if (squares == 0)
+					{
+						break;
+					}
+
+					slot = (slot == CuckooH1(key)) ? CuckooH2(key) : CuckooH1(key);
+				}
+
+				++count;
+			}
+		}
+	}
+
+	assert(count == NUM_CUCKOO_MOVES);
+	(void) count;
+}
+
+#endif // GIRAFFE_TABLE_GENERATOR
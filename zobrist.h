@@ -21,23 +21,44 @@
 #include <cstdint>
 
 #include "types.h"
+#include "generated_tables.h"
 
-extern uint64_t PIECES_ZOBRIST[64][PIECE_TYPE_LAST + 1];
+extern GENERATED_TABLE uint64_t PIECES_ZOBRIST[64][PIECE_TYPE_LAST + 1];
 
-extern uint64_t SIDE_TO_MOVE_ZOBRIST;
+extern GENERATED_TABLE uint64_t SIDE_TO_MOVE_ZOBRIST;
 
-extern uint64_t EN_PASS_ZOBRIST[64];
+extern GENERATED_TABLE uint64_t EN_PASS_ZOBRIST[64];
 
-extern uint64_t W_SHORT_CASTLE_ZOBRIST;
-extern uint64_t W_LONG_CASTLE_ZOBRIST;
-extern uint64_t B_SHORT_CASTLE_ZOBRIST;
-extern uint64_t B_LONG_CASTLE_ZOBRIST;
+extern GENERATED_TABLE uint64_t W_SHORT_CASTLE_ZOBRIST;
+extern GENERATED_TABLE uint64_t W_LONG_CASTLE_ZOBRIST;
+extern GENERATED_TABLE uint64_t B_SHORT_CASTLE_ZOBRIST;
+extern GENERATED_TABLE uint64_t B_LONG_CASTLE_ZOBRIST;
 
 // for move hashing
-extern uint64_t MOVE_FROM_ZOBRIST[64];
-extern uint64_t MOVE_TO_ZOBRIST[64];
-extern uint64_t PROMO_TYPE_ZOBRIST[PIECE_TYPE_LAST + 1];
+extern GENERATED_TABLE uint64_t MOVE_FROM_ZOBRIST[64];
+extern GENERATED_TABLE uint64_t MOVE_TO_ZOBRIST[64];
+extern GENERATED_TABLE uint64_t PROMO_TYPE_ZOBRIST[PIECE_TYPE_LAST + 1];
 
+// cuckoo hash table of the hash differences made by all reversible (non-pawn) moves on an empty board, for detecting
+// upcoming repetitions (see Board::HasUpcomingRepetition())
+// key is PIECES_ZOBRIST[sq1][pt] ^ PIECES_ZOBRIST[sq2][pt] ^ SIDE_TO_MOVE_ZOBRIST, and each slot has the 2 squares
+// (sq1 | (sq2 << 8)), 0 for empty slots
+// both directions of a move have the same key, so the piece can be on either square
+const static size_t CUCKOO_TABLE_SIZE = 8192;
+const static size_t NUM_CUCKOO_MOVES = 3668;
+
+extern GENERATED_TABLE uint64_t CUCKOO_KEYS[CUCKOO_TABLE_SIZE];
+extern GENERATED_TABLE uint16_t CUCKOO_SQUARES[CUCKOO_TABLE_SIZE];
+
+inline size_t CuckooH1(uint64_t key) { return key & (CUCKOO_TABLE_SIZE - 1); }
+inline size_t CuckooH2(uint64_t key) { return (key >> 16) & (CUCKOO_TABLE_SIZE - 1); }
+
+#ifdef GIRAFFE_TABLE_GENERATOR
+// mt19937_64 with a fixed seed, so hashes are the same across builds
 void InitializeZobrist();
 
+// must be called after InitializeZobrist(), BoardConstsInit(), and initmagicmoves()
+void InitializeCuckoo();
+#endif
+
 #endif // ZOBRIST_H